@@ -127,7 +127,7 @@ error_t Account::AddCoins(uint32_t amount) {
   query << "UPDATE `accounts` SET `coins` = " << (current_coins + amount)
         << " WHERE `id` = " << id_;
 
-  db_tasks_->addTask(query.str());
+  db_tasks_->addTask(query.str(), nullptr, false, DATABASE_TASK_ACCOUNT_KEY | id_);
   return ERROR_NO;
 }
 
@@ -152,7 +152,7 @@ error_t Account::RemoveCoins(uint32_t amount) {
   query << "UPDATE `accounts` SET `coins` = "<< (current_coins - amount)
         << " WHERE `id` = " << id_;
 
-  db_tasks_->addTask(query.str());
+  db_tasks_->addTask(query.str(), nullptr, false, DATABASE_TASK_ACCOUNT_KEY | id_);
 
   return ERROR_NO;
 }
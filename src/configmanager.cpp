@@ -145,6 +145,19 @@ bool ConfigManager::load()
 		integer[PREMIUM_DEPOT_LIMIT] = getGlobalNumber(L, "premiumDepotLimit", 8000);
 		integer[DEPOT_BOXES] = getGlobalNumber(L, "depotBoxes", 19);
 		integer[STASH_ITEMS] = getGlobalNumber(L, "stashItemCount", 5000);
+
+		boolean[SCHEDULER_TIMING_WHEEL] = getGlobalBoolean(L, "schedulerTimingWheel", true);
+		boolean[GAME_LOOP_TICK_MODE] = getGlobalBoolean(L, "gameLoopTickMode", false);
+		boolean[MAP_SNAPSHOT] = getGlobalBoolean(L, "mapSnapshot", false);
+		boolean[ASYNC_PLAYER_SAVE] = getGlobalBoolean(L, "asyncPlayerSave", true);
+		integer[GAME_LOOP_FRAME_TIME] = getGlobalNumber(L, "gameLoopFrameTime", 50);
+		integer[DISPATCHER_PROFILER_INTERVAL] = getGlobalNumber(L, "dispatcherProfilerInterval", 300);
+		integer[NETWORK_THREADS] = getGlobalNumber(L, "networkThreads", 0);
+		integer[MAP_LOADER_THREADS] = getGlobalNumber(L, "mapLoaderThreads", 0);
+		integer[CREATURE_THINK_THREADS] = getGlobalNumber(L, "creatureThinkThreads", 0);
+		integer[DATABASE_WORKER_THREADS] = getGlobalNumber(L, "databaseWorkerThreads", 2);
+		integer[LOGIN_THREADS] = getGlobalNumber(L, "loginThreads", 2);
+		integer[LOGIN_QUEUE_SIZE] = getGlobalNumber(L, "loginQueueSize", 100);
 	}
 
 	boolean[ALLOW_CHANGEOUTFIT] = getGlobalBoolean(L, "allowChangeOutfit", true);
@@ -186,6 +199,9 @@ bool ConfigManager::load()
 
 	boolean[ONLY_PREMIUM_ACCOUNT] = getGlobalBoolean(L, "onlyPremiumAccount", false);
 
+	boolean[PACKET_COMPRESSION] = getGlobalBoolean(L, "packetCompression", false);
+	integer[PACKET_COMPRESSION_LEVEL] = getGlobalNumber(L, "packetCompressionLevel", 6);
+
 	string[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
 	string[SERVER_NAME] = getGlobalString(L, "serverName", "");
 	string[OWNER_NAME] = getGlobalString(L, "ownerName", "");
@@ -61,6 +61,11 @@ class ConfigManager
 			ONLY_PREMIUM_ACCOUNT,
 			MAP_CUSTOM_ENABLED,
 			ALL_CONSOLE_LOG,
+			SCHEDULER_TIMING_WHEEL,
+			GAME_LOOP_TICK_MODE,
+			PACKET_COMPRESSION,
+			MAP_SNAPSHOT,
+			ASYNC_PLAYER_SAVE,
 
 			LAST_BOOLEAN_CONFIG /* this must be the last one */
 		};
@@ -142,6 +147,15 @@ class ConfigManager
 			PUSH_DISTANCE_DELAY,
 			STASH_ITEMS,
 			PARTY_LIST_MAX_DISTANCE,
+			GAME_LOOP_FRAME_TIME,
+			DISPATCHER_PROFILER_INTERVAL,
+			NETWORK_THREADS,
+			MAP_LOADER_THREADS,
+			CREATURE_THINK_THREADS,
+			DATABASE_WORKER_THREADS,
+			LOGIN_THREADS,
+			LOGIN_QUEUE_SIZE,
+			PACKET_COMPRESSION_LEVEL,
 
 			LAST_INTEGER_CONFIG /* this must be the last one */
 		};
@@ -50,16 +50,52 @@ void ConnectionManager::closeAll()
 	std::lock_guard<std::mutex> lockClass(connectionManagerLock);
 
 	for (const auto& connection : connections) {
-		try {
-			boost::system::error_code error;
-			connection->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-			connection->socket.close(error);
-		} catch (boost::system::system_error&) {
-		}
+		// the socket may only be used from the connection's strand
+		boost::asio::post(connection->strand, std::bind(&Connection::closeSocket, connection));
 	}
 	connections.clear();
 }
 
+NetworkStats ConnectionManager::getStats() const
+{
+	NetworkStats stats;
+	stats.writes = writes.load(std::memory_order_relaxed);
+	stats.writtenMessages = writtenMessages.load(std::memory_order_relaxed);
+	stats.writtenBytes = writtenBytes.load(std::memory_order_relaxed);
+	stats.compressedMessages = compressedMessages.load(std::memory_order_relaxed);
+	stats.compressionInput = compressionInput.load(std::memory_order_relaxed);
+	stats.compressionOutput = compressionOutput.load(std::memory_order_relaxed);
+	stats.compressionTime = compressionTime.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void ConnectionManager::startReports(uint32_t interval)
+{
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&ConnectionManager::logReport, this, interval, getStats())));
+}
+
+void ConnectionManager::logReport(uint32_t interval, NetworkStats last)
+{
+	NetworkStats current = getStats();
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&ConnectionManager::logReport, this, interval, current)));
+
+	uint64_t windowWrites = current.writes - last.writes;
+	if (windowWrites != 0) {
+		// one write is one writev syscall, partial writes included
+		SPDLOG_INFO("[Network] {:.1f} writes/s, {} bytes and {:.2f} messages per write",
+			windowWrites * 1000.0 / interval, (current.writtenBytes - last.writtenBytes) / windowWrites,
+			static_cast<double>(current.writtenMessages - last.writtenMessages) / windowWrites);
+	}
+
+	uint64_t windowInput = current.compressionInput - last.compressionInput;
+	if (windowInput != 0) {
+		SPDLOG_INFO("[Network] deflated {} messages from {} to {} bytes ({:.1f}%), {:.2f} us per message",
+			current.compressedMessages - last.compressedMessages, windowInput, current.compressionOutput - last.compressionOutput,
+			(current.compressionOutput - last.compressionOutput) * 100.0 / windowInput,
+			(current.compressionTime - last.compressionTime) / 1000.0 / (current.compressedMessages - last.compressedMessages));
+	}
+}
+
 // Connection
 
 void Connection::close(bool force)
@@ -67,7 +103,11 @@ void Connection::close(bool force)
 	//any thread
 	ConnectionManager::getInstance().releaseConnection(shared_from_this());
 
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+	boost::asio::dispatch(strand, std::bind(&Connection::internalClose, shared_from_this(), force));
+}
+
+void Connection::internalClose(bool force)
+{
 	connectionState = CONNECTION_STATE_DISCONNECTED;
 
 	if (protocol) {
@@ -85,6 +125,7 @@ void Connection::close(bool force)
 void Connection::closeSocket()
 {
 	if (socket.is_open()) {
+		remoteIP.store(0, std::memory_order_relaxed);
 		try {
 			readTimer.cancel();
 			writeTimer.cancel();
@@ -105,8 +146,8 @@ Connection::~Connection()
 void Connection::accept(Protocol_ptr conProtocol)
 {
 	this->protocol = conProtocol;
-	g_dispatcher.addTask(createTask(std::bind(&Protocol::onConnect, protocol)));
 	connectionState = CONNECTION_STATE_CONNECTING_STAGE2;
+	g_dispatcher.addTask(createTask(std::bind(&Protocol::onConnect, protocol)));
 
 	accept();
 }
@@ -116,31 +157,35 @@ void Connection::accept()
 	if (connectionState == CONNECTION_STATE_PENDING) {
 		connectionState = CONNECTION_STATE_CONNECTING_STAGE1;
 	}
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+
+	// the dispatcher may already be sending (Protocol::onConnect), so reading starts on the strand
+	boost::asio::post(strand, std::bind(&Connection::readHeader, shared_from_this()));
+}
+
+void Connection::readHeader()
+{
 	try {
 		readTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_READ_TIMEOUT));
-		readTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()), std::placeholders::_1));
+		readTimer.async_wait(boost::asio::bind_executor(strand, std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()), std::placeholders::_1)));
 
 		if (!receivedLastChar && receivedName && connectionState == CONNECTION_STATE_CONNECTING_STAGE2) {
 			// Read size of the first packet
 			boost::asio::async_read(socket,
 				boost::asio::buffer(msg.getBuffer(), 1),
-				std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+				boost::asio::bind_executor(strand, std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1)));
 		} else {
 			// Read size of the first packet
 			boost::asio::async_read(socket,
 				boost::asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH),
-				std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+				boost::asio::bind_executor(strand, std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1)));
 		}
 	} catch (boost::system::system_error& e) {
-		SPDLOG_ERROR("[Connection::accept] - {}", e.what());
+		SPDLOG_ERROR("[Connection::readHeader] - {}", e.what());
 		close(FORCE_CLOSE);
 	}
 }
-
 void Connection::parseHeader(const boost::system::error_code& error)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
 	readTimer.cancel();
 
 	if (error) {
@@ -171,7 +216,7 @@ void Connection::parseHeader(const boost::system::error_code& error)
 					receivedName = true;
 					serverNameTime = 1;
 
-					accept();
+					readHeader();
 					return;
 				} else {
 					SPDLOG_ERROR("Connection::parseHeader] "
@@ -187,7 +232,7 @@ void Connection::parseHeader(const boost::system::error_code& error)
 					receivedLastChar = true;
 				}
 
-				accept();
+				readHeader();
 				return;
 			} else {
 				SPDLOG_ERROR("Connection::parseHeader] "
@@ -215,13 +260,13 @@ void Connection::parseHeader(const boost::system::error_code& error)
 
 	try {
 		readTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_READ_TIMEOUT));
-		readTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()),
-		                                    std::placeholders::_1));
+		readTimer.async_wait(boost::asio::bind_executor(strand, std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()),
+		                                    std::placeholders::_1)));
 
 		// Read packet content
 		msg.setLength(size + NetworkMessage::HEADER_LENGTH);
 		boost::asio::async_read(socket, boost::asio::buffer(msg.getBodyBuffer(), size),
-		                        std::bind(&Connection::parsePacket, shared_from_this(), std::placeholders::_1));
+		                        boost::asio::bind_executor(strand, std::bind(&Connection::parsePacket, shared_from_this(), std::placeholders::_1)));
 	} catch (boost::system::system_error& e) {
 		SPDLOG_ERROR("[Connection::parseHeader] - {}", e.what());
 		close(FORCE_CLOSE);
@@ -230,7 +275,6 @@ void Connection::parseHeader(const boost::system::error_code& error)
 
 void Connection::parsePacket(const boost::system::error_code& error)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
 	readTimer.cancel();
 
 	if (error) {
@@ -273,13 +317,13 @@ void Connection::parsePacket(const boost::system::error_code& error)
 
 	try {
 		readTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_READ_TIMEOUT));
-		readTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()),
-		                                    std::placeholders::_1));
+		readTimer.async_wait(boost::asio::bind_executor(strand, std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()),
+		                                    std::placeholders::_1)));
 
 		// Wait to the next packet
 		boost::asio::async_read(socket,
 		                        boost::asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH),
-		                        std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+		                        boost::asio::bind_executor(strand, std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1)));
 	} catch (boost::system::system_error& e) {
 		SPDLOG_ERROR("[Connection::parsePacket] - {}", e.what());
 		close(FORCE_CLOSE);
@@ -288,63 +332,116 @@ void Connection::parsePacket(const boost::system::error_code& error)
 
 void Connection::send(const OutputMessage_ptr& conMsg)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
-	if (connectionState == CONNECTION_STATE_DISCONNECTED) {
-		return;
+	//any thread, the message is finished and only padded, encrypted and written from here on
+	bool postFlush;
+	{
+		std::lock_guard<std::mutex> lockClass(outboxLock);
+		outbox.emplace_back(conMsg);
+		postFlush = !outboxFlushPending;
+		outboxFlushPending = true;
 	}
 
-	bool noPendingWrite = messageQueue.empty();
-	messageQueue.emplace_back(conMsg);
-	if (noPendingWrite) {
-		internalSend(conMsg);
+	if (strand.running_in_this_thread()) {
+		// a protocol sending from the network thread may close the connection right after
+		flushOutbox();
+	} else if (postFlush) {
+		boost::asio::post(strand, std::bind(&Connection::flushOutbox, shared_from_this()));
+	}
+}
+
+void Connection::flushOutbox()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(outboxLock);
+		outbox.swap(outboxBatch);
+		outboxFlushPending = false;
+	}
+
+	if (connectionState != CONNECTION_STATE_DISCONNECTED) {
+		bool noPendingWrite = messageQueue.empty();
+		// encrypted in the order they were sent, so the sequence numbers match the write order
+		for (const OutputMessage_ptr& outputMessage : outboxBatch) {
+			if (!protocol->onSendMessage(outputMessage)) {
+				// the protocol is closing the connection, this message and the ones after it are dropped
+				break;
+			}
+			if (messageQueue.full()) {
+				messageQueue.set_capacity(messageQueue.capacity() * 2);
+			}
+			messageQueue.push_back(outputMessage);
+		}
+
+		// otherwise onWriteOperation picks the new messages up for the next write
+		if (noPendingWrite && !messageQueue.empty()) {
+			internalSend();
+		}
 	}
+	outboxBatch.clear();
 }
 
-void Connection::internalSend(const OutputMessage_ptr& conMsg)
+void Connection::internalSend()
 {
-	protocol->onSendMessage(conMsg);
+	WriteBuffers buffers;
+	buffers.first = writeBuffers.data();
+	buffers.last = writeBuffers.data();
+
+	size_t offset = writeOffset;
+	for (const OutputMessage_ptr& outputMessage : messageQueue) {
+		writeBuffers[buffers.last - buffers.first] = boost::asio::const_buffer(outputMessage->getOutputBuffer() + offset, outputMessage->getLength() - offset);
+		offset = 0;
+		if (++buffers.last == writeBuffers.data() + writeBuffers.size()) {
+			break;
+		}
+	}
+
 	try {
 		writeTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_WRITE_TIMEOUT));
-		writeTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()),
-		                                     std::placeholders::_1));
+		writeTimer.async_wait(boost::asio::bind_executor(strand, std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()),
+		                                     std::placeholders::_1)));
 
-		boost::asio::async_write(socket,
-		                         boost::asio::buffer(conMsg->getOutputBuffer(), conMsg->getLength()),
-		                         std::bind(&Connection::onWriteOperation, shared_from_this(), std::placeholders::_1));
+		// a single writev, whatever it leaves over is sent by the next one
+		socket.async_write_some(buffers,
+		                        boost::asio::bind_executor(strand, std::bind(&Connection::onWriteOperation, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
 	} catch (boost::system::system_error& e) {
 		SPDLOG_ERROR("[Connection::internalSend] - {}", e.what());
 		close(FORCE_CLOSE);
 	}
 }
 
-uint32_t Connection::getIP()
+void Connection::resolveIP()
 {
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
-
 	// IP-address is expressed in network byte order
 	boost::system::error_code error;
 	const boost::asio::ip::tcp::endpoint endpoint = socket.remote_endpoint(error);
-	if (error) {
-		return 0;
+	if (!error) {
+		remoteIP.store(htonl(endpoint.address().to_v4().to_ulong()), std::memory_order_relaxed);
 	}
-
-	return htonl(endpoint.address().to_v4().to_ulong());
 }
 
-void Connection::onWriteOperation(const boost::system::error_code& error)
+void Connection::onWriteOperation(const boost::system::error_code& error, size_t bytesTransferred)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
 	writeTimer.cancel();
-	messageQueue.pop_front();
 
 	if (error) {
 		messageQueue.clear();
+		writeOffset = 0;
 		close(FORCE_CLOSE);
 		return;
 	}
 
+	// release the messages that were written completely, a partial one stays in front
+	size_t written = writeOffset + bytesTransferred;
+	size_t messages = 0;
+	while (!messageQueue.empty() && written >= messageQueue.front()->getLength()) {
+		written -= messageQueue.front()->getLength();
+		messageQueue.pop_front();
+		++messages;
+	}
+	writeOffset = written;
+	ConnectionManager::getInstance().recordWrite(messages, bytesTransferred);
+
 	if (!messageQueue.empty()) {
-		internalSend(messageQueue.front());
+		internalSend();
 	} else if (connectionState == CONNECTION_STATE_DISCONNECTED) {
 		closeSocket();
 	}
@@ -24,10 +24,14 @@
 
 #include <unordered_set>
 
+#include <boost/circular_buffer.hpp>
+
 #include "networkmessage.h"
 
 static constexpr int32_t CONNECTION_WRITE_TIMEOUT = 30;
 static constexpr int32_t CONNECTION_READ_TIMEOUT = 30;
+// queued messages gathered into one write, asio hands at most 64 buffers to writev
+static constexpr size_t CONNECTION_WRITE_BATCH = 64;
 
 class Protocol;
 using Protocol_ptr = std::shared_ptr<Protocol>;
@@ -42,6 +46,17 @@ class ServicePort;
 using ServicePort_ptr = std::shared_ptr<ServicePort>;
 using ConstServicePort_ptr = std::shared_ptr<const ServicePort>;
 
+struct NetworkStats
+{
+	uint64_t writes = 0;
+	uint64_t writtenMessages = 0;
+	uint64_t writtenBytes = 0;
+	uint64_t compressedMessages = 0;
+	uint64_t compressionInput = 0;
+	uint64_t compressionOutput = 0;
+	uint64_t compressionTime = 0;
+};
+
 class ConnectionManager
 {
 	public:
@@ -54,11 +69,37 @@ class ConnectionManager
 		void releaseConnection(const Connection_ptr& connection);
 		void closeAll();
 
+		// every completed socket write of any connection, called from the network threads
+		void recordWrite(size_t messages, size_t bytes) {
+			writes.fetch_add(1, std::memory_order_relaxed);
+			writtenMessages.fetch_add(messages, std::memory_order_relaxed);
+			writtenBytes.fetch_add(bytes, std::memory_order_relaxed);
+		}
+		// every deflated message body, called from the network threads
+		void recordCompression(size_t input, size_t output, uint64_t nanoseconds) {
+			compressedMessages.fetch_add(1, std::memory_order_relaxed);
+			compressionInput.fetch_add(input, std::memory_order_relaxed);
+			compressionOutput.fetch_add(output, std::memory_order_relaxed);
+			compressionTime.fetch_add(nanoseconds, std::memory_order_relaxed);
+		}
+		NetworkStats getStats() const;
+		void startReports(uint32_t interval);
+
 	protected:
 		ConnectionManager() = default;
 
+		void logReport(uint32_t interval, NetworkStats last);
+
 		std::unordered_set<Connection_ptr> connections;
 		std::mutex connectionManagerLock;
+
+		std::atomic<uint64_t> writes {0};
+		std::atomic<uint64_t> writtenMessages {0};
+		std::atomic<uint64_t> writtenBytes {0};
+		std::atomic<uint64_t> compressedMessages {0};
+		std::atomic<uint64_t> compressionInput {0};
+		std::atomic<uint64_t> compressionOutput {0};
+		std::atomic<uint64_t> compressionTime {0};
 };
 
 class Connection : public std::enable_shared_from_this<Connection>
@@ -82,8 +123,10 @@ class Connection : public std::enable_shared_from_this<Connection>
 			ConstServicePort_ptr init_service_port) :
 			readTimer(init_io_service),
 			writeTimer(init_io_service),
+			messageQueue(16),
 			service_port(std::move(init_service_port)),
-			socket(init_io_service) {
+			socket(init_io_service),
+			strand(init_io_service) {
 			connectionState = CONNECTION_STATE_PENDING;
 			packetsSent = 0;
 			timeConnected = time(nullptr);
@@ -103,18 +146,28 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		void send(const OutputMessage_ptr& msg);
 
-		uint32_t getIP();
+		// remote address, 0 once the socket was closed
+		uint32_t getIP() const {
+			return remoteIP.load(std::memory_order_relaxed);
+		}
 
 	private:
+		// everything below runs on the connection's strand
+		void readHeader();
 		void parseHeader(const boost::system::error_code& error);
 		void parsePacket(const boost::system::error_code& error);
 
-		void onWriteOperation(const boost::system::error_code& error);
+		void onWriteOperation(const boost::system::error_code& error, size_t bytesTransferred);
 
 		static void handleTimeout(ConnectionWeak_ptr connectionWeak, const boost::system::error_code& error);
 
 		void closeSocket();
-		void internalSend(const OutputMessage_ptr& msg);
+		void internalClose(bool force);
+		void flushOutbox();
+		void internalSend();
+
+		// acceptor strand, before the connection starts reading
+		void resolveIP();
 
 		boost::asio::ip::tcp::socket& getSocket() {
 			return socket;
@@ -126,15 +179,44 @@ class Connection : public std::enable_shared_from_this<Connection>
 		boost::asio::deadline_timer readTimer;
 		boost::asio::deadline_timer writeTimer;
 
-		std::recursive_mutex connectionLock;
+		// encrypted messages waiting for the socket, the front ones are being written
+		boost::circular_buffer<OutputMessage_ptr> messageQueue;
+
+		// the write in progress gathers up to CONNECTION_WRITE_BATCH queued messages, the
+		// first buffer starts writeOffset bytes into the front message after a partial write
+		struct WriteBuffers {
+			using value_type = boost::asio::const_buffer;
+			using const_iterator = const boost::asio::const_buffer*;
+			const_iterator begin() const {
+				return first;
+			}
+			const_iterator end() const {
+				return last;
+			}
+
+			const_iterator first;
+			const_iterator last;
+		};
+		std::array<boost::asio::const_buffer, CONNECTION_WRITE_BATCH> writeBuffers;
+		size_t writeOffset = 0;
 
-		std::list<OutputMessage_ptr> messageQueue;
+		// finished messages handed over by other threads (mostly the dispatcher), the
+		// strand takes them as a batch in flushOutbox to encrypt and queue them
+		std::mutex outboxLock;
+		std::vector<OutputMessage_ptr> outbox;
+		std::vector<OutputMessage_ptr> outboxBatch;
+		bool outboxFlushPending = false;
 
 		ConstServicePort_ptr service_port;
 		Protocol_ptr protocol;
 
 		boost::asio::ip::tcp::socket socket;
 
+		// serializes the socket handlers, the io_service is run by several network threads
+		boost::asio::io_service::strand strand;
+
+		std::atomic<uint32_t> remoteIP {0};
+
 		time_t timeConnected;
 		uint32_t packetsSent;
 
@@ -190,6 +190,7 @@ class Container : public Item, public Cylinder
 
 		friend class ContainerIterator;
 		friend class IOMapSerialize;
+		friend class IOMapSnapshot;
 };
 
 #endif
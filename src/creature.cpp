@@ -309,7 +309,7 @@ void Creature::addEventWalk(bool firstStep)
 		g_game.checkCreatureWalk(getID());
 	}
 
-	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, std::bind(&Game::checkCreatureWalk, &g_game, getID())));
+	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, std::bind(&Game::checkCreatureWalk, &g_game, getID()), TASK_CATEGORY_CREATURE_WALK));
 }
 
 void Creature::stopEventWalk()
@@ -918,6 +918,24 @@ void Creature::getPathSearchParams(const Creature*, FindPathParams& fpp) const
 	fpp.maxTargetDist = 1;
 }
 
+bool Creature::getFollowPathSearch(uint32_t interval, FindPathParams& fpp) const
+{
+	if (!followCreature || (!isMapLoaded && useCacheMap())) {
+		return false;
+	}
+
+	if (master != followCreature && !canSeeCreature(followCreature)) {
+		return false;
+	}
+
+	if (!isUpdatingPath && !forceUpdateFollowPath && walkUpdateTicks + interval < 2000) {
+		return false;
+	}
+
+	getPathSearchParams(followCreature, fpp);
+	return true;
+}
+
 void Creature::goToFollowCreature()
 {
 	if (followCreature) {
@@ -953,7 +971,11 @@ void Creature::goToFollowCreature()
 			}
 		} else {
 			listWalkDir.clear();
-			if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+
+			// melee monsters chasing the same target share its flow field instead of searching one path each
+			bool sharedPath = monster && !monster->getMaster() && fpp.maxTargetDist <= 1 &&
+				g_game.map.flowFields.getPathTo(g_game.map, *this, *followCreature, listWalkDir);
+			if (sharedPath || getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
 				hasFollowPath = true;
 				startAutoWalk(listWalkDir);
 			} else {
@@ -1153,7 +1175,7 @@ void Creature::onGainExperience(uint64_t gainExp, Creature* target)
 	master->onGainExperience(gainExp, target);
 
 	if (!m->isPet()) {
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, position, false, true);
 		if (spectators.empty()) {
 			return;
@@ -85,6 +85,10 @@ class FrozenPathingConditionCall
 		bool isInRange(const Position& startPos, const Position& testPos,
 		               const FindPathParams& fpp) const;
 
+		const Position& getTargetPos() const {
+			return targetPos;
+		}
+
 	private:
 		Position targetPos;
 };
@@ -290,6 +294,8 @@ class Creature : virtual public Thing
 		void addEventWalk(bool firstStep = false);
 		void stopEventWalk();
 		virtual void goToFollowCreature();
+		// the follow path search the next onThink will start, false when it will not search one
+		bool getFollowPathSearch(uint32_t interval, FindPathParams& fpp) const;
 
 		//walk events
 		virtual void onWalk(Direction& dir);
@@ -562,6 +568,8 @@ class Creature : virtual public Thing
 		uint32_t blockCount = 0;
 		uint32_t blockTicks = 0;
 		uint32_t lastStepCost = 1;
+		// slot in Game::checkCreatureLists[checkCreatureBucket] while inCheckCreaturesVector
+		uint32_t checkCreatureIndex = 0;
 		uint32_t baseSpeed = 220;
 		uint32_t mana = 0;
 		int32_t varSpeed = 0;
@@ -570,6 +578,7 @@ class Creature : virtual public Thing
 
 		uint16_t manaShield = 0;
 		uint16_t maxManaShield = 0;
+		uint8_t checkCreatureBucket = 0;
 		int32_t varBuffs[BUFF_LAST + 1] = { 100, 100 };
 
 		Outfit_t currentOutfit;
@@ -625,6 +634,7 @@ class Creature : virtual public Thing
 
 		friend class Game;
 		friend class Map;
+		friend class ThinkPlanner;
 		friend class LuaScriptInterface;
 };
 
@@ -26,30 +26,57 @@
 
 extern ConfigManager g_config;
 
-Database::~Database()
-{
-	if (handle != nullptr) {
+// a pooled connection together with the statements prepared on it
+struct DBConnection {
+	explicit DBConnection(MYSQL* handle) : handle(handle) {}
+	~DBConnection() {
+		// statements have to be closed before their connection
+		statements.clear();
 		mysql_close(handle);
 	}
+
+	MYSQL* handle;
+	std::unordered_map<std::string, std::unique_ptr<DBStatement>> statements;
+};
+
+namespace {
+
+bool isConnectionError(unsigned int error)
+{
+	return error == CR_SERVER_LOST || error == CR_SERVER_GONE_ERROR || error == CR_CONN_HOST_ERROR || error == 1053/*ER_SERVER_SHUTDOWN*/ || error == CR_CONNECTION_ERROR;
+}
+
 }
 
+Database::Database() = default;
+Database::~Database() = default;
+
 bool Database::connect()
 {
-	// connection handle initialization
-	handle = mysql_init(nullptr);
-	if (!handle) {
-		SPDLOG_ERROR("Failed to initialize MySQL connection handle");
-		return false;
-	}
-
-	// automatic reconnect
-	bool reconnect = true;
-	mysql_options(handle, MYSQL_OPT_RECONNECT, &reconnect);
+	return connect(g_config.getString(ConfigManager::MYSQL_HOST).c_str(), g_config.getString(ConfigManager::MYSQL_USER).c_str(), g_config.getString(ConfigManager::MYSQL_PASS).c_str(), g_config.getString(ConfigManager::MYSQL_DB).c_str(), g_config.getNumber(ConfigManager::SQL_PORT), g_config.getString(ConfigManager::MYSQL_SOCK).c_str());
+}
 
-	// connects to database
-	if (!mysql_real_connect(handle, g_config.getString(ConfigManager::MYSQL_HOST).c_str(), g_config.getString(ConfigManager::MYSQL_USER).c_str(), g_config.getString(ConfigManager::MYSQL_PASS).c_str(), g_config.getString(ConfigManager::MYSQL_DB).c_str(), g_config.getNumber(ConfigManager::SQL_PORT), g_config.getString(ConfigManager::MYSQL_SOCK).c_str(), 0)) {
-		SPDLOG_ERROR("Message: {}", mysql_error(handle));
-		return false;
+bool Database::connect(const char *host, const char *user, const char *password,
+                      const char *database, uint32_t port, const char *sock) {
+	MYSQL* handle;
+	{
+		std::lock_guard<std::mutex> lockClass(poolLock);
+		this->host = host ? host : "";
+		this->user = user ? user : "";
+		this->password = password ? password : "";
+		this->database = database ? database : "";
+		this->sock = sock ? sock : "";
+		this->port = port;
+		configured = true;
+
+		// reconnecting replaces the connection of the calling thread
+		connections.erase(std::this_thread::get_id());
+
+		handle = openConnection();
+		if (!handle) {
+			return false;
+		}
+		connections[std::this_thread::get_id()] = std::make_unique<DBConnection>(handle);
 	}
 
 	DBResult_ptr result = storeQuery("SHOW VARIABLES LIKE 'max_allowed_packet'");
@@ -59,14 +86,13 @@ bool Database::connect()
 	return true;
 }
 
-bool Database::connect(const char *host, const char *user, const char *password,
-                      const char *database, uint32_t port, const char *sock) {
+MYSQL* Database::openConnection() const
+{
 	// connection handle initialization
-	handle = mysql_init(nullptr);
+	MYSQL* handle = mysql_init(nullptr);
 	if (!handle) {
-		std::cout << std::endl << "Failed to initialize MySQL connection handle."
-              << std::endl;
-		return false;
+		SPDLOG_ERROR("Failed to initialize MySQL connection handle");
+		return nullptr;
 	}
 
 	// automatic reconnect
@@ -74,32 +100,68 @@ bool Database::connect(const char *host, const char *user, const char *password,
 	mysql_options(handle, MYSQL_OPT_RECONNECT, &reconnect);
 
 	// connects to database
-	if (!mysql_real_connect(handle, host, user, password, database, port, sock,
-                          0)) {
-		std::cout << std::endl << "MySQL Error Message: " << mysql_error(handle)
-              << std::endl;
-		return false;
+	if (!mysql_real_connect(handle, host.c_str(), user.c_str(), password.c_str(), database.c_str(), port, sock.empty() ? nullptr : sock.c_str(), 0)) {
+		SPDLOG_ERROR("Message: {}", mysql_error(handle));
+		mysql_close(handle);
+		return nullptr;
 	}
+	return handle;
+}
 
-	DBResult_ptr result = storeQuery("SHOW VARIABLES LIKE 'max_allowed_packet'");
-	if (result) {
-		maxPacketSize = result->getNumber<uint64_t>("Value");
+DBConnection* Database::getConnection() const
+{
+	std::lock_guard<std::mutex> lockClass(poolLock);
+	auto it = connections.find(std::this_thread::get_id());
+	if (it != connections.end()) {
+		return it->second.get();
 	}
-	return true;
+
+	if (!configured) {
+		return nullptr;
+	}
+
+	std::unique_ptr<DBConnection> connection;
+	if (!idleConnections.empty()) {
+		connection = std::move(idleConnections.back());
+		idleConnections.pop_back();
+	} else if (MYSQL* handle = openConnection()) {
+		connection = std::make_unique<DBConnection>(handle);
+	} else {
+		return nullptr;
+	}
+
+	DBConnection* lent = connection.get();
+	connections[std::this_thread::get_id()] = std::move(connection);
+	return lent;
 }
 
-bool Database::beginTransaction()
+MYSQL* Database::getHandle() const
 {
-	if (!executeQuery("BEGIN")) {
-		return false;
+	DBConnection* connection = getConnection();
+	return connection ? connection->handle : nullptr;
+}
+
+void Database::releaseConnection()
+{
+	std::lock_guard<std::mutex> lockClass(poolLock);
+	auto it = connections.find(std::this_thread::get_id());
+	if (it == connections.end()) {
+		return;
 	}
 
-	databaseLock.lock();
-	return true;
+	idleConnections.push_back(std::move(it->second));
+	connections.erase(it);
+	mysql_thread_end();
+}
+
+bool Database::beginTransaction()
+{
+	return executeQuery("BEGIN");
 }
 
 bool Database::rollback()
 {
+	MYSQL* handle = getHandle();
   if (!handle) {
     std::cout << std::endl << "Database not initialized!" << std::endl;
     return false;
@@ -107,16 +169,14 @@ bool Database::rollback()
 
 	if (mysql_rollback(handle) != 0) {
 		SPDLOG_ERROR("Message: {}", mysql_error(handle));
-		databaseLock.unlock();
 		return false;
 	}
-
-	databaseLock.unlock();
 	return true;
 }
 
 bool Database::commit()
 {
+	MYSQL* handle = getHandle();
   if (!handle) {
     std::cout << std::endl << "Database not initialized!" << std::endl;
     return false;
@@ -124,16 +184,14 @@ bool Database::commit()
 
 	if (mysql_commit(handle) != 0) {
 		SPDLOG_ERROR("Message: {}", mysql_error(handle));
-		databaseLock.unlock();
 		return false;
 	}
-
-	databaseLock.unlock();
 	return true;
 }
 
 bool Database::executeQuery(const std::string& query)
 {
+	MYSQL* handle = getHandle();
   if (!handle) {
     std::cout << std::endl << "Database not initialized!" << std::endl;
     return false;
@@ -142,13 +200,10 @@ bool Database::executeQuery(const std::string& query)
 	bool success = true;
 
 	// executes the query
-	databaseLock.lock();
-
 	while (mysql_real_query(handle, query.c_str(), query.length()) != 0) {
 		SPDLOG_ERROR("Query: {}", query.substr(0, 256));
 		SPDLOG_ERROR("Message: {}", mysql_error(handle));
-		auto error = mysql_errno(handle);
-		if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
+		if (!isConnectionError(mysql_errno(handle))) {
 			success = false;
 			break;
 		}
@@ -156,8 +211,6 @@ bool Database::executeQuery(const std::string& query)
 	}
 
 	MYSQL_RES* m_res = mysql_store_result(handle);
-	databaseLock.unlock();
-
 	if (m_res) {
 		mysql_free_result(m_res);
 	}
@@ -167,19 +220,17 @@ bool Database::executeQuery(const std::string& query)
 
 DBResult_ptr Database::storeQuery(const std::string& query)
 {
+	MYSQL* handle = getHandle();
   if (!handle) {
     std::cout << std::endl << "Database not initialized!" << std::endl;
     return nullptr;
   }
 
-	databaseLock.lock();
-
 	retry:
 	while (mysql_real_query(handle, query.c_str(), query.length()) != 0) {
 		SPDLOG_ERROR("Query: {}", query);
 		SPDLOG_ERROR("Message: {}", mysql_error(handle));
-		auto error = mysql_errno(handle);
-		if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
+		if (!isConnectionError(mysql_errno(handle))) {
 			break;
 		}
 		std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -191,14 +242,11 @@ DBResult_ptr Database::storeQuery(const std::string& query)
 	if (res == nullptr) {
 		SPDLOG_ERROR("Query: {}", query);
 		SPDLOG_ERROR("Message: {}", mysql_error(handle));
-		auto error = mysql_errno(handle);
-		if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
-			databaseLock.unlock();
+		if (!isConnectionError(mysql_errno(handle))) {
 			return nullptr;
 		}
 		goto retry;
 	}
-	databaseLock.unlock();
 
 	// retrieving results of query
 	DBResult_ptr result = std::make_shared<DBResult>(res);
@@ -208,6 +256,27 @@ DBResult_ptr Database::storeQuery(const std::string& query)
 	return result;
 }
 
+DBStatement* Database::prepare(const std::string& query)
+{
+	DBConnection* connection = getConnection();
+  if (!connection) {
+    std::cout << std::endl << "Database not initialized!" << std::endl;
+    return nullptr;
+  }
+
+	// only the thread the connection is lent to touches its statements
+	auto it = connection->statements.find(query);
+	if (it != connection->statements.end()) {
+		return it->second.get();
+	}
+
+	auto statement = std::make_unique<DBStatement>(connection->handle, query);
+	if (!statement->prepare()) {
+		return nullptr;
+	}
+	return connection->statements.emplace(query, std::move(statement)).first->second.get();
+}
+
 std::string Database::escapeString(const std::string& s) const
 {
 	return escapeBlob(s.c_str(), s.length());
@@ -222,7 +291,8 @@ std::string Database::escapeBlob(const char* s, uint32_t length) const
 	escaped.reserve(maxLength + 2);
 	escaped.push_back('\'');
 
-	if (length != 0) {
+	MYSQL* handle = getHandle();
+	if (length != 0 && handle) {
 		char* output = new char[maxLength];
 		mysql_real_escape_string(handle, output, s, length);
 		escaped.append(output);
@@ -306,15 +376,296 @@ bool DBResult::next()
 	return row != nullptr;
 }
 
+DBStatement::DBStatement(MYSQL* handle, std::string query) : handle(handle), query(std::move(query)) {}
+
+DBStatement::~DBStatement()
+{
+	if (statement) {
+		mysql_stmt_close(statement);
+	}
+}
+
+bool DBStatement::prepare()
+{
+	if (statement) {
+		mysql_stmt_close(statement);
+	}
+
+	statement = mysql_stmt_init(handle);
+	if (!statement) {
+		lastError = mysql_errno(handle);
+		SPDLOG_ERROR("Failed to initialize MySQL statement handle");
+		return false;
+	}
+
+	if (mysql_stmt_prepare(statement, query.c_str(), query.length()) != 0) {
+		lastError = mysql_stmt_errno(statement);
+		SPDLOG_ERROR("Query: {}", query);
+		SPDLOG_ERROR("Message: {}", mysql_stmt_error(statement));
+		mysql_stmt_close(statement);
+		statement = nullptr;
+		return false;
+	}
+
+	// lets storeQuery size the buffers of text and blob columns to their longest value
+	bool updateMaxLength = true;
+	mysql_stmt_attr_set(statement, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+
+	parameters.resize(mysql_stmt_param_count(statement));
+
+	auto resultColumns = std::make_shared<DBColumns>();
+	if (MYSQL_RES* metadata = mysql_stmt_result_metadata(statement)) {
+		const unsigned int fieldCount = mysql_num_fields(metadata);
+		const MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+		for (unsigned int i = 0; i < fieldCount; ++i) {
+			const MYSQL_FIELD& field = fields[i];
+			bool integer;
+			switch (field.type) {
+				case MYSQL_TYPE_TINY:
+				case MYSQL_TYPE_SHORT:
+				case MYSQL_TYPE_INT24:
+				case MYSQL_TYPE_LONG:
+				case MYSQL_TYPE_LONGLONG:
+				case MYSQL_TYPE_YEAR:
+					integer = true;
+					break;
+				default:
+					integer = false;
+					break;
+			}
+			resultColumns->list.push_back({field.name, integer, (field.flags & UNSIGNED_FLAG) != 0});
+			resultColumns->indexes.emplace(field.name, i);
+		}
+		mysql_free_result(metadata);
+	}
+	columns = std::move(resultColumns);
+	return true;
+}
+
+void DBStatement::bindNumber(size_t index, uint64_t value, bool isUnsigned)
+{
+	if (index >= parameters.size()) {
+		SPDLOG_ERROR("[DBStatement::bind] - Parameter {} out of range for query: {}", index, query);
+		return;
+	}
+
+	Parameter& parameter = parameters[index];
+	parameter.type = MYSQL_TYPE_LONGLONG;
+	parameter.number = value;
+	parameter.isUnsigned = isUnsigned;
+}
+
+void DBStatement::bindBytes(size_t index, const char* data, size_t length, enum_field_types type)
+{
+	if (index >= parameters.size()) {
+		SPDLOG_ERROR("[DBStatement::bind] - Parameter {} out of range for query: {}", index, query);
+		return;
+	}
+
+	Parameter& parameter = parameters[index];
+	parameter.type = type;
+	parameter.bytes.assign(data, length);
+	parameter.length = length;
+}
+
+bool DBStatement::run()
+{
+	while (true) {
+		if (statement) {
+			std::vector<MYSQL_BIND> binds(parameters.size());
+			for (size_t i = 0; i < parameters.size(); ++i) {
+				Parameter& parameter = parameters[i];
+				MYSQL_BIND& bind = binds[i];
+				bind.buffer_type = parameter.type;
+				if (parameter.type == MYSQL_TYPE_LONGLONG) {
+					bind.buffer = &parameter.number;
+					bind.is_unsigned = parameter.isUnsigned;
+				} else if (parameter.type != MYSQL_TYPE_NULL) {
+					bind.buffer = &parameter.bytes[0];
+					bind.buffer_length = parameter.length;
+					bind.length = &parameter.length;
+				}
+			}
+
+			if (mysql_stmt_bind_param(statement, binds.data()) == 0 && mysql_stmt_execute(statement) == 0) {
+				return true;
+			}
+
+			lastError = mysql_stmt_errno(statement);
+			SPDLOG_ERROR("Query: {}", query.substr(0, 256));
+			SPDLOG_ERROR("Message: {}", mysql_stmt_error(statement));
+		}
+
+		// statements do not survive a reconnect, so they are prepared again once the server is back
+		if (isConnectionError(lastError)) {
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+		} else if (lastError != 1243/*ER_UNKNOWN_STMT_HANDLER*/) {
+			return false;
+		}
+		prepare();
+	}
+}
+
+bool DBStatement::execute()
+{
+	if (!run()) {
+		return false;
+	}
+
+	mysql_stmt_free_result(statement);
+	return true;
+}
+
+DBStatementResult_ptr DBStatement::storeQuery()
+{
+	if (!run()) {
+		return nullptr;
+	}
+
+	if (mysql_stmt_store_result(statement) != 0) {
+		SPDLOG_ERROR("Query: {}", query);
+		SPDLOG_ERROR("Message: {}", mysql_stmt_error(statement));
+		return nullptr;
+	}
+
+	auto result = std::make_shared<DBStatementResult>(columns);
+	const size_t columnCount = columns->list.size();
+	result->rowCount = mysql_stmt_num_rows(statement);
+	if (result->rowCount == 0 || columnCount == 0) {
+		mysql_stmt_free_result(statement);
+		return nullptr;
+	}
+
+	using NullFlag = std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type;
+	std::vector<MYSQL_BIND> binds(columnCount);
+	std::vector<uint64_t> numbers(columnCount);
+	std::vector<unsigned long> lengths(columnCount);
+	std::unique_ptr<NullFlag[]> nulls(new NullFlag[columnCount]());
+	std::vector<std::string> buffers(columnCount);
+
+	MYSQL_RES* metadata = mysql_stmt_result_metadata(statement);
+	const MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+	for (size_t i = 0; i < columnCount; ++i) {
+		MYSQL_BIND& bind = binds[i];
+		if (columns->list[i].integer) {
+			bind.buffer_type = MYSQL_TYPE_LONGLONG;
+			bind.buffer = &numbers[i];
+			bind.is_unsigned = columns->list[i].isUnsigned;
+		} else {
+			buffers[i].resize(std::max<unsigned long>(fields[i].max_length, 1));
+			bind.buffer_type = MYSQL_TYPE_BLOB;
+			bind.buffer = &buffers[i][0];
+			bind.buffer_length = buffers[i].size();
+		}
+		bind.length = &lengths[i];
+		bind.is_null = &nulls[i];
+	}
+	mysql_free_result(metadata);
+
+	if (mysql_stmt_bind_result(statement, binds.data()) != 0) {
+		SPDLOG_ERROR("Query: {}", query);
+		SPDLOG_ERROR("Message: {}", mysql_stmt_error(statement));
+		mysql_stmt_free_result(statement);
+		return nullptr;
+	}
+
+	result->values.reserve(result->rowCount * columnCount);
+	while (true) {
+		const int status = mysql_stmt_fetch(statement);
+		if (status != 0 && status != MYSQL_DATA_TRUNCATED) {
+			break;
+		}
+
+		for (size_t i = 0; i < columnCount; ++i) {
+			DBStatementResult::Value value = {numbers[i], result->bytes.size(), 0, nulls[i] != 0};
+			if (!columns->list[i].integer && !value.null) {
+				value.length = std::min<unsigned long>(lengths[i], buffers[i].size());
+				result->bytes.append(buffers[i], 0, value.length);
+			}
+			result->values.push_back(value);
+		}
+	}
+	mysql_stmt_free_result(statement);
+
+	result->rowCount = result->values.size() / columnCount;
+	if (result->rowCount == 0) {
+		return nullptr;
+	}
+	return result;
+}
+
+size_t DBStatement::getColumnIndex(const std::string& name) const
+{
+	if (!columns) {
+		return std::numeric_limits<size_t>::max();
+	}
+
+	auto it = columns->indexes.find(name);
+	return it != columns->indexes.end() ? it->second : std::numeric_limits<size_t>::max();
+}
+
+const DBStatementResult::Value* DBStatementResult::getValue(size_t column) const
+{
+	if (column >= columns->list.size()) {
+		SPDLOG_ERROR("[DBStatementResult::getValue] - Column {} doesn't exist in the result set", column);
+		return nullptr;
+	}
+	return &values[row * columns->list.size() + column];
+}
+
+size_t DBStatementResult::getColumnIndex(const std::string& name) const
+{
+	auto it = columns->indexes.find(name);
+	if (it == columns->indexes.end()) {
+		SPDLOG_ERROR("[DBStatementResult::getColumnIndex] - Column '{}' doesn't exist in the result set", name);
+		return std::numeric_limits<size_t>::max();
+	}
+	return it->second;
+}
+
+std::string DBStatementResult::getString(size_t column) const
+{
+	const Value* value = getValue(column);
+	if (!value || value->null) {
+		return std::string();
+	}
+
+	if (columns->list[column].integer) {
+		if (columns->list[column].isUnsigned) {
+			return std::to_string(value->number);
+		}
+		return std::to_string(static_cast<int64_t>(value->number));
+	}
+	return bytes.substr(value->offset, value->length);
+}
+
+const char* DBStatementResult::getStream(size_t column, unsigned long& size) const
+{
+	const Value* value = getValue(column);
+	if (!value || value->null || columns->list[column].integer) {
+		size = 0;
+		return nullptr;
+	}
+
+	size = value->length;
+	return bytes.data() + value->offset;
+}
+
 DBInsert::DBInsert(std::string insertQuery) : query(std::move(insertQuery))
 {
 	this->length = this->query.length();
 }
 
+DBInsert::DBInsert(std::string insertQuery, std::vector<std::string>& statementList) : DBInsert(std::move(insertQuery))
+{
+	statements = &statementList;
+}
+
 bool DBInsert::addRow(const std::string& row)
 {
 	// adds new row to buffer
 	const size_t rowLength = row.length();
+	++rows;
 	length += rowLength;
 	if (length > Database::getInstance().getMaxPacketSize() && !execute()) {
 		return false;
@@ -335,6 +686,12 @@ bool DBInsert::addRow(const std::string& row)
 	return true;
 }
 
+void DBInsert::setUpsert(std::string clause)
+{
+	upsert = std::move(clause);
+	length = query.length() + upsert.length();
+}
+
 bool DBInsert::addRow(std::ostringstream& row)
 {
 	bool ret = addRow(row.str());
@@ -349,8 +706,13 @@ bool DBInsert::execute()
 	}
 
 	// executes buffer
-	bool res = Database::getInstance().executeQuery(query + values);
+	bool res = true;
+	if (statements) {
+		statements->push_back(query + values + upsert);
+	} else {
+		res = Database::getInstance().executeQuery(query + values + upsert);
+	}
 	values.clear();
-	length = query.length();
+	length = query.length() + upsert.length();
 	return res;
 }
@@ -25,15 +25,21 @@
 #include <memory>
 #include <mutex>
 #include <map>
+#include <thread>
+#include <unordered_map>
 #include <iostream>
 
 class DBResult;
 using DBResult_ptr = std::shared_ptr<DBResult>;
+class DBStatement;
+class DBStatementResult;
+using DBStatementResult_ptr = std::shared_ptr<DBStatementResult>;
+struct DBConnection;
 
 class Database
 {
 	public:
-		Database() = default;
+		Database();
 		~Database();
 
 		// non-copyable
@@ -54,6 +60,9 @@ class Database
 		/**
 		 * Connects to the database
 		 *
+		 * Every thread that runs a query afterwards is lent a connection of its own
+		 * from the pool, opened with the same parameters.
+		 *
 		 * @return true on successful connection, false on error
 		 */
 		bool connect();
@@ -92,6 +101,17 @@ class Database
 		 */
 		DBResult_ptr storeQuery(const std::string& query);
 
+		/**
+		 * Prepared statement.
+		 *
+		 * Prepares query on the connection of the calling thread the first time
+		 * it is asked for and hands out the same statement afterwards.
+		 *
+		 * @param query command with ? placeholders for the parameters
+		 * @return statement (nullptr on error)
+		 */
+		DBStatement* prepare(const std::string& query);
+
 		/**
 		 * Escapes string for query.
 		 *
@@ -119,7 +139,8 @@ class Database
 		 * @return id on success, 0 if last query did not result on any rows with auto_increment keys
 		 */
 		uint64_t getLastInsertId() const {
-			return static_cast<uint64_t>(mysql_insert_id(handle));
+			MYSQL* handle = getHandle();
+			return handle ? static_cast<uint64_t>(mysql_insert_id(handle)) : 0;
 		}
 
 		/**
@@ -135,6 +156,14 @@ class Database
 			return maxPacketSize;
 		}
 
+		/**
+		 * Returns the connection of the calling thread to the pool.
+		 *
+		 * Threads that query the database call it before they end, so the next
+		 * thread reuses the connection instead of opening another one.
+		 */
+		void releaseConnection();
+
 	private:
 		/**
 		 * Transaction related methods.
@@ -147,9 +176,23 @@ class Database
 		bool rollback();
 		bool commit();
 
+		// the connection lent to the calling thread, opened on its first query
+		DBConnection* getConnection() const;
+		MYSQL* getHandle() const;
+		MYSQL* openConnection() const;
+
 	private:
-		MYSQL* handle = nullptr;
-		std::recursive_mutex databaseLock;
+		std::string host;
+		std::string user;
+		std::string password;
+		std::string database;
+		std::string sock;
+		uint32_t port = 0;
+		bool configured = false;
+
+		mutable std::mutex poolLock;
+		mutable std::unordered_map<std::thread::id, std::unique_ptr<DBConnection>> connections;
+		mutable std::vector<std::unique_ptr<DBConnection>> idleConnections;
 		uint64_t maxPacketSize = 1048576;
 
 	friend class DBTransaction;
@@ -217,6 +260,162 @@ class DBResult
 	friend class Database;
 };
 
+// columns of a prepared statement's results, resolved once when it is prepared
+struct DBColumns {
+	struct Column {
+		std::string name;
+		// integer columns are fetched as 64 bit numbers, everything else as bytes
+		bool integer;
+		bool isUnsigned;
+	};
+
+	std::vector<Column> list;
+	std::unordered_map<std::string, size_t> indexes;
+};
+
+class DBStatement
+{
+	public:
+		DBStatement(MYSQL* handle, std::string query);
+		~DBStatement();
+
+		// non-copyable
+		DBStatement(const DBStatement&) = delete;
+		DBStatement& operator=(const DBStatement&) = delete;
+
+		bool prepare();
+
+		/**
+		 * Binds the parameter at position index, counting from 0.
+		 *
+		 * Parameters keep their value until they are bound again.
+		 */
+		template<typename T>
+		void bind(size_t index, T value)
+		{
+			static_assert(std::is_integral<T>::value, "numbers are bound as integers, text with bind(size_t, const std::string&)");
+			bindNumber(index, static_cast<uint64_t>(value), std::is_unsigned<T>::value);
+		}
+		void bind(size_t index, const std::string& value) {
+			bindBytes(index, value.data(), value.length(), MYSQL_TYPE_STRING);
+		}
+		void bindBlob(size_t index, const char* data, size_t length) {
+			bindBytes(index, data, length, MYSQL_TYPE_BLOB);
+		}
+
+		/**
+		 * Executes the statement with the bound parameters.
+		 *
+		 * @return true on success, false on error
+		 */
+		bool execute();
+
+		/**
+		 * Executes the statement with the bound parameters and fetches every row.
+		 *
+		 * @return results object (nullptr on error or when there are no rows)
+		 */
+		DBStatementResult_ptr storeQuery();
+
+		// position of the column called name in the results, SIZE_MAX when there is none
+		size_t getColumnIndex(const std::string& name) const;
+
+	private:
+		struct Parameter {
+			enum_field_types type = MYSQL_TYPE_NULL;
+			uint64_t number = 0;
+			bool isUnsigned = false;
+			std::string bytes;
+			unsigned long length = 0;
+		};
+
+		void bindNumber(size_t index, uint64_t value, bool isUnsigned);
+		void bindBytes(size_t index, const char* data, size_t length, enum_field_types type);
+		bool run();
+
+		MYSQL* handle;
+		MYSQL_STMT* statement = nullptr;
+		std::string query;
+		std::vector<Parameter> parameters;
+		std::shared_ptr<const DBColumns> columns;
+		unsigned int lastError = 0;
+};
+
+class DBStatementResult
+{
+	public:
+		explicit DBStatementResult(std::shared_ptr<const DBColumns> columns) : columns(std::move(columns)) {}
+
+		// non-copyable
+		DBStatementResult(const DBStatementResult&) = delete;
+		DBStatementResult& operator=(const DBStatementResult&) = delete;
+
+		template<typename T>
+		T getNumber(size_t column) const
+		{
+			const Value* value = getValue(column);
+			if (!value || value->null) {
+				return static_cast<T>(0);
+			}
+
+			if (columns->list[column].integer) {
+				return static_cast<T>(value->number);
+			}
+
+			// decimals and text columns are converted the way DBResult does
+			try {
+				return boost::lexical_cast<T>(bytes.data() + value->offset, value->length);
+			} catch (boost::bad_lexical_cast&) {
+				return static_cast<T>(0);
+			}
+		}
+		template<typename T>
+		T getNumber(const std::string& s) const
+		{
+			return getNumber<T>(getColumnIndex(s));
+		}
+
+		std::string getString(size_t column) const;
+		std::string getString(const std::string& s) const {
+			return getString(getColumnIndex(s));
+		}
+		const char* getStream(size_t column, unsigned long& size) const;
+		const char* getStream(const std::string& s, unsigned long& size) const {
+			return getStream(getColumnIndex(s), size);
+		}
+
+		size_t getColumnIndex(const std::string& name) const;
+
+		size_t countResults() const {
+			return rowCount;
+		}
+		bool hasNext() const {
+			return row < rowCount;
+		}
+		bool next() {
+			return ++row < rowCount;
+		}
+
+	private:
+		struct Value {
+			uint64_t number;
+			// the bytes of text and blob columns, in DBStatementResult::bytes
+			size_t offset;
+			unsigned long length;
+			bool null;
+		};
+
+		const Value* getValue(size_t column) const;
+
+		std::shared_ptr<const DBColumns> columns;
+		std::vector<Value> values;
+		std::string bytes;
+		size_t rowCount = 0;
+		size_t row = 0;
+
+	friend class DBStatement;
+};
+
 /**
  * INSERT statement.
  */
@@ -224,14 +423,26 @@ class DBInsert
 {
 	public:
 		explicit DBInsert(std::string query);
+		// collects the statements in statementList instead of executing them
+		DBInsert(std::string query, std::vector<std::string>& statementList);
 		bool addRow(const std::string& row);
 		bool addRow(std::ostringstream& row);
 		bool execute();
 
+		// appended to every statement, for ON DUPLICATE KEY UPDATE clauses
+		void setUpsert(std::string clause);
+
+		size_t getRowCount() const {
+			return rows;
+		}
+
 	private:
 		std::string query;
 		std::string values;
+		std::string upsert;
 		size_t length;
+		size_t rows = 0;
+		std::vector<std::string>* statements = nullptr;
 };
 
 class DBTransaction
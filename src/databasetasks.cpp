@@ -19,9 +19,11 @@
 
 #include "otpch.h"
 
+#include "configmanager.h"
 #include "databasetasks.h"
 #include "tasks.h"
 
+extern ConfigManager g_config;
 extern Dispatcher g_dispatcher;
 
 DatabaseTasks::DatabaseTasks() {
@@ -39,45 +41,84 @@ bool DatabaseTasks::SetDatabaseInterface(Database *database) {
 
 void DatabaseTasks::start()
 {
-  if (db_ == nullptr) {
-    return;
-  }
-	db_->connect();
-	ThreadHolder::start();
+	startThread(std::max<int32_t>(g_config.getNumber(ConfigManager::DATABASE_WORKER_THREADS), 1));
 }
 
-void DatabaseTasks::startThread()
+void DatabaseTasks::startThread(size_t workerCount/* = 1*/)
 {
 	ThreadHolder::start();
+	for (size_t i = 1; i < workerCount; ++i) {
+		workers.emplace_back(&DatabaseTasks::threadMain, this);
+	}
 }
 
 void DatabaseTasks::threadMain()
 {
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+	std::unique_lock<std::mutex> taskLockUnique(taskLock);
 	while (getState() != THREAD_STATE_TERMINATED) {
-		taskLockUnique.lock();
-		if (tasks.empty()) {
+		auto it = findTask();
+		if (it == tasks.end()) {
 			taskSignal.wait(taskLockUnique);
+			continue;
+		}
+		runNextTask(taskLockUnique, it);
+	}
+	taskLockUnique.unlock();
+
+	if (db_ != nullptr) {
+		db_->releaseConnection();
+	}
+}
+
+std::list<DatabaseTask>::iterator DatabaseTasks::findTask()
+{
+	if (runningKeys.empty()) {
+		return tasks.begin();
+	}
+
+	// nothing starts next to a task without a key
+	if (runningKeys.find(0) != runningKeys.end()) {
+		return tasks.end();
+	}
+
+	// an older task of the same key is either running or found first
+	for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+		if (it->orderKey == 0) {
+			// it waits for the running tasks, and the newer ones wait for it
+			return tasks.end();
 		}
 
-		if (!tasks.empty()) {
-			DatabaseTask task = std::move(tasks.front());
-			tasks.pop_front();
-			taskLockUnique.unlock();
-			runTask(task);
-		} else {
-			taskLockUnique.unlock();
+		if (runningKeys.find(it->orderKey) == runningKeys.end()) {
+			return it;
 		}
 	}
+	return tasks.end();
+}
+
+void DatabaseTasks::runNextTask(std::unique_lock<std::mutex>& taskLockUnique, std::list<DatabaseTask>::iterator it)
+{
+	DatabaseTask task = std::move(*it);
+	tasks.erase(it);
+	runningKeys.insert(task.orderKey);
+	taskLockUnique.unlock();
+
+	runTask(task);
+
+	taskLockUnique.lock();
+	runningKeys.erase(task.orderKey);
+	if (!tasks.empty()) {
+		// tasks held back behind this one can run now
+		taskSignal.notify_all();
+	}
 }
 
-void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/)
+void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/, uint64_t orderKey/* = 0*/)
 {
 	bool signal = false;
 	taskLock.lock();
 	if (getState() == THREAD_STATE_RUNNING) {
-		signal = tasks.empty();
-		tasks.emplace_back(std::move(query), std::move(callback), store);
+		signal = true;
+		tasks.emplace_back(std::move(query), std::move(callback), store, orderKey);
 	}
 	taskLock.unlock();
 
@@ -102,7 +143,7 @@ void DatabaseTasks::runTask(const DatabaseTask& task)
 	}
 
 	if (task.callback) {
-		g_dispatcher.addTask(createTask(std::bind(task.callback, result, success)));
+		g_dispatcher.addTask(createTask(std::bind(task.callback, result, success), TASK_CATEGORY_DATABASE));
 	}
 }
 
@@ -110,11 +151,13 @@ void DatabaseTasks::flush()
 {
 	std::unique_lock<std::mutex> guard{ taskLock };
 	while (!tasks.empty()) {
-		auto task = std::move(tasks.front());
-		tasks.pop_front();
-		guard.unlock();
-		runTask(task);
-		guard.lock();
+		auto it = findTask();
+		if (it == tasks.end()) {
+			// what is left waits for tasks the workers are running
+			taskSignal.wait(guard);
+			continue;
+		}
+		runNextTask(guard, it);
 	}
 }
 
@@ -124,5 +167,16 @@ void DatabaseTasks::shutdown()
 	setState(THREAD_STATE_TERMINATED);
 	taskLock.unlock();
 	flush();
-	taskSignal.notify_one();
+	taskSignal.notify_all();
+}
+
+void DatabaseTasks::join()
+{
+	ThreadHolder::join();
+	for (std::thread& worker : workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+	workers.clear();
 }
@@ -21,38 +21,54 @@
 #define FS_DATABASETASKS_H_9CBA08E9F5FEBA7275CCEE6560059576
 
 #include <condition_variable>
+#include <unordered_set>
 #include "thread_holder_base.h"
 #include "database.h"
 #include "enums.h"
 
+// order keys are player guids, keys of account tasks get this bit so the two never share a key
+static constexpr uint64_t DATABASE_TASK_ACCOUNT_KEY = 1ULL << 32;
+
 struct DatabaseTask {
-	DatabaseTask(std::string&& initQuery, std::function<void(DBResult_ptr, bool)>&& initCallback, bool initStore) :
-		query(std::move(initQuery)), callback(std::move(initCallback)), store(initStore) {}
+	DatabaseTask(std::string&& initQuery, std::function<void(DBResult_ptr, bool)>&& initCallback, bool initStore, uint64_t initOrderKey) :
+		query(std::move(initQuery)), callback(std::move(initCallback)), store(initStore), orderKey(initOrderKey) {}
 
 	std::string query;
 	std::function<void(DBResult_ptr, bool)> callback;
 	bool store;
+	uint64_t orderKey;
 };
 
+/**
+  * Runs queries off the dispatcher on one or more worker threads, each with its own connection.
+  * Tasks with the same order key run one at a time in the order they were added.
+  * Tasks added without a key (key 0) run alone, after every older task and before every newer one.
+  */
 class DatabaseTasks : public ThreadHolder<DatabaseTasks>
 {
 	public:
 		DatabaseTasks();
     bool SetDatabaseInterface(Database *database);
     void start();
-    void startThread();
+    void startThread(size_t workerCount = 1);
     void flush();
     void shutdown();
+    void join();
 
-		void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false);
+		void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false, uint64_t orderKey = 0);
 
 		void threadMain();
 	private:
+		// the oldest task whose key no other thread is running and that no older task without a key holds back,
+		// tasks.end() when there is none
+		std::list<DatabaseTask>::iterator findTask();
+		void runNextTask(std::unique_lock<std::mutex>& taskLockUnique, std::list<DatabaseTask>::iterator it);
 		void runTask(const DatabaseTask& task);
 
 		Database *db_;
-		std::thread thread;
+		std::vector<std::thread> workers;
 		std::list<DatabaseTask> tasks;
+		std::unordered_set<uint64_t> runningKeys;
 		std::mutex taskLock;
 		std::condition_variable taskSignal;
 };
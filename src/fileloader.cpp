@@ -108,6 +108,9 @@ const Node& Loader::parseTree()
 
 bool Loader::getProps(const Node& node, PropStream& props)
 {
+	// one buffer per thread, so nodes of the same tree can be read from several threads
+	static thread_local std::vector<char> propBuffer;
+
 	auto size = std::distance(node.propsBegin, node.propsEnd);
 	if (size == 0) {
 		return false;
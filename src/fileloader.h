@@ -66,7 +66,6 @@ struct InvalidOTBFormat final : LoadError {
 class Loader {
 	MappedFile fileContents;
 	Node root;
-	std::vector<char> propBuffer;
 public:
 	Loader(const std::string& fileName, const Identifier& acceptedIdentifier);
 	bool getProps(const Node& node, PropStream& props);
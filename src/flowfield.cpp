@@ -0,0 +1,261 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "flowfield.h"
+#include "map.h"
+#include "creature.h"
+
+namespace {
+
+struct FlowStep {
+	int32_t x, y;
+	Direction direction;
+};
+
+const FlowStep flowSteps[] = {
+	{0, -1, DIRECTION_NORTH}, {1, 0, DIRECTION_EAST}, {0, 1, DIRECTION_SOUTH}, {-1, 0, DIRECTION_WEST},
+	{-1, 1, DIRECTION_SOUTHWEST}, {1, 1, DIRECTION_SOUTHEAST}, {-1, -1, DIRECTION_NORTHWEST}, {1, -1, DIRECTION_NORTHEAST}
+};
+
+int32_t getStepCost(const FlowStep& step)
+{
+	return step.x != 0 && step.y != 0 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST;
+}
+
+// extra cost of stepping onto the tile for a monster, -1 if its terrain blocks monsters for good
+int32_t getTerrainCost(const Tile* tile)
+{
+	static constexpr uint32_t blockingFlags = TILESTATE_PROTECTIONZONE | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT |
+		TILESTATE_BLOCKSOLID | TILESTATE_IMMOVABLEBLOCKSOLID | TILESTATE_NOFIELDBLOCKPATH | TILESTATE_IMMOVABLENOFIELDBLOCKPATH;
+	if (!tile || tile->hasFlag(blockingFlags)) {
+		return -1;
+	}
+
+	// same penalty AStarNodes::getTileWalkCost gives a monster that is not immune to the field
+	if (tile->getFieldItem()) {
+		return MAP_NORMALWALKCOST * 18;
+	}
+	return 0;
+}
+
+}
+
+
+void FlowField::build(const Map& map, const Position& targetPos)
+{
+	this->targetPos = targetPos;
+	distance.fill(FLOW_FIELD_UNREACHABLE);
+
+	const int32_t startX = targetPos.x - FLOW_FIELD_RADIUS;
+	const int32_t startY = targetPos.y - FLOW_FIELD_RADIUS;
+
+	std::array<int32_t, FLOW_FIELD_SIZE * FLOW_FIELD_SIZE> terrainCost;
+	for (int32_t y = 0; y < FLOW_FIELD_SIZE; ++y) {
+		for (int32_t x = 0; x < FLOW_FIELD_SIZE; ++x) {
+			const int32_t mapX = startX + x;
+			const int32_t mapY = startY + y;
+			if (mapX < 0 || mapY < 0 || mapX > std::numeric_limits<uint16_t>::max() || mapY > std::numeric_limits<uint16_t>::max()) {
+				terrainCost[y * FLOW_FIELD_SIZE + x] = -1;
+			} else {
+				terrainCost[y * FLOW_FIELD_SIZE + x] = getTerrainCost(map.getTile(mapX, mapY, targetPos.z));
+			}
+		}
+	}
+	terrainCost[FLOW_FIELD_RADIUS * FLOW_FIELD_SIZE + FLOW_FIELD_RADIUS] = -1;
+
+	// Dijkstra outwards from the tiles next to the target
+	std::vector<std::pair<int32_t, uint16_t>> open;
+	open.reserve(FLOW_FIELD_SIZE * FLOW_FIELD_SIZE);
+	for (const FlowStep& step : flowSteps) {
+		uint16_t index = (FLOW_FIELD_RADIUS + step.y) * FLOW_FIELD_SIZE + FLOW_FIELD_RADIUS + step.x;
+		if (terrainCost[index] >= 0) {
+			distance[index] = 0;
+			open.emplace_back(0, index);
+		}
+	}
+
+	const auto later = std::greater<std::pair<int32_t, uint16_t>>();
+	std::make_heap(open.begin(), open.end(), later);
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end(), later);
+		const int32_t currentDistance = open.back().first;
+		const uint16_t index = open.back().second;
+		open.pop_back();
+		if (currentDistance != distance[index]) {
+			continue;
+		}
+
+		// a follower on a neighbour pays for the step and for entering this tile
+		const int32_t x = index % FLOW_FIELD_SIZE;
+		const int32_t y = index / FLOW_FIELD_SIZE;
+		const int32_t enterCost = currentDistance + terrainCost[index];
+		for (const FlowStep& step : flowSteps) {
+			const int32_t neighborX = x + step.x;
+			const int32_t neighborY = y + step.y;
+			if (neighborX < 0 || neighborY < 0 || neighborX >= FLOW_FIELD_SIZE || neighborY >= FLOW_FIELD_SIZE) {
+				continue;
+			}
+
+			const uint16_t neighbor = neighborY * FLOW_FIELD_SIZE + neighborX;
+			if (terrainCost[neighbor] < 0) {
+				continue;
+			}
+
+			const int32_t neighborDistance = enterCost + getStepCost(step);
+			if (neighborDistance < distance[neighbor]) {
+				distance[neighbor] = neighborDistance;
+				open.emplace_back(neighborDistance, neighbor);
+				std::push_heap(open.begin(), open.end(), later);
+			}
+		}
+	}
+
+	valid = true;
+}
+
+int32_t FlowField::getIndex(const Position& pos) const
+{
+	if (!contains(pos)) {
+		return -1;
+	}
+	return (pos.y - targetPos.y + FLOW_FIELD_RADIUS) * FLOW_FIELD_SIZE + pos.x - targetPos.x + FLOW_FIELD_RADIUS;
+}
+
+bool FlowField::contains(const Position& pos) const
+{
+	return pos.z == targetPos.z && Position::getDistanceX(pos, targetPos) <= FLOW_FIELD_RADIUS &&
+		Position::getDistanceY(pos, targetPos) <= FLOW_FIELD_RADIUS;
+}
+
+int32_t FlowField::getDistance(const Position& pos) const
+{
+	int32_t index = getIndex(pos);
+	if (index < 0) {
+		return FLOW_FIELD_UNREACHABLE;
+	}
+	return distance[index];
+}
+
+bool FlowField::getPath(const Map& map, const Creature& creature, std::forward_list<Direction>& dirList) const
+{
+	Position pos = creature.getPosition();
+	int32_t currentDistance = getDistance(pos);
+	if (currentDistance == FLOW_FIELD_UNREACHABLE) {
+		return false;
+	}
+
+	std::forward_list<Direction> path;
+	auto last = path.before_begin();
+	while (currentDistance != 0) {
+		// only steps that get strictly closer, so a tile blocked for this creature alone cannot make it walk in circles
+		const FlowStep* bestStep = nullptr;
+		int32_t bestCost = FLOW_FIELD_UNREACHABLE;
+		for (const FlowStep& step : flowSteps) {
+			const Position nextPos(pos.x + step.x, pos.y + step.y, pos.z);
+			const int32_t nextDistance = getDistance(nextPos);
+			if (nextDistance >= currentDistance) {
+				continue;
+			}
+
+			const Tile* tile = map.canWalkTo(creature, nextPos);
+			if (!tile) {
+				continue;
+			}
+
+			const int32_t cost = nextDistance + getStepCost(step) + AStarNodes::getTileWalkCost(creature, tile);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestStep = &step;
+			}
+		}
+
+		if (!bestStep) {
+			return false;
+		}
+
+		last = path.insert_after(last, bestStep->direction);
+		pos = Position(pos.x + bestStep->x, pos.y + bestStep->y, pos.z);
+		currentDistance = getDistance(pos);
+	}
+
+	dirList = std::move(path);
+	return true;
+}
+
+bool FlowFields::getPathTo(const Map& map, const Creature& creature, const Creature& target, std::forward_list<Direction>& dirList)
+{
+	if (!isInRange(creature.getPosition(), target.getPosition())) {
+		return false;
+	}
+	return getField(map, target).getPath(map, creature, dirList);
+}
+
+FlowField* FlowFields::getStaleField(const Creature& target)
+{
+	FlowField& field = getEntry(target);
+	// the planner builds it later, a sweep for another new target must not drop it meanwhile
+	field.lastUsed = OTSYS_TIME();
+	if (!field.valid || field.getTargetPosition() != target.getPosition()) {
+		return &field;
+	}
+	return nullptr;
+}
+
+FlowField& FlowFields::getEntry(const Creature& target)
+{
+	auto it = fields.find(target.getID());
+	if (it != fields.end()) {
+		return it->second;
+	}
+
+	const int64_t now = OTSYS_TIME();
+	for (auto field = fields.begin(); field != fields.end(); ) {
+		if (now - field->second.lastUsed > FLOW_FIELD_EXPIRE_TIME) {
+			field = fields.erase(field);
+		} else {
+			++field;
+		}
+	}
+
+	FlowField& field = fields.emplace(target.getID(), FlowField()).first->second;
+	field.lastUsed = now;
+	return field;
+}
+
+FlowField& FlowFields::getField(const Map& map, const Creature& target)
+{
+	FlowField& field = getEntry(target);
+	if (!field.valid || field.getTargetPosition() != target.getPosition()) {
+		field.build(map, target.getPosition());
+	}
+	field.lastUsed = OTSYS_TIME();
+	return field;
+}
+
+void FlowFields::onTileChange(const Position& pos)
+{
+	for (auto& it : fields) {
+		if (it.second.valid && it.second.contains(pos)) {
+			it.second.valid = false;
+		}
+	}
+}
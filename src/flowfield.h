@@ -0,0 +1,106 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_FLOWFIELD_H_F8A3FDC93D564DB5A713A13A441BD3AD
+#define FS_FLOWFIELD_H_F8A3FDC93D564DB5A713A13A441BD3AD
+
+#include "position.h"
+
+#include <array>
+#include <forward_list>
+#include <limits>
+#include <unordered_map>
+
+class Creature;
+class Map;
+
+static constexpr int32_t FLOW_FIELD_RADIUS = 14;
+static constexpr int32_t FLOW_FIELD_SIZE = FLOW_FIELD_RADIUS * 2 + 1;
+static constexpr int32_t FLOW_FIELD_UNREACHABLE = std::numeric_limits<int32_t>::max();
+// fields of targets nobody chased for this long are dropped
+static constexpr int64_t FLOW_FIELD_EXPIRE_TIME = 10000;
+
+/**
+  * Walk cost from every tile in the window around a target to the tiles next to it.
+  * Built with static terrain only, creatures standing in the way are left to the followers.
+  */
+class FlowField
+{
+	public:
+		void build(const Map& map, const Position& targetPos);
+
+		// cost of walking from pos to a tile next to the target, FLOW_FIELD_UNREACHABLE outside the window
+		int32_t getDistance(const Position& pos) const;
+
+		// steps down the field from the creature position, every step checked with the creature's own walk rules
+		bool getPath(const Map& map, const Creature& creature, std::forward_list<Direction>& dirList) const;
+
+		const Position& getTargetPosition() const {
+			return targetPos;
+		}
+		bool contains(const Position& pos) const;
+
+		bool valid = false;
+		int64_t lastUsed = 0;
+
+	private:
+		int32_t getIndex(const Position& pos) const;
+
+		std::array<int32_t, FLOW_FIELD_SIZE * FLOW_FIELD_SIZE> distance;
+		Position targetPos;
+};
+
+/**
+  * Flow fields shared by all monsters chasing the same target in melee range.
+  * A field is rebuilt when its target moved or a tile in its window changed walkability.
+  */
+class FlowFields
+{
+	public:
+		// false when the follower has to fall back to its own path search
+		bool getPathTo(const Map& map, const Creature& creature, const Creature& target, std::forward_list<Direction>& dirList);
+
+		// the field of target that getPathTo would rebuild before using it, nullptr when it is up to date
+		FlowField* getStaleField(const Creature& target);
+
+		// whether a follower at pos walks down the field of a target at targetPos
+		static bool isInRange(const Position& pos, const Position& targetPos) {
+			return pos.z == targetPos.z && Position::getDistanceX(pos, targetPos) < FLOW_FIELD_RADIUS &&
+				Position::getDistanceY(pos, targetPos) < FLOW_FIELD_RADIUS;
+		}
+
+		// a tile at pos changed walkability
+		void onTileChange(const Position& pos);
+
+		void clear() {
+			fields.clear();
+		}
+		size_t size() const {
+			return fields.size();
+		}
+
+	private:
+		FlowField& getEntry(const Creature& target);
+		FlowField& getField(const Map& map, const Creature& target);
+
+		std::unordered_map<uint32_t, FlowField> fields;
+};
+
+#endif
@@ -31,10 +31,13 @@
 #include "game.h"
 #include "globalevent.h"
 #include "iologindata.h"
+#include "playersaves.h"
+#include "loginqueue.h"
 #include "iomarket.h"
 #include "items.h"
 #include "monster.h"
 #include "movement.h"
+#include "outputmessage.h"
 #include "scheduler.h"
 #include "server.h"
 #include "spells.h"
@@ -158,10 +161,39 @@ void Game::start(ServiceManager* manager)
 	int minutes = tms->tm_min;
 	lightHour = (minutes * LIGHT_DAY_LENGTH) / 60;
 
-	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL_MS, std::bind(&Game::checkLight, this)));
-	g_scheduler.addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, std::bind(&Game::checkCreatures, this, 0)));
-	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, std::bind(&Game::checkDecay, this)));
-	g_scheduler.addEvent(createSchedulerTask(EVENT_IMBUEMENTINTERVAL, std::bind(&Game::checkImbuements, this)));
+	int32_t profilerInterval = g_config.getNumber(ConfigManager::DISPATCHER_PROFILER_INTERVAL);
+	if (profilerInterval > 0) {
+		TaskProfiler::getInstance().startReports(profilerInterval * 1000);
+		ConnectionManager::getInstance().startReports(profilerInterval * 1000);
+		map.pathCache.startReports(profilerInterval * 1000);
+		g_scheduler.addEvent(createSchedulerTask(profilerInterval * 1000, std::bind(&Game::logCreatureThinkReport, this, profilerInterval * 1000, creatureThinks)));
+	}
+
+	int32_t thinkThreads = g_config.getNumber(ConfigManager::CREATURE_THINK_THREADS);
+	if (thinkThreads > 0) {
+		thinkPlanner.start(thinkThreads);
+		SPDLOG_INFO("Creature follow paths searched on {} extra threads", thinkThreads);
+	}
+
+	if (g_config.getBoolean(ConfigManager::GAME_LOOP_TICK_MODE)) {
+		// creatures, decay, imbuements, light and output are all driven by Game::runFrame
+		frameTime = std::max<int32_t>(1, g_config.getNumber(ConfigManager::GAME_LOOP_FRAME_TIME));
+		nextFrame = OTSYS_TIME() + frameTime;
+		lastFrameStart = OTSYS_TIME();
+		lastFrameReport = OTSYS_TIME();
+		creatureThinkElapsed = EVENT_CHECK_CREATURE_INTERVAL - EVENT_CREATURE_THINK_INTERVAL;
+
+		g_dispatcher.setFrameMode(true);
+		OutputMessagePool::getInstance().setAutoSend(false);
+		g_scheduler.addEvent(createSchedulerTask(frameTime, std::bind(&Game::runFrame, this), TASK_CATEGORY_GAME_FRAME));
+		SPDLOG_INFO("Game loop running in tick mode with {} ms frames", frameTime);
+		return;
+	}
+
+	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL_MS, std::bind(&Game::checkLight, this), TASK_CATEGORY_LIGHT));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, std::bind(&Game::checkCreatures, this, 0), TASK_CATEGORY_CREATURES));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, std::bind(&Game::checkDecay, this), TASK_CATEGORY_DECAY));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_IMBUEMENTINTERVAL, std::bind(&Game::checkImbuements, this), TASK_CATEGORY_IMBUEMENTS));
 }
 
 GameState_t Game::getGameState() const
@@ -603,11 +635,16 @@ void Game::saveGameState()
 
 	SPDLOG_INFO("Saving server...");
 
+	const PlayerSaveRows rowsBefore = IOLoginData::getSaveRows();
 	for (const auto& it : players) {
 		it.second->loginPosition = it.second->getPosition();
-		IOLoginData::savePlayer(it.second);
+		IOLoginData::savePlayerAsync(it.second);
 	}
 
+	const PlayerSaveRows rowsAfter = IOLoginData::getSaveRows();
+	SPDLOG_INFO("Saved {} players: {} rows written, {} unchanged rows skipped",
+		players.size(), rowsAfter.written - rowsBefore.written, rowsAfter.skipped - rowsBefore.skipped);
+
   for (const auto& it : guilds) {
     IOGuild::saveGuild(it.second);
   }
@@ -616,6 +653,12 @@ void Game::saveGameState()
 
 	g_databaseTasks.flush();
 
+	const LockfreePoolStats& taskPoolStats = TaskPool::getStats();
+	SPDLOG_INFO("Task pool: {} heap allocations, {} heap releases, {} reused from the shared list",
+		taskPoolStats.heapAllocations.load(std::memory_order_relaxed),
+		taskPoolStats.heapDeallocations.load(std::memory_order_relaxed),
+		taskPoolStats.sharedAllocations.load(std::memory_order_relaxed));
+
 	if (gameState == GAME_STATE_MAINTAIN) {
 		setGameState(GAME_STATE_NORMAL);
 	}
@@ -1014,7 +1057,7 @@ bool Game::placeCreature(Creature* creature, const Position& pos, bool extendedP
 		return false;
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true);
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
@@ -1043,7 +1086,7 @@ bool Game::removeCreature(Creature* creature, bool isLogout/* = true*/)
 
 	std::vector<int32_t> oldStackPosVector;
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, tile->getPosition(), true);
 	for (Creature* spectator : spectators) {
 		if (Player* player = spectator->getPlayer()) {
@@ -2885,7 +2928,7 @@ void Game::playerCloseNpcChannel(uint32_t playerId)
 		return;
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, player->getPosition());
 	for (Creature* spectator : spectators) {
 		if (Npc* npc = spectator->getNpc()) {
@@ -3475,7 +3518,7 @@ void Game::playerSetShowOffSocket(uint32_t playerId, Outfit_t& outfit, const Pos
 	key = "PodiumVisible"; item->setCustomAttribute(key, static_cast<int64_t>(podiumVisible));
 	key = "LookDirection"; item->setCustomAttribute(key, static_cast<int64_t>(direction));
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, pos, true);
 
 	// send to client
@@ -5072,7 +5115,7 @@ bool Game::playerSaySpell(Player* player, SpeakClasses type, const std::string&
 
 void Game::playerWhisper(Player* player, const std::string& text)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, player->getPosition(), false, false,
 				  Map::maxClientViewportX, Map::maxClientViewportX,
 				  Map::maxClientViewportY, Map::maxClientViewportY);
@@ -5145,7 +5188,7 @@ bool Game::playerSpeakTo(Player* player, SpeakClasses type, const std::string& r
 
 void Game::playerSpeakToNpc(Player* player, const std::string& text)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, player->getPosition());
 	for (Creature* spectator : spectators) {
 		if (spectator->getNpc()) {
@@ -5178,7 +5221,7 @@ bool Game::internalCreatureTurn(Creature* creature, Direction dir)
 	creature->setDirection(dir);
 
 	//send to client
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureTurn(creature);
@@ -5187,7 +5230,7 @@ bool Game::internalCreatureTurn(Creature* creature, Direction dir)
 }
 
 bool Game::internalCreatureSay(Creature* creature, SpeakClasses type, const std::string& text,
-							   bool ghostMode, SpectatorHashSet* spectatorsPtr/* = nullptr*/, const Position* pos/* = nullptr*/)
+							   bool ghostMode, SpectatorVec* spectatorsPtr/* = nullptr*/, const Position* pos/* = nullptr*/)
 {
 	if (text.empty()) {
 		return false;
@@ -5197,13 +5240,9 @@ bool Game::internalCreatureSay(Creature* creature, SpeakClasses type, const std:
 		pos = &creature->getPosition();
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 
 	if (!spectatorsPtr || spectatorsPtr->empty()) {
-		// This somewhat complex construct ensures that the cached SpectatorHashSet
-		// is used if available and if it can be used, else a local vector is
-		// used (hopefully the compiler will optimize away the construction of
-		// the temporary when it's not used).
 		if (type != TALKTYPE_YELL && type != TALKTYPE_MONSTER_YELL) {
 			map.getSpectators(spectators, *pos, false, false,
 						  Map::maxClientViewportX, Map::maxClientViewportX,
@@ -5269,42 +5308,195 @@ void Game::addCreatureCheck(Creature* creature)
 	}
 
 	creature->inCheckCreaturesVector = true;
-	checkCreatureLists[uniform_random(0, EVENT_CREATURECOUNT - 1)].push_back(creature);
+	creature->checkCreatureBucket = uniform_random(0, EVENT_CREATURECOUNT - 1);
+
+	auto& checkCreatureList = checkCreatureLists[creature->checkCreatureBucket];
+	creature->checkCreatureIndex = checkCreatureList.size();
+	checkCreatureList.push_back(creature);
 	creature->incrementReferenceCounter();
 }
 
 void Game::removeCreatureCheck(Creature* creature)
 {
-	if (creature->inCheckCreaturesVector) {
-		creature->creatureCheck = false;
+	if (!creature->inCheckCreaturesVector) {
+		return;
+	}
+
+	creature->creatureCheck = false;
+
+	// the bucket being processed drops its creatures itself, so its walk does not skip any
+	if (creature->checkCreatureBucket != thinkingBucket) {
+		eraseCreatureCheck(creature);
+	}
+}
+
+void Game::eraseCreatureCheck(Creature* creature)
+{
+	auto& checkCreatureList = checkCreatureLists[creature->checkCreatureBucket];
+	Creature* last = checkCreatureList.back();
+	checkCreatureList[creature->checkCreatureIndex] = last;
+	last->checkCreatureIndex = creature->checkCreatureIndex;
+	checkCreatureList.pop_back();
+
+	creature->inCheckCreaturesVector = false;
+	ReleaseCreature(creature);
+}
+
+void Game::logCreatureThinkReport(uint32_t interval, uint64_t lastThinks)
+{
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&Game::logCreatureThinkReport, this, interval, creatureThinks)));
+
+	size_t awake = 0;
+	for (const auto& checkCreatureList : checkCreatureLists) {
+		awake += checkCreatureList.size();
 	}
+	SPDLOG_INFO("[Creature think] {:.1f} thinks/s, {} creatures awake, {} monsters in the world",
+		(creatureThinks - lastThinks) * 1000.0 / interval, awake, monsters.size());
 }
 
 void Game::checkCreatures(size_t index)
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, std::bind(&Game::checkCreatures, this, (index + 1) % EVENT_CREATURECOUNT)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, std::bind(&Game::checkCreatures, this, (index + 1) % EVENT_CREATURECOUNT), TASK_CATEGORY_CREATURES));
+	processCreatures(index);
+}
 
+void Game::processCreatures(size_t index)
+{
 	auto& checkCreatureList = checkCreatureLists[index];
-	auto it = checkCreatureList.begin(), end = checkCreatureList.end();
-	while (it != end) {
-		Creature* creature = *it;
+	if (thinkPlanner.isRunning()) {
+		thinkPlanner.plan(map, checkCreatureList, EVENT_CREATURE_THINK_INTERVAL);
+	}
+
+	thinkingBucket = index;
+	size_t i = 0;
+	while (i < checkCreatureList.size()) {
+		Creature* creature = checkCreatureList[i];
 		if (creature->creatureCheck) {
 			if (creature->getHealth() > 0) {
 				creature->onThink(EVENT_CREATURE_THINK_INTERVAL);
 				creature->onAttacking(EVENT_CREATURE_THINK_INTERVAL);
 				creature->executeConditions(EVENT_CREATURE_THINK_INTERVAL);
+				++creatureThinks;
 			}
-			++it;
+			++i;
 		} else {
-			creature->inCheckCreaturesVector = false;
-			it = checkCreatureList.erase(it);
-			ReleaseCreature(creature);
+			// the last creature of the bucket takes its slot and is processed next
+			eraseCreatureCheck(creature);
 		}
 	}
+	thinkingBucket = EVENT_CREATURECOUNT;
 
 	cleanup();
 }
 
+namespace {
+
+// share of the frame time each phase may use before it is reported as an overrun
+constexpr std::array<int32_t, GAME_FRAME_PHASE_LAST> framePhaseBudgets {{40, 30, 10, 5, 5, 10}};
+constexpr std::array<const char*, GAME_FRAME_PHASE_LAST> framePhaseNames {{"packets", "creatures", "decay", "imbuements", "light", "output"}};
+
+}
+
+void Game::runFrame()
+{
+	// fixed rate, if we fell more than a frame behind skip ahead instead of bursting
+	int64_t frameStart = OTSYS_TIME();
+	nextFrame = std::max<int64_t>(nextFrame + frameTime, frameStart);
+	// the timers advance by the time that really passed, but after a stall by no more than a frame,
+	// so creatures think once when late instead of catching up several buckets at once
+	int32_t frameElapsed = static_cast<int32_t>(std::min<int64_t>(frameStart - lastFrameStart, std::max<int64_t>(frameTime, EVENT_CHECK_CREATURE_INTERVAL)));
+	lastFrameStart = frameStart;
+	g_scheduler.addEvent(createSchedulerTask(static_cast<uint32_t>(nextFrame - frameStart), std::bind(&Game::runFrame, this), TASK_CATEGORY_GAME_FRAME));
+
+	auto phaseStart = std::chrono::steady_clock::now();
+	auto frameBegin = phaseStart;
+	auto endPhase = [&](GameFramePhase_t phase) {
+		auto now = std::chrono::steady_clock::now();
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - phaseStart);
+		FramePhaseStats& stats = framePhaseStats[phase];
+		stats.total += elapsed;
+		stats.max = std::max(stats.max, elapsed);
+		if (elapsed.count() > frameTime * 10 * framePhaseBudgets[phase]) {
+			++stats.overruns;
+		}
+		phaseStart = now;
+	};
+
+	// packets and everything else posted to the dispatcher since the last frame,
+	// whatever does not fit into the budget is left for the next frame
+	g_dispatcher.runQueuedTasks(frameStart + (frameTime * framePhaseBudgets[GAME_FRAME_PHASE_PACKETS]) / 100);
+	endPhase(GAME_FRAME_PHASE_PACKETS);
+
+	creatureThinkElapsed += frameElapsed;
+	while (creatureThinkElapsed >= EVENT_CHECK_CREATURE_INTERVAL) {
+		creatureThinkElapsed -= EVENT_CHECK_CREATURE_INTERVAL;
+		processCreatures(creatureThinkIndex);
+		creatureThinkIndex = (creatureThinkIndex + 1) % EVENT_CREATURECOUNT;
+	}
+	endPhase(GAME_FRAME_PHASE_CREATURES);
+
+	decayElapsed += frameElapsed;
+	while (decayElapsed >= EVENT_DECAYINTERVAL) {
+		decayElapsed -= EVENT_DECAYINTERVAL;
+		processDecay();
+	}
+	endPhase(GAME_FRAME_PHASE_DECAY);
+
+	imbuementElapsed += frameElapsed;
+	while (imbuementElapsed >= EVENT_IMBUEMENTINTERVAL) {
+		imbuementElapsed -= EVENT_IMBUEMENTINTERVAL;
+		processImbuements();
+	}
+	endPhase(GAME_FRAME_PHASE_IMBUEMENTS);
+
+	lightElapsed += frameElapsed;
+	while (lightElapsed >= EVENT_LIGHTINTERVAL_MS) {
+		lightElapsed -= EVENT_LIGHTINTERVAL_MS;
+		processLight();
+	}
+	endPhase(GAME_FRAME_PHASE_LIGHT);
+
+	OutputMessagePool::getInstance().sendAll();
+	endPhase(GAME_FRAME_PHASE_OUTPUT);
+
+	++frameCount;
+	if (std::chrono::duration_cast<std::chrono::milliseconds>(phaseStart - frameBegin).count() > frameTime) {
+		++frameOverruns;
+	}
+
+	if (frameStart - lastFrameReport >= GAME_FRAME_REPORT_INTERVAL) {
+		reportFrameStats();
+		lastFrameReport = frameStart;
+	}
+}
+
+void Game::reportFrameStats()
+{
+	if (frameCount == 0) {
+		return;
+	}
+
+	std::ostringstream ss;
+	for (uint8_t phase = 0; phase < GAME_FRAME_PHASE_LAST; ++phase) {
+		const FramePhaseStats& stats = framePhaseStats[phase];
+		ss << ' ' << framePhaseNames[phase] << ' ' << std::fixed << std::setprecision(2)
+			<< (stats.total.count() / 1000.) / frameCount << '/' << stats.max.count() / 1000. << " ms";
+		if (stats.overruns != 0) {
+			ss << " (" << stats.overruns << " over budget)";
+		}
+	}
+
+	if (frameOverruns != 0) {
+		SPDLOG_WARN("[Game::runFrame] - {} of {} frames took longer than {} ms, avg/max per phase:{}", frameOverruns, frameCount, frameTime, ss.str());
+	} else {
+		SPDLOG_INFO("[Game::runFrame] - {} frames, avg/max per phase:{}", frameCount, ss.str());
+	}
+
+	framePhaseStats.fill(FramePhaseStats());
+	frameCount = 0;
+	frameOverruns = 0;
+}
+
 void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 {
 	int32_t varSpeed = creature->getSpeed() - creature->getBaseSpeed();
@@ -5313,7 +5505,7 @@ void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 	creature->setSpeed(varSpeed);
 
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), false, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendChangeSpeed(creature, creature->getStepSpeed());
@@ -5333,7 +5525,7 @@ void Game::internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outf
 	}
 
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureChangeOutfit(creature, outfit);
@@ -5343,7 +5535,7 @@ void Game::internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outf
 void Game::internalCreatureChangeVisible(Creature* creature, bool visible)
 {
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureChangeVisible(creature, visible);
@@ -5353,7 +5545,7 @@ void Game::internalCreatureChangeVisible(Creature* creature, bool visible)
 void Game::changeLight(const Creature* creature)
 {
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureLight(creature);
@@ -5363,7 +5555,7 @@ void Game::changeLight(const Creature* creature)
 void Game::updateCreatureIcon(const Creature* creature)
 {
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureIcon(creature);
@@ -5647,7 +5839,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 			message.primary.value = realHealthChange;
 			message.primary.color = TEXTCOLOR_PASTELRED;
 
-			SpectatorHashSet spectators;
+			SpectatorVec spectators;
 			map.getSpectators(spectators, targetPos, false, true);
 			for (Creature* spectator : spectators) {
 				Player* tmpPlayer = spectator->getPlayer();
@@ -5738,7 +5930,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 			return true;
 		}
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		map.getSpectators(spectators, targetPos, true, true);
 
 		if (damage.critical) {
@@ -6154,7 +6346,7 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 			message.primary.value = realManaChange;
 			message.primary.color = TEXTCOLOR_MAYABLUE;
 
-			SpectatorHashSet spectators;
+			SpectatorVec spectators;
 			map.getSpectators(spectators, targetPos, false, true);
 			for (Creature* spectator : spectators) {
 				Player* tmpPlayer = spectator->getPlayer();
@@ -6255,7 +6447,7 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 		message.primary.value = manaLoss;
 		message.primary.color = TEXTCOLOR_BLUE;
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		map.getSpectators(spectators, targetPos, false, true);
 		for (Creature* spectator : spectators) {
 			Player* tmpPlayer = spectator->getPlayer();
@@ -6309,12 +6501,12 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 
 void Game::addCreatureHealth(const Creature* target)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, target->getPosition(), true, true);
 	addCreatureHealth(spectators, target);
 }
 
-void Game::addCreatureHealth(const SpectatorHashSet& spectators, const Creature* target)
+void Game::addCreatureHealth(const SpectatorVec& spectators, const Creature* target)
 {
 	uint8_t healthPercent = std::ceil((static_cast<double>(target->getHealth()) / std::max<int32_t>(target->getMaxHealth(), 1)) * 100);
 	if (const Player* targetPlayer = target->getPlayer()) {
@@ -6349,7 +6541,7 @@ void Game::addPlayerVocation(const Player* target)
 		party->updatePlayerVocation(target);
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, target->getPosition(), true, true);
 
 	for (Creature* spectator : spectators) {
@@ -6361,12 +6553,12 @@ void Game::addPlayerVocation(const Player* target)
 
 void Game::addMagicEffect(const Position& pos, uint8_t effect)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, pos, true, true);
 	addMagicEffect(spectators, pos, effect);
 }
 
-void Game::addMagicEffect(const SpectatorHashSet& spectators, const Position& pos, uint8_t effect)
+void Game::addMagicEffect(const SpectatorVec& spectators, const Position& pos, uint8_t effect)
 {
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
@@ -6377,13 +6569,13 @@ void Game::addMagicEffect(const SpectatorHashSet& spectators, const Position& po
 
 void Game::addDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, fromPos, false, true);
 	map.getSpectators(spectators, toPos, false, true);
 	addDistanceEffect(spectators, fromPos, toPos, effect);
 }
 
-void Game::addDistanceEffect(const SpectatorHashSet& spectators, const Position& fromPos, const Position& toPos, uint8_t effect)
+void Game::addDistanceEffect(const SpectatorVec& spectators, const Position& fromPos, const Position& toPos, uint8_t effect)
 {
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
@@ -6465,8 +6657,12 @@ void Game::internalDecayItem(Item* item)
 
 void Game::checkDecay()
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, std::bind(&Game::checkDecay, this)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, std::bind(&Game::checkDecay, this), TASK_CATEGORY_DECAY));
+	processDecay();
+}
 
+void Game::processDecay()
+{
 	size_t bucket = (lastBucket + 1) % EVENT_DECAY_BUCKETS;
 
 	auto it = decayItems[bucket].begin(), end = decayItems[bucket].end();
@@ -6509,8 +6705,12 @@ void Game::checkDecay()
 
 void Game::checkImbuements()
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_IMBUEMENTINTERVAL, std::bind(&Game::checkImbuements, this)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_IMBUEMENTINTERVAL, std::bind(&Game::checkImbuements, this), TASK_CATEGORY_IMBUEMENTS));
+	processImbuements();
+}
 
+void Game::processImbuements()
+{
 	size_t bucket = (lastImbuedBucket + 1) % EVENT_IMBUEMENT_BUCKETS;
 
 	auto it = imbuedItems[bucket].begin(), end = imbuedItems[bucket].end();
@@ -6577,8 +6777,12 @@ void Game::checkImbuements()
 
 void Game::checkLight()
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL_MS, std::bind(&Game::checkLight, this)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL_MS, std::bind(&Game::checkLight, this), TASK_CATEGORY_LIGHT));
+	processLight();
+}
 
+void Game::processLight()
+{
 	lightHour += lightHourDelta;
 
 	if (lightHour > LIGHT_DAY_LENGTH) {
@@ -6662,8 +6866,11 @@ void Game::shutdown()
 	SPDLOG_INFO("Shutting down...");
 
 	g_scheduler.shutdown();
+	g_loginQueue.shutdown();
+	g_playerSaves.shutdown();
 	g_databaseTasks.shutdown();
 	g_dispatcher.shutdown();
+	thinkPlanner.shutdown();
 	map.spawns.clear();
 	raids.clear();
 
@@ -6738,7 +6945,7 @@ void Game::broadcastMessage(const std::string& text, MessageClasses type) const
 void Game::updateCreatureWalkthrough(const Creature* creature)
 {
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		Player* tmpPlayer = spectator->getPlayer();
@@ -6752,7 +6959,7 @@ void Game::updateCreatureSkull(const Creature* creature)
 		return;
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureSkull(creature);
@@ -6761,7 +6968,7 @@ void Game::updateCreatureSkull(const Creature* creature)
 
 void Game::updatePlayerShield(Player* player)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, player->getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureShield(player);
@@ -6784,7 +6991,7 @@ void Game::updateCreatureType(Creature* creature)
 	}
 
 	//send to clients
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true, true);
 
 	for (Creature* spectator : spectators) {
@@ -7130,7 +7337,7 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 				} while (result->next());
 				player->sendCyclopediaCharacterRecentDeaths(page, static_cast<uint16_t>(pages), entries);
 			};
-			g_databaseTasks.addTask(std::move(query.str()), callback, true);
+			g_databaseTasks.addTask(std::move(query.str()), callback, true, player->getGUID());
 			player->addAsyncOngoingTask(PlayerAsyncTask_RecentDeaths);
 			break;
 	}
@@ -7183,7 +7390,7 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 				} while (result->next());
 				player->sendCyclopediaCharacterRecentPvPKills(page, static_cast<uint16_t>(pages), entries);
 			};
-			g_databaseTasks.addTask(std::move(query.str()), callback, true);
+			g_databaseTasks.addTask(std::move(query.str()), callback, true, player->getGUID());
 			player->addAsyncOngoingTask(PlayerAsyncTask_RecentPvPKills);
 			break;
 	}
@@ -7297,7 +7504,7 @@ void Game::playerHighscores(Player* player, HighscoreType_t type, uint8_t catego
 		} while (result->next());
 		player->sendHighscores(characters, category, vocation, page, static_cast<uint16_t>(pages));
 	};
-	g_databaseTasks.addTask(std::move(query.str()), callback, true);
+	g_databaseTasks.addTask(std::move(query.str()), callback, true, player->getGUID());
 	player->addAsyncOngoingTask(PlayerAsyncTask_Highscore);
 }
 
@@ -7360,7 +7567,7 @@ void Game::playerNpcGreet(uint32_t playerId, uint32_t npcId)
 
 	Npc* npc = creature->getNpc();
 	if(npc) {
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		spectators.insert(npc);
 		map.getSpectators(spectators, player->getPosition(), true, true);
 		internalCreatureSay(player, TALKTYPE_SAY, "Hi", false, &spectators);
@@ -35,6 +35,7 @@
 #include "wildcardtree.h"
 #include "gamestore.h"
 #include "iobestiary.h"
+#include "thinkplanner.h"
 
 class ServiceManager;
 class Creature;
@@ -73,6 +74,19 @@ static constexpr int32_t EVENT_DECAYINTERVAL = 250;
 static constexpr int32_t EVENT_DECAY_BUCKETS = 4;
 static constexpr int32_t EVENT_IMBUEMENTINTERVAL = 250;
 static constexpr int32_t EVENT_IMBUEMENT_BUCKETS = 4;
+static constexpr int32_t GAME_FRAME_REPORT_INTERVAL = 60000;
+
+// phases of a game frame when the game loop runs in tick mode, in execution order
+enum GameFramePhase_t : uint8_t {
+	GAME_FRAME_PHASE_PACKETS,
+	GAME_FRAME_PHASE_CREATURES,
+	GAME_FRAME_PHASE_DECAY,
+	GAME_FRAME_PHASE_IMBUEMENTS,
+	GAME_FRAME_PHASE_LIGHT,
+	GAME_FRAME_PHASE_OUTPUT,
+
+	GAME_FRAME_PHASE_LAST
+};
 
 /**
   * Main Game class.
@@ -229,7 +243,7 @@ class Game
 		void executeDeath(uint32_t creatureId);
 
 		void addCreatureCheck(Creature* creature);
-		static void removeCreatureCheck(Creature* creature);
+		void removeCreatureCheck(Creature* creature);
 
 		size_t getPlayersOnline() const {
 			return players.size();
@@ -327,7 +341,7 @@ class Game
 		  * \param text The text to say
 		  */
 		bool internalCreatureSay(Creature* creature, SpeakClasses type, const std::string& text,
-								 bool ghostMode, SpectatorHashSet* spectatorsPtr = nullptr, const Position* pos = nullptr);
+								 bool ghostMode, SpectatorVec* spectatorsPtr = nullptr, const Position* pos = nullptr);
 
 		/**
 		  * Player wants to loot a corpse
@@ -519,6 +533,7 @@ class Game
 		void checkCreatureAttack(uint32_t creatureId);
 		void checkCreatures(size_t index);
 		void checkLight();
+		void runFrame();
 
 		bool combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field);
 
@@ -529,13 +544,13 @@ class Game
 
 		//animation help functions
 		void addCreatureHealth(const Creature* target);
-		static void addCreatureHealth(const SpectatorHashSet& spectators, const Creature* target);
+		static void addCreatureHealth(const SpectatorVec& spectators, const Creature* target);
 		void addPlayerMana(const Player* target);
 		void addPlayerVocation(const Player* target);
 		void addMagicEffect(const Position& pos, uint8_t effect);
-		static void addMagicEffect(const SpectatorHashSet& spectators, const Position& pos, uint8_t effect);
+		static void addMagicEffect(const SpectatorVec& spectators, const Position& pos, uint8_t effect);
 		void addDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect);
-		static void addDistanceEffect(const SpectatorHashSet& spectators, const Position& fromPos, const Position& toPos, uint8_t effect);
+		static void addDistanceEffect(const SpectatorVec& spectators, const Position& fromPos, const Position& toPos, uint8_t effect);
 
 		void startImbuementCountdown(Item* item) {
 			item->incrementReferenceCounter();
@@ -660,6 +675,13 @@ class Game
 
 	private:
 		void checkImbuements();
+		void processCreatures(size_t index);
+		void eraseCreatureCheck(Creature* creature);
+		void logCreatureThinkReport(uint32_t interval, uint64_t lastThinks);
+		void processDecay();
+		void processImbuements();
+		void processLight();
+		void reportFrameStats();
 		bool playerSaySpell(Player* player, SpeakClasses type, const std::string& text);
 		void playerWhisper(Player* player, const std::string& text);
 		bool playerYell(Player* player, const std::string& text);
@@ -676,7 +698,11 @@ class Game
 		std::map<uint32_t, uint32_t> stages;
 
 		std::list<Item*> decayItems[EVENT_DECAY_BUCKETS];
-		std::list<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
+		// thinking creatures; idle ones leave their bucket right away and come back when woken
+		std::vector<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
+		size_t thinkingBucket = EVENT_CREATURECOUNT;
+		uint64_t creatureThinks = 0;
+		ThinkPlanner thinkPlanner;
 
 		std::list<Item*> imbuedItems[EVENT_IMBUEMENT_BUCKETS];
 
@@ -690,6 +716,26 @@ class Game
 		size_t lastBucket = 0;
 		size_t lastImbuedBucket = 0;
 
+		struct FramePhaseStats {
+			std::chrono::microseconds total {0};
+			std::chrono::microseconds max {0};
+			uint32_t overruns = 0;
+		};
+
+		// tick mode game loop, see Game::runFrame
+		std::array<FramePhaseStats, GAME_FRAME_PHASE_LAST> framePhaseStats;
+		int64_t frameTime = 0;
+		int64_t nextFrame = 0;
+		int64_t lastFrameStart = 0;
+		int64_t lastFrameReport = 0;
+		uint32_t frameCount = 0;
+		uint32_t frameOverruns = 0;
+		int32_t creatureThinkElapsed = 0;
+		int32_t decayElapsed = 0;
+		int32_t imbuementElapsed = 0;
+		int32_t lightElapsed = 0;
+		size_t creatureThinkIndex = 0;
+
 		WildcardTreeNode wildcardTree { false };
 
 		std::map<uint32_t, Npc*> npcs;
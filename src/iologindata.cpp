@@ -21,6 +21,7 @@
 
 #include <boost/range/adaptor/reversed.hpp>
 #include "iologindata.h"
+#include "playersaves.h"
 #include "configmanager.h"
 #include "game.h"
 #include "scheduler.h"
@@ -153,12 +154,15 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
   return true;
 }
 
-bool IOLoginData::loadPlayerById(Player* player, uint32_t id)
+bool IOLoginData::loadPlayerById(Player* player, uint32_t id, DeferredPlayerLoad* deferred/* = nullptr*/)
 {
+  // a player logging back in reads what the save of the last logout wrote
+  g_playerSaves.waitFor(id);
+
   Database& db = Database::getInstance();
   std::ostringstream query;
   query << "SELECT * FROM `players` WHERE `id` = " << id;
-  return loadPlayer(player, db.storeQuery(query.str()));
+  return loadPlayer(player, db.storeQuery(query.str()), deferred);
 }
 
 // New Prey
@@ -232,38 +236,44 @@ bool IOLoginData::loadPlayerPreyById(Player* player, uint32_t id)
 bool IOLoginData::savePlayerPreyById(Player* player, uint32_t id)
 {
   Database& db = Database::getInstance();
+  std::string insert, update;
+  getPreyTimesQueries(player, id, insert, update);
+
   std::ostringstream querycheck;
-  std::ostringstream query;
   querycheck << "SELECT `bonus_type1` FROM `player_preytimes` WHERE `player_id` = " << id;
-  DBResult_ptr returnQuery = db.storeQuery(querycheck.str());
-
-  if (!returnQuery) {
-    query << "INSERT INTO `player_preytimes` (`player_id`, `bonus_type1`, `bonus_value1`, `bonus_name1`, `bonus_type2`, `bonus_value2`, `bonus_name2`, `bonus_type3`, `bonus_value3`, `bonus_name3`) VALUES (";
-    query << id << ", ";
-    query << player->getPreyType(0) << ", ";
-    query << player->getPreyValue(0) << ", ";
-    query << db.escapeString(player->getPreyName(0)) << ", ";
-    query << player->getPreyType(1) << ", ";
-    query << player->getPreyValue(1) << ", ";
-    query << db.escapeString(player->getPreyName(1)) << ", ";
-    query << player->getPreyType(2) << ", ";
-    query << player->getPreyValue(2) << ", ";
-    query << db.escapeString(player->getPreyName(2)) << ")";
-  } else {
-    query << "UPDATE `player_preytimes` SET ";
-    query << "`bonus_type1` = " << player->getPreyType(0) << ',';
-    query << "`bonus_value1` = " << player->getPreyValue(0) << ',';
-    query << "`bonus_name1` = " << db.escapeString(player->getPreyName(0)) << ',';
-    query << "`bonus_type2` = " << player->getPreyType(1) << ',';
-    query << "`bonus_value2` = " << player->getPreyValue(1) << ',';
-    query << "`bonus_name2` = " << db.escapeString(player->getPreyName(1)) << ',';
-    query << "`bonus_type3` = " << player->getPreyType(2) << ',';
-    query << "`bonus_value3` = " << player->getPreyValue(2) << ',';
-    query << "`bonus_name3` = " << db.escapeString(player->getPreyName(2));
-    query << " WHERE `player_id` = " << id;
-  }
-
-  return db.executeQuery(query.str());
+  return db.executeQuery(db.storeQuery(querycheck.str()) ? update : insert);
+}
+
+void IOLoginData::getPreyTimesQueries(const Player* player, uint32_t id, std::string& insert, std::string& update)
+{
+  Database& db = Database::getInstance();
+  std::ostringstream query;
+  query << "INSERT INTO `player_preytimes` (`player_id`, `bonus_type1`, `bonus_value1`, `bonus_name1`, `bonus_type2`, `bonus_value2`, `bonus_name2`, `bonus_type3`, `bonus_value3`, `bonus_name3`) VALUES (";
+  query << id << ", ";
+  query << player->getPreyType(0) << ", ";
+  query << player->getPreyValue(0) << ", ";
+  query << db.escapeString(player->getPreyName(0)) << ", ";
+  query << player->getPreyType(1) << ", ";
+  query << player->getPreyValue(1) << ", ";
+  query << db.escapeString(player->getPreyName(1)) << ", ";
+  query << player->getPreyType(2) << ", ";
+  query << player->getPreyValue(2) << ", ";
+  query << db.escapeString(player->getPreyName(2)) << ")";
+  insert = query.str();
+
+  query.str(std::string());
+  query << "UPDATE `player_preytimes` SET ";
+  query << "`bonus_type1` = " << player->getPreyType(0) << ',';
+  query << "`bonus_value1` = " << player->getPreyValue(0) << ',';
+  query << "`bonus_name1` = " << db.escapeString(player->getPreyName(0)) << ',';
+  query << "`bonus_type2` = " << player->getPreyType(1) << ',';
+  query << "`bonus_value2` = " << player->getPreyValue(1) << ',';
+  query << "`bonus_name2` = " << db.escapeString(player->getPreyName(1)) << ',';
+  query << "`bonus_type3` = " << player->getPreyType(2) << ',';
+  query << "`bonus_value3` = " << player->getPreyValue(2) << ',';
+  query << "`bonus_name3` = " << db.escapeString(player->getPreyName(2));
+  query << " WHERE `player_id` = " << id;
+  update = query.str();
 }
 
 bool IOLoginData::loadPlayerByName(Player* player, const std::string& name)
@@ -271,10 +281,14 @@ bool IOLoginData::loadPlayerByName(Player* player, const std::string& name)
   Database& db = Database::getInstance();
   std::ostringstream query;
   query << "SELECT * FROM `players` WHERE `name` = " << db.escapeString(name);
-  return loadPlayer(player, db.storeQuery(query.str()));
+  DBResult_ptr result = db.storeQuery(query.str());
+  if (result && g_playerSaves.waitFor(result->getNumber<uint32_t>("id"))) {
+    result = db.storeQuery(query.str());
+  }
+  return loadPlayer(player, result);
 }
 
-bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
+bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result, DeferredPlayerLoad* deferred/* = nullptr*/)
 {
   if (!result) {
     return false;
@@ -457,45 +471,20 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   player->setManaShield(result->getNumber<uint16_t>("manashield"));
   player->setMaxManaShield(result->getNumber<uint16_t>("max_manashield"));
 
+  DeferredPlayerLoad load;
   std::ostringstream query;
   query << "SELECT `guild_id`, `rank_id`, `nick` FROM `guild_membership` WHERE `player_id` = " << player->getGUID();
   if ((result = db.storeQuery(query.str()))) {
-    uint32_t guildId = result->getNumber<uint32_t>("guild_id");
-    uint32_t playerRankId = result->getNumber<uint32_t>("rank_id");
+    load.guildId = result->getNumber<uint32_t>("guild_id");
+    load.guildRankId = result->getNumber<uint32_t>("rank_id");
     player->guildNick = result->getString("nick");
 
-    Guild* guild = g_game.getGuild(guildId);
-    if (!guild) {
-      guild = IOGuild::loadGuild(guildId);
-      g_game.addGuild(guild);
-    }
+    IOGuild::getWarList(load.guildId, load.guildWars);
 
-    if (guild) {
-      player->guild = guild;
-      GuildRank_ptr rank = guild->getRankById(playerRankId);
-      if (!rank) {
-        query.str(std::string());
-        query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = " << playerRankId;
-
-        if ((result = db.storeQuery(query.str()))) {
-          guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
-        }
-
-        rank = guild->getRankById(playerRankId);
-        if (!rank) {
-          player->guild = nullptr;
-        }
-      }
-
-      player->guildRank = rank;
-
-      IOGuild::getWarList(guildId, player->guildWarVector);
-
-      query.str(std::string());
-      query << "SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = " << guildId;
-      if ((result = db.storeQuery(query.str()))) {
-        guild->setMemberCount(result->getNumber<uint32_t>("members"));
-      }
+    query.str(std::string());
+    query << "SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = " << load.guildId;
+    if ((result = db.storeQuery(query.str()))) {
+      load.guildMemberCount = result->getNumber<uint32_t>("members");
     }
   }
 
@@ -579,14 +568,9 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     } while (result->next());
   }
 
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_items` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-
   std::vector<std::pair<uint8_t, Container*>> openContainersList;
 
-  if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
-
+  if (loadItems(itemMap, "player_items", player->getGUID())) {
     for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
       const std::pair<Item*, int32_t>& pair = it->second;
       Item* item = pair.first;
@@ -630,7 +614,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
   for (auto& it : openContainersList) {
     player->addContainer(it.first - 1, it.second);
-    g_scheduler.addEvent(createSchedulerTask(((it.first) * 50), std::bind(&Game::playerUpdateContainer, &g_game, player->getGUID(), it.first - 1)));
+    load.openContainers.push_back(it.first);
   }
 
   // Store Inbox
@@ -641,11 +625,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   //load depot items
   itemMap.clear();
 
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_depotitems` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-  if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
-
+  if (loadItems(itemMap, "player_depotitems", player->getGUID())) {
     for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
       const std::pair<Item*, int32_t>& pair = it->second;
       Item* item = pair.first;
@@ -673,11 +653,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   //load reward chest items
   itemMap.clear();
 
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_rewards` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-    if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
-
+  if (loadItems(itemMap, "player_rewards", player->getGUID())) {
     //first loop handles the reward containers to retrieve its date attribute
     //for (ItemMap::iterator it = itemMap.begin(), end = itemMap.end(); it != end; ++it) {
     for (auto& it : itemMap) {
@@ -721,11 +697,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   //load inbox items
   itemMap.clear();
 
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_inboxitems` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-  if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
-
+  if (loadItems(itemMap, "player_inboxitems", player->getGUID())) {
     for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
       const std::pair<Item*, int32_t>& pair = it->second;
       Item* item = pair.first;
@@ -749,12 +721,14 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   }
 
   //load storage map
-  query.str(std::string());
-  query << "SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
-    do {
-      player->addStorageValue(result->getNumber<uint32_t>("key"), result->getNumber<int32_t>("value"), true);
-    } while (result->next());
+  DBStatement* storageStatement = db.prepare("SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = ?");
+  if (storageStatement) {
+    storageStatement->bind(0, player->getGUID());
+    if (DBStatementResult_ptr storageResult = storageStatement->storeQuery()) {
+      do {
+        player->addStorageValue(storageResult->getNumber<uint32_t>(0), storageResult->getNumber<int32_t>(1), true);
+      } while (storageResult->next());
+    }
   }
 
   //load vip
@@ -769,9 +743,52 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   player->updateBaseSpeed();
   player->updateInventoryWeight();
   player->updateItemsLight(true);
+
+  if (deferred) {
+    *deferred = std::move(load);
+  } else {
+    finishPlayerLoad(player, load);
+  }
   return true;
 }
 
+void IOLoginData::finishPlayerLoad(Player* player, const DeferredPlayerLoad& deferred)
+{
+  if (deferred.guildId != 0) {
+    Guild* guild = g_game.getGuild(deferred.guildId);
+    if (!guild) {
+      guild = IOGuild::loadGuild(deferred.guildId);
+      g_game.addGuild(guild);
+    }
+
+    if (guild) {
+      player->guild = guild;
+      GuildRank_ptr rank = guild->getRankById(deferred.guildRankId);
+      if (!rank) {
+        std::ostringstream query;
+        query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = " << deferred.guildRankId;
+
+        if (DBResult_ptr result = Database::getInstance().storeQuery(query.str())) {
+          guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
+        }
+
+        rank = guild->getRankById(deferred.guildRankId);
+        if (!rank) {
+          player->guild = nullptr;
+        }
+      }
+
+      player->guildRank = rank;
+      player->guildWarVector = deferred.guildWars;
+      guild->setMemberCount(deferred.guildMemberCount);
+    }
+  }
+
+  for (uint8_t cid : deferred.openContainers) {
+    g_scheduler.addEvent(createSchedulerTask(cid * 50, std::bind(&Game::playerUpdateContainer, &g_game, player->getGUID(), cid - 1)));
+  }
+}
+
 bool IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& propWriteStream)
 {
   Database& db = Database::getInstance();
@@ -866,27 +883,129 @@ bool IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList,
   return query_insert.execute();
 }
 
+PlayerSaveRows IOLoginData::saveRows;
+std::unordered_map<uint32_t, IOLoginData::LoginLoad> IOLoginData::loginLoads;
+
 bool IOLoginData::savePlayer(Player* player)
 {
-  savePlayerPreyById(player, player->getGUID());
-  if (player->getHealth() <= 0) {
-    player->changeHealth(1);
+  // a queued save of this player must not land after this one
+  g_playerSaves.waitFor(player->getGUID());
+  // mail, market and house handovers save characters that are offline, one may be logging in right now
+  addLoginLoadWrite(player->getGUID());
+
+  PlayerSave save;
+  if (!capturePlayerSave(player, save)) {
+    return false;
+  }
+
+  bool saved = executePlayerSave(save);
+  finishPlayerSave(player, save.state, save.written);
+  return saved;
+}
+
+bool IOLoginData::savePlayerAsync(Player* player)
+{
+  if (!g_playerSaves.isRunning()) {
+    return savePlayer(player);
+  }
+
+  PlayerSave save;
+  if (!capturePlayerSave(player, save)) {
+    return false;
+  }
+  g_playerSaves.addSave(std::move(save));
+  return true;
+}
+
+bool IOLoginData::executePlayerSave(PlayerSave& save)
+{
+  save.written = false;
+  DBTransaction transaction;
+  if (!transaction.begin()) {
+    return false;
+  }
+
+  if (!writePlayerSave(save)) {
+    return false;
   }
+
+  if (!transaction.commit()) {
+    save.written = false;
+    return false;
+  }
+  return true;
+}
+
+bool IOLoginData::writePlayerSave(PlayerSave& save)
+{
   Database& db = Database::getInstance();
 
-  std::ostringstream query;
-  query << "SELECT `save` FROM `players` WHERE `id` = " << player->getGUID();
-  DBResult_ptr result = db.storeQuery(query.str());
+  DBStatement* preyTimesStatement = db.prepare("SELECT `bonus_type1` FROM `player_preytimes` WHERE `player_id` = ?");
+  DBStatement* saveStatement = db.prepare("SELECT `save` FROM `players` WHERE `id` = ?");
+  if (!preyTimesStatement || !saveStatement) {
+    return false;
+  }
+
+  preyTimesStatement->bind(0, save.guid);
+  db.executeQuery(preyTimesStatement->storeQuery() ? save.preyTimesUpdate : save.preyTimesInsert);
+
+  saveStatement->bind(0, save.guid);
+  DBStatementResult_ptr result = saveStatement->storeQuery();
   if (!result) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Error for select result query from player: {}", player->getName());
+    SPDLOG_WARN("[IOLoginData::savePlayer] - Error for select result query from player: {}", save.name);
     return false;
   }
 
-  if (result->getNumber<uint16_t>("save") == 0) {
-    query.str(std::string());
-    query << "UPDATE `players` SET `lastlogin` = " << player->lastLoginSaved << ", `lastip` = " << player->lastIP << " WHERE `id` = " << player->getGUID();
-    return db.executeQuery(query.str());
+  if (result->getNumber<uint16_t>(0) == 0) {
+    return db.executeQuery(save.loginUpdate);
+  }
+
+  for (const std::string& statement : save.statements) {
+    if (!db.executeQuery(statement)) {
+      SPDLOG_WARN("[IOLoginData::savePlayer] - Error saving player {}: {}", save.name, statement.substr(0, 64));
+      return false;
+    }
+  }
+  save.written = true;
+  return true;
+}
+
+void IOLoginData::finishPlayerSave(Player* player, const PlayerSaveState& state, bool written)
+{
+  if (player->savesInFlight > 0) {
+    --player->savesInFlight;
+  }
+
+  // a failed write keeps the marks of the last one that made it, so the next save carries its rows again
+  if (!written || state.sequence <= player->savedSequence) {
+    return;
+  }
+
+  player->savedSequence = state.sequence;
+  player->savedSections = state.sections;
+  player->storageSaved = true;
+  for (auto it = player->dirtyStorageKeys.begin(); it != player->dirtyStorageKeys.end();) {
+    if (it->second <= state.storageVersion) {
+      it = player->dirtyStorageKeys.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool IOLoginData::capturePlayerSave(Player* player, PlayerSave& save)
+{
+  save.guid = player->getGUID();
+  save.name = player->getName();
+  getPreyTimesQueries(player, save.guid, save.preyTimesInsert, save.preyTimesUpdate);
+  if (player->getHealth() <= 0) {
+    player->changeHealth(1);
   }
+  Database& db = Database::getInstance();
+
+  std::ostringstream query;
+  query << "UPDATE `players` SET `lastlogin` = " << player->lastLoginSaved << ", `lastip` = " << player->lastIP << " WHERE `id` = " << player->getGUID();
+  save.loginUpdate = query.str();
 
   //First, an UPDATE query to write the player itself
   query.str(std::string());
@@ -1014,55 +1133,7 @@ bool IOLoginData::savePlayer(Player* player)
   }
   query << " WHERE `id` = " << player->getGUID();
 
-  DBTransaction transaction;
-  if (!transaction.begin()) {
-    return false;
-  }
-
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
-
-  // Stash save items
-  query.str(std::string());
-  query << "DELETE FROM `player_stash` WHERE `player_id` = " << player->getGUID();
-  db.executeQuery(query.str());
-  for (auto it : player->getStashItems()) {
-	query.str(std::string());
-    query << "INSERT INTO `player_stash` (`player_id`,`item_id`,`item_count`) VALUES (";
-    query << player->getGUID() << ", ";
-    query << it.first << ", ";
-    query << it.second << ")";
-	db.executeQuery(query.str());
-  }
-
-  // learned spells
-  query.str(std::string());
-  query << "DELETE FROM `player_spells` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
-
-  query.str(std::string());
-
-  DBInsert spellsQuery("INSERT INTO `player_spells` (`player_id`, `name` ) VALUES ");
-  for (const std::string& spellName : player->learnedInstantSpellList) {
-    query << player->getGUID() << ',' << db.escapeString(spellName);
-    if (!spellsQuery.addRow(query)) {
-      return false;
-    }
-  }
-
-  if (!spellsQuery.execute()) {
-    return false;
-  }
-
-  //player kills
-  query.str(std::string());
-  query << "DELETE FROM `player_kills` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  save.statements.push_back(query.str());
 
   //player bestiary charms
   query.str(std::string());
@@ -1101,14 +1172,47 @@ bool IOLoginData::savePlayer(Player* player)
   query << " `tracker list` = " << db.escapeBlob(trackerList, trackerSize);
   query << " WHERE `player_guid` = " << player->getGUID();
 
-  if (!db.executeQuery(query.str())) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Error saving bestiary data from player: {}", player->getName());
+  save.statements.push_back(query.str());
+
+  // the players and charms rows
+  save.rowsWritten += 2;
+
+  // the tables below are built aside and only rewritten when their rows differ from the last save
+  std::vector<std::string> sectionStatements;
+
+  // Stash save items
+  DBInsert stashQuery("INSERT INTO `player_stash` (`player_id`,`item_id`,`item_count`) VALUES ", sectionStatements);
+  for (auto it : player->getStashItems()) {
+    query.str(std::string());
+    query << player->getGUID() << ',' << it.first << ',' << it.second;
+    if (!stashQuery.addRow(query)) {
+      return false;
+    }
+  }
+
+  if (!stashQuery.execute()) {
     return false;
   }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_STASH, "player_stash", sectionStatements, stashQuery.getRowCount());
 
+  // learned spells
   query.str(std::string());
 
-  DBInsert killsQuery("INSERT INTO `player_kills` (`player_id`, `target`, `time`, `unavenged`) VALUES");
+  DBInsert spellsQuery("INSERT INTO `player_spells` (`player_id`, `name` ) VALUES ", sectionStatements);
+  for (const std::string& spellName : player->learnedInstantSpellList) {
+    query << player->getGUID() << ',' << db.escapeString(spellName);
+    if (!spellsQuery.addRow(query)) {
+      return false;
+    }
+  }
+
+  if (!spellsQuery.execute()) {
+    return false;
+  }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_SPELLS, "player_spells", sectionStatements, spellsQuery.getRowCount());
+
+  //player kills
+  DBInsert killsQuery("INSERT INTO `player_kills` (`player_id`, `target`, `time`, `unavenged`) VALUES", sectionStatements);
   for (const auto& kill : player->unjustifiedKills) {
     query << player->getGUID() << ',' << kill.target << ',' << kill.time << ',' << kill.unavenged;
     if (!killsQuery.addRow(query)) {
@@ -1119,15 +1223,10 @@ bool IOLoginData::savePlayer(Player* player)
   if (!killsQuery.execute()) {
     return false;
   }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_KILLS, "player_kills", sectionStatements, killsQuery.getRowCount());
 
   //item saving
-  query << "DELETE FROM `player_items` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Error delete query 'player_items' from player: {}", player->getName());
-    return false;
-  }
-
-  DBInsert itemsQuery("INSERT INTO `player_items` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
+  DBInsert itemsQuery("INSERT INTO `player_items` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ", sectionStatements);
 
   ItemBlockList itemList;
   for (int32_t slotId = CONST_SLOT_FIRST; slotId <= CONST_SLOT_LAST; ++slotId) {
@@ -1141,17 +1240,11 @@ bool IOLoginData::savePlayer(Player* player)
     SPDLOG_WARN("[IOLoginData::savePlayer] - Failed for save items from player: {}", player->getName());
     return false;
   }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_ITEMS, "player_items", sectionStatements, itemsQuery.getRowCount());
 
   if (player->lastDepotId != -1) {
     //save depot items
-    query.str(std::string());
-    query << "DELETE FROM `player_depotitems` WHERE `player_id` = " << player->getGUID();
-
-    if (!db.executeQuery(query.str())) {
-      return false;
-    }
-
-    DBInsert depotQuery("INSERT INTO `player_depotitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
+    DBInsert depotQuery("INSERT INTO `player_depotitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ", sectionStatements);
     itemList.clear();
 
     for (const auto& it : player->depotChests) {
@@ -1164,21 +1257,15 @@ bool IOLoginData::savePlayer(Player* player)
     if (!saveItems(player, itemList, depotQuery, propWriteStream)) {
       return false;
     }
+    addSaveSection(player, save, PLAYER_SAVE_SECTION_DEPOT, "player_depotitems", sectionStatements, depotQuery.getRowCount());
   }
 
   //save reward items
-  query.str(std::string());
-  query << "DELETE FROM `player_rewards` WHERE `player_id` = " << player->getGUID();
-
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
-
   std::vector<uint32_t> rewardList;
   player->getRewardList(rewardList);
 
+  DBInsert rewardQuery("INSERT INTO `player_rewards` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ", sectionStatements);
   if (!rewardList.empty()) {
-    DBInsert rewardQuery("INSERT INTO `player_rewards` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
     itemList.clear();
 
     int running = 0;
@@ -1194,15 +1281,10 @@ bool IOLoginData::savePlayer(Player* player)
       return false;
     }
   }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_REWARDS, "player_rewards", sectionStatements, rewardQuery.getRowCount());
 
   //save inbox items
-  query.str(std::string());
-  query << "DELETE FROM `player_inboxitems` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
-
-  DBInsert inboxQuery("INSERT INTO `player_inboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
+  DBInsert inboxQuery("INSERT INTO `player_inboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ", sectionStatements);
   itemList.clear();
 
   for (Item* item : player->getInbox()->getItemList()) {
@@ -1212,17 +1294,11 @@ bool IOLoginData::savePlayer(Player* player)
   if (!saveItems(player, itemList, inboxQuery, propWriteStream)) {
     return false;
   }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_INBOX, "player_inboxitems", sectionStatements, inboxQuery.getRowCount());
 
   // New Prey
   query.str(std::string());
-  query << "DELETE FROM `prey_slots` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Failed to delete table 'prey_slosts' from player: {}", player->getName());
-    return false;
-  }
-
-  query.str(std::string());
-  DBInsert preyDataQuery("INSERT INTO `prey_slots` (`player_id`, `num`, `state`, `unlocked`, `current`, `monster_list`, `free_reroll_in`, `time_left`, `next_use`, `bonus_type`, `bonus_value`, `bonus_grade`, `tick`) VALUES ");
+  DBInsert preyDataQuery("INSERT INTO `prey_slots` (`player_id`, `num`, `state`, `unlocked`, `current`, `monster_list`, `free_reroll_in`, `time_left`, `next_use`, `bonus_type`, `bonus_value`, `bonus_grade`, `tick`) VALUES ", sectionStatements);
   for (size_t num = 0; num < PREY_SLOTNUM_THIRD + 1; num++) {
     query << player->getGUID() << ',' << num << ',' << player->preySlotState[num] << ',' << player->preySlotUnlocked[num] << ',' << db.escapeString(player->preySlotCurrentMonster[num]) << ',' << db.escapeString(player->preySlotMonsterList[num]) << ',' << player->preySlotFreeRerollIn[num] << ',' << player->preySlotTimeLeft[num] << ',' << player->preySlotNextUse[num] << ',' << player->preySlotBonusType[num] << ',' << player->preySlotBonusValue[num] << ',' << player->preySlotBonusGrade[num] << ',' << player->preySlotTick[num];
     if (!preyDataQuery.addRow(query)) {
@@ -1234,31 +1310,93 @@ bool IOLoginData::savePlayer(Player* player)
     SPDLOG_WARN("[IOLoginData::savePlayer] - Failed for save prey from playerr: {}", player->getName());
     return false;
   }
+  addSaveSection(player, save, PLAYER_SAVE_SECTION_PREY, "prey_slots", sectionStatements, preyDataQuery.getRowCount());
 
-  query.str(std::string());
-  query << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  // storage is written per key once the table holds what storageMap had at the last written save
+  player->genReservedStorageRange();
 
   query.str(std::string());
+  DBInsert storageQuery("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ", save.statements);
+  if (player->storageSaved && player->savesInFlight == 0) {
+    storageQuery.setUpsert(" ON DUPLICATE KEY UPDATE `value` = VALUES(`value`)");
+
+    std::ostringstream erasedKeys;
+    for (const auto& dirtyKey : player->dirtyStorageKeys) {
+      uint32_t key = dirtyKey.first;
+      auto it = player->storageMap.find(key);
+      if (it == player->storageMap.end()) {
+        erasedKeys << (erasedKeys.tellp() > 0 ? "," : "") << key;
+        continue;
+      }
 
-  DBInsert storageQuery("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ");
-  player->genReservedStorageRange();
+      query << player->getGUID() << ',' << key << ',' << it->second;
+      if (!storageQuery.addRow(query)) {
+        return false;
+      }
+    }
 
-  for (const auto& it : player->storageMap) {
-    query << player->getGUID() << ',' << it.first << ',' << it.second;
-    if (!storageQuery.addRow(query)) {
-      return false;
+    if (erasedKeys.tellp() > 0) {
+      std::ostringstream eraseQuery;
+      eraseQuery << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID() << " AND `key` IN (" << erasedKeys.str() << ')';
+      save.statements.push_back(eraseQuery.str());
+    }
+    save.rowsSkipped += player->storageMap.size() - storageQuery.getRowCount();
+  } else {
+    std::ostringstream clearQuery;
+    clearQuery << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID();
+    save.statements.push_back(clearQuery.str());
+
+    for (const auto& it : player->storageMap) {
+      query << player->getGUID() << ',' << it.first << ',' << it.second;
+      if (!storageQuery.addRow(query)) {
+        return false;
+      }
     }
   }
 
   if (!storageQuery.execute()) {
     return false;
   }
+  save.rowsWritten += storageQuery.getRowCount();
+
+  // nothing counts as saved until finishPlayerSave hears back from the write
+  save.playerId = player->getID();
+  save.state.sequence = ++player->saveSequence;
+  save.state.storageVersion = player->storageVersion;
+  ++player->savesInFlight;
 
-  //End the transaction
-  return transaction.commit();
+  SPDLOG_DEBUG("[IOLoginData::savePlayer] - Player {}: {} rows written, {} unchanged rows skipped", save.name, save.rowsWritten, save.rowsSkipped);
+  saveRows.written += save.rowsWritten;
+  saveRows.skipped += save.rowsSkipped;
+  return true;
+}
+
+void IOLoginData::addSaveSection(Player* player, PlayerSave& save, PlayerSaveSection_t section, const std::string& table, std::vector<std::string>& statements, size_t rows)
+{
+  // FNV-1a over the rows of the section, 0 is kept for "not saved yet"
+  uint64_t fingerprint = 14695981039346656037ULL;
+  for (const std::string& statement : statements) {
+    for (char c : statement) {
+      fingerprint = (fingerprint ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+    fingerprint = (fingerprint ^ 0xFF) * 1099511628211ULL;
+  }
+  if (fingerprint == 0) {
+    fingerprint = 1;
+  }
+
+  // while another save is on its way the database may hold neither its rows nor the saved ones
+  save.state.sections[section] = fingerprint;
+  if (player->savesInFlight == 0 && player->savedSections[section] == fingerprint) {
+    save.rowsSkipped += rows;
+  } else {
+    std::ostringstream query;
+    query << "DELETE FROM `" << table << "` WHERE `player_id` = " << player->getGUID();
+    save.statements.push_back(query.str());
+    save.statements.insert(save.statements.end(), std::make_move_iterator(statements.begin()), std::make_move_iterator(statements.end()));
+    save.rowsWritten += rows;
+  }
+  statements.clear();
 }
 
 std::string IOLoginData::getNameByGuid(uint32_t guid)
@@ -1327,16 +1465,33 @@ bool IOLoginData::formatPlayerName(std::string& name)
   return true;
 }
 
-void IOLoginData::loadItems(ItemMap& itemMap, DBResult_ptr result)
+bool IOLoginData::loadItems(ItemMap& itemMap, const std::string& table, uint32_t playerId)
 {
+  DBStatement* statement = Database::getInstance().prepare("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `" + table + "` WHERE `player_id` = ? ORDER BY `sid` DESC");
+  if (!statement) {
+    return false;
+  }
+
+  statement->bind(0, playerId);
+  DBStatementResult_ptr result = statement->storeQuery();
+  if (!result) {
+    return false;
+  }
+
+  // the same for every table, so they are looked up once per load rather than per row
+  const size_t pidColumn = result->getColumnIndex("pid");
+  const size_t sidColumn = result->getColumnIndex("sid");
+  const size_t typeColumn = result->getColumnIndex("itemtype");
+  const size_t countColumn = result->getColumnIndex("count");
+  const size_t attributesColumn = result->getColumnIndex("attributes");
   do {
-    uint32_t sid = result->getNumber<uint32_t>("sid");
-    uint32_t pid = result->getNumber<uint32_t>("pid");
-    uint16_t type = result->getNumber<uint16_t>("itemtype");
-    uint16_t count = result->getNumber<uint16_t>("count");
+    uint32_t sid = result->getNumber<uint32_t>(sidColumn);
+    uint32_t pid = result->getNumber<uint32_t>(pidColumn);
+    uint16_t type = result->getNumber<uint16_t>(typeColumn);
+    uint16_t count = result->getNumber<uint16_t>(countColumn);
 
     unsigned long attrSize;
-    const char* attr = result->getStream("attributes", attrSize);
+    const char* attr = result->getStream(attributesColumn, attrSize);
 
     PropStream propStream;
     propStream.init(attr, attrSize);
@@ -1351,15 +1506,48 @@ void IOLoginData::loadItems(ItemMap& itemMap, DBResult_ptr result)
       itemMap[sid] = pair;
     }
   } while (result->next());
+  return true;
 }
 
 void IOLoginData::increaseBankBalance(uint32_t guid, uint64_t bankBalance)
 {
   std::ostringstream query;
   query << "UPDATE `players` SET `balance` = `balance` + " << bankBalance << " WHERE `id` = " << guid;
+  // the save of a player who just logged out would write the old balance back
+  g_playerSaves.waitFor(guid);
+  addLoginLoadWrite(guid);
   Database::getInstance().executeQuery(query.str());
 }
 
+uint32_t IOLoginData::beginLoginLoad(uint32_t guid)
+{
+  LoginLoad& load = loginLoads[guid];
+  ++load.loads;
+  return load.writes;
+}
+
+bool IOLoginData::finishLoginLoad(uint32_t guid, uint32_t writes)
+{
+  auto it = loginLoads.find(guid);
+  if (it == loginLoads.end()) {
+    return false;
+  }
+
+  bool written = it->second.writes != writes;
+  if (--it->second.loads == 0) {
+    loginLoads.erase(it);
+  }
+  return written;
+}
+
+void IOLoginData::addLoginLoadWrite(uint32_t guid)
+{
+  auto it = loginLoads.find(guid);
+  if (it != loginLoads.end()) {
+    ++it->second.writes;
+  }
+}
+
 bool IOLoginData::hasBiddedOnHouse(uint32_t guid)
 {
   Database& db = Database::getInstance();
@@ -26,6 +26,48 @@
 
 using ItemBlockList = std::list<std::pair<int32_t, Item*>>;
 
+// what a save hands back to the player it was captured from once it is written
+struct PlayerSaveState {
+	uint64_t sequence = 0;
+	std::array<uint64_t, PLAYER_SAVE_SECTION_LAST> sections = {};
+	uint64_t storageVersion = 0;
+};
+
+// everything a player save writes, captured on the dispatcher as finished statements
+struct PlayerSave {
+	uint32_t guid = 0;
+	uint32_t playerId = 0;
+	std::string name;
+	// the prey times row is updated when it exists and inserted otherwise
+	std::string preyTimesInsert;
+	std::string preyTimesUpdate;
+	// the only write for characters whose save flag is off
+	std::string loginUpdate;
+	std::vector<std::string> statements;
+	// rows this save writes and rows it leaves alone because they did not change
+	size_t rowsWritten = 0;
+	size_t rowsSkipped = 0;
+	PlayerSaveState state;
+	// set once the statements are committed, a save flag of 0 leaves them out
+	bool written = false;
+};
+
+// totals over every save captured since startup
+struct PlayerSaveRows {
+	uint64_t written = 0;
+	uint64_t skipped = 0;
+};
+
+// what a load off the dispatcher leaves to finishPlayerLoad, it touches the guilds and the scheduler
+struct DeferredPlayerLoad {
+	uint32_t guildId = 0;
+	uint32_t guildRankId = 0;
+	uint32_t guildMemberCount = 0;
+	GuildWarVector guildWars;
+	// saved ids of the containers the player had open, 1 based and in order
+	std::vector<uint8_t> openContainers;
+};
+
 class IOLoginData
 {
 	public:
@@ -38,18 +80,36 @@ class IOLoginData
 		static void updateOnlineStatus(uint32_t guid, bool login);
 		static bool preloadPlayer(Player* player, const std::string& name);
 
-		static bool loadPlayerById(Player* player, uint32_t id);
+		// with deferred the load reads the database only and is safe off the dispatcher
+		static bool loadPlayerById(Player* player, uint32_t id, DeferredPlayerLoad* deferred = nullptr);
 		static bool loadPlayerPreyData(Player * player);
 		static bool loadPlayerPreyById(Player* player, uint32_t id);
 		static bool loadPlayerByName(Player* player, const std::string& name);
-		static bool loadPlayer(Player* player, DBResult_ptr result);
+		static bool loadPlayer(Player* player, DBResult_ptr result, DeferredPlayerLoad* deferred = nullptr);
+		// dispatcher thread
+		static void finishPlayerLoad(Player* player, const DeferredPlayerLoad& deferred);
 		static bool savePlayer(Player* player);
+		// captures the save and leaves the writing to the player save thread
+		static bool savePlayerAsync(Player* player);
+		static bool capturePlayerSave(Player* player, PlayerSave& save);
+		// writes a captured save inside the caller's transaction
+		static bool writePlayerSave(PlayerSave& save);
+		static bool executePlayerSave(PlayerSave& save);
+		// on the dispatcher after the write, the player only skips rows the database is known to hold
+		static void finishPlayerSave(Player* player, const PlayerSaveState& state, bool written);
 		static bool savePlayerPreyById(Player* player, uint32_t id);
+		static PlayerSaveRows getSaveRows() {
+			return saveRows;
+		}
 		static uint32_t getGuidByName(const std::string& name);
 		static bool getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name);
 		static std::string getNameByGuid(uint32_t guid);
 		static bool formatPlayerName(std::string& name);
 		static void increaseBankBalance(uint32_t guid, uint64_t bankBalance);
+		// dispatcher thread, a login thread reads the character in between
+		// begin returns what finish compares against, finish is true when an offline write landed meanwhile
+		static uint32_t beginLoginLoad(uint32_t guid);
+		static bool finishLoginLoad(uint32_t guid, uint32_t writes);
 		static bool hasBiddedOnHouse(uint32_t guid);
 
 		static std::forward_list<VIPEntry> getVIPEntries(uint32_t accountId);
@@ -63,8 +123,21 @@ class IOLoginData
 	private:
 		using ItemMap = std::map<uint32_t, std::pair<Item*, uint32_t>>;
 
-		static void loadItems(ItemMap& itemMap, DBResult_ptr result);
+		// fills itemMap with the rows of table that belong to playerId, false when there are none
+		static bool loadItems(ItemMap& itemMap, const std::string& table, uint32_t playerId);
 		static bool saveItems(const Player* player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& stream);
+		static void getPreyTimesQueries(const Player* player, uint32_t id, std::string& insert, std::string& update);
+		// moves the statements of a section into the save when its rows changed since the last one
+		static void addSaveSection(Player* player, PlayerSave& save, PlayerSaveSection_t section, const std::string& table, std::vector<std::string>& statements, size_t rows);
+		static void addLoginLoadWrite(uint32_t guid);
+
+		struct LoginLoad {
+			uint32_t loads = 0;
+			uint32_t writes = 0;
+		};
+
+		static PlayerSaveRows saveRows;
+		static std::unordered_map<uint32_t, LoginLoad> loginLoads;
 };
 
 #endif
@@ -22,8 +22,14 @@
 #include "iomap.h"
 
 #include "bed.h"
+#include "game.h"
+#include "housetile.h"
 #include "teleport.h"
 
+#include <atomic>
+
+extern Game g_game;
+
 /*
 	OTBM_ROOTV1
 	|
@@ -132,11 +138,10 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		return false;
 	}
 
+	std::vector<const OTB::Node*> tileAreaNodes;
 	for (auto& mapDataNode : mapNode.children) {
 		if (mapDataNode.type == OTBM_TILE_AREA) {
-			if (!parseTileArea(loader, mapDataNode, *map)) {
-				return false;
-			}
+			tileAreaNodes.push_back(&mapDataNode);
 		} else if (mapDataNode.type == OTBM_TOWNS) {
 			if (!parseTowns(loader, mapDataNode, *map)) {
 				return false;
@@ -151,6 +156,11 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		}
 	}
 
+	SPDLOG_INFO("Map file parsed in {} seconds", (OTSYS_TIME() - start) / (1000.));
+	if (!parseTileAreas(loader, tileAreaNodes, *map)) {
+		return false;
+	}
+
 	SPDLOG_INFO("Map loading time: {} seconds", (OTSYS_TIME() - start) / (1000.));
 	return true;
 }
@@ -204,17 +214,82 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 	return true;
 }
 
-bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map)
+IOMap::StagedTileArea::~StagedTileArea()
+{
+	for (StagedTile& tile : tiles) {
+		for (Item* item : tile.items) {
+			delete item;
+		}
+	}
+}
+
+bool IOMap::parseTileAreas(OTB::Loader& loader, const std::vector<const OTB::Node*>& tileAreaNodes, Map& map)
+{
+	size_t threads = g_config.getNumber(ConfigManager::MAP_LOADER_THREADS);
+	if (threads == 0) {
+		threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+	threads = std::min(threads, tileAreaNodes.size());
+
+	int64_t start = OTSYS_TIME();
+	std::vector<StagedTileArea> areas(tileAreaNodes.size());
+	if (threads <= 1) {
+		Item::deferUniqueIds = true;
+		for (size_t i = 0; i < areas.size() && decodeTileArea(loader, *tileAreaNodes[i], areas[i]); ++i) {}
+		Item::deferUniqueIds = false;
+	} else {
+		// workers take the next area in file order, every area lands in its own slot
+		std::atomic<size_t> nextArea(0);
+		std::atomic<bool> failed(false);
+		auto decodeAreas = [&]() {
+			Item::deferUniqueIds = true;
+			for (size_t i = nextArea++; i < areas.size() && !failed; i = nextArea++) {
+				if (!decodeTileArea(loader, *tileAreaNodes[i], areas[i])) {
+					failed = true;
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < threads; ++i) {
+			workers.emplace_back(decodeAreas);
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	int64_t decoded = OTSYS_TIME();
+	SPDLOG_INFO("Decoded {} tile areas on {} threads in {} seconds",
+                areas.size(), std::max<size_t>(threads, 1), (decoded - start) / (1000.));
+
+	// merging in file order gives the same map, warnings and unique ids as a serial load
+	for (StagedTileArea& area : areas) {
+		if (!area.error.empty()) {
+			setLastErrorString(area.error);
+			return false;
+		}
+
+		if (!mergeTileArea(area, map)) {
+			return false;
+		}
+	}
+
+	SPDLOG_INFO("Placed the tiles on the map in {} seconds", (OTSYS_TIME() - decoded) / (1000.));
+	return true;
+}
+
+bool IOMap::decodeTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, StagedTileArea& area)
 {
 	PropStream propStream;
 	if (!loader.getProps(tileAreaNode, propStream)) {
-		setLastErrorString("Invalid map node.");
+		area.error = "Invalid map node.";
 		return false;
 	}
 
 	OTBM_Destination_coords area_coord;
 	if (!propStream.read(area_coord)) {
-		setLastErrorString("Invalid map node.");
+		area.error = "Invalid map node.";
 		return false;
 	}
 
@@ -222,54 +297,41 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 	uint16_t base_y = area_coord.y;
 	uint16_t z = area_coord.z;
 
-	static std::map<uint64_t, uint64_t> teleportMap;
-
+	area.tiles.reserve(tileAreaNode.children.size());
 	for (auto& tileNode : tileAreaNode.children) {
 		if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
-			setLastErrorString("Unknown tile node.");
+			area.error = "Unknown tile node.";
 			return false;
 		}
 
 		if (!loader.getProps(tileNode, propStream)) {
-			setLastErrorString("Could not read node data.");
+			area.error = "Could not read node data.";
 			return false;
 		}
 
 		OTBM_Tile_coords tile_coord;
 		if (!propStream.read(tile_coord)) {
-			setLastErrorString("Could not read tile position.");
+			area.error = "Could not read tile position.";
 			return false;
 		}
 
-		uint16_t x = base_x + tile_coord.x;
-		uint16_t y = base_y + tile_coord.y;
+		area.tiles.emplace_back();
+		StagedTile& tile = area.tiles.back();
+		tile.x = base_x + tile_coord.x;
+		tile.y = base_y + tile_coord.y;
+		tile.z = z;
 
-		bool isHouseTile = false;
-		House* house = nullptr;
-		Tile* tile = nullptr;
-		Item* ground_item = nullptr;
-		uint32_t tileflags = TILESTATE_NONE;
+		uint16_t x = tile.x;
+		uint16_t y = tile.y;
 
 		if (tileNode.type == OTBM_HOUSETILE) {
-			uint32_t houseId;
-			if (!propStream.read<uint32_t>(houseId)) {
+			if (!propStream.read<uint32_t>(tile.houseId)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
-
-			house = map.houses.addHouse(houseId);
-			if (!house) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << houseId;
-				setLastErrorString(ss.str());
-				return false;
-			}
-
-			tile = new HouseTile(x, y, z, house);
-			house->addTile(static_cast<HouseTile*>(tile));
-			isHouseTile = true;
+			tile.isHouseTile = true;
 		}
 
 		uint8_t attribute;
@@ -281,20 +343,20 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 					if (!propStream.read<uint32_t>(flags)) {
 						std::ostringstream ss;
 						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to read tile flags.";
-						setLastErrorString(ss.str());
+						area.error = ss.str();
 						return false;
 					}
 
 					if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
-						tileflags |= TILESTATE_PROTECTIONZONE;
+						tile.flags |= TILESTATE_PROTECTIONZONE;
 					} else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
-						tileflags |= TILESTATE_NOPVPZONE;
+						tile.flags |= TILESTATE_NOPVPZONE;
 					} else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
-						tileflags |= TILESTATE_PVPZONE;
+						tile.flags |= TILESTATE_PVPZONE;
 					}
 
 					if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
-						tileflags |= TILESTATE_NOLOGOUT;
+						tile.flags |= TILESTATE_NOLOGOUT;
 					}
 					break;
 				}
@@ -304,67 +366,19 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 					if (!item) {
 						std::ostringstream ss;
 						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-						setLastErrorString(ss.str());
+						area.error = ss.str();
 						return false;
 					}
 
-			if (Teleport* teleport = item->getTeleport()) {
-				const Position& destPos = teleport->getDestPos();
-				uint64_t teleportPosition = (static_cast<uint64_t>(x) << 24) | (y << 8) | z;
-				uint64_t destinationPosition = (static_cast<uint64_t>(destPos.x) << 24) | (destPos.y << 8) | destPos.z;
-				teleportMap.emplace(teleportPosition, destinationPosition);
-				auto it = teleportMap.find(destinationPosition);
-				if (it != teleportMap.end()) {
-					SPDLOG_WARN("[IOMap::loadMap] - "
-                                "Teleport in position: x {}, y {}, z {} "
-                                "is leading to another teleport", x, y, z);
-				}
-				for (auto const& it2 : teleportMap) {
-					if (it2.second == teleportPosition) {
-						uint16_t fx = (it2.first >> 24) & 0xFFFF;
-						uint16_t fy = (it2.first >> 8) & 0xFFFF;
-						uint8_t fz = (it2.first) & 0xFF;
-						SPDLOG_WARN("[IOMap::loadMap] - "
-                                    "Teleport in position: x {}, y {}, z {} "
-                                    "is leading to another teleport",
-                                    fx, fy, static_cast<uint16_t>(fz));
-					}
-				}
-
-			}
-
-					if (isHouseTile && item->isMoveable()) {
-						SPDLOG_WARN("[IOMap::loadMap] - "
-                                    "Moveable item with ID: {}, in house: {}, "
-                                    "at position: x {}, y {}, z {}",
-                                    item->getID(), house->getId(), x, y, z);
-						delete item;
-					} else {
-						if (item->getItemCount() <= 0) {
-							item->setItemCount(1);
-						}
-
-						if (tile) {
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						} else if (item->isGroundTile()) {
-							delete ground_item;
-							ground_item = item;
-						} else {
-							tile = createTile(ground_item, item, x, y, z);
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						}
-					}
+					tile.items.push_back(item);
+					++tile.attributeItemCount;
 					break;
 				}
 
 				default:
 					std::ostringstream ss;
 					ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown tile attribute.";
-					setLastErrorString(ss.str());
+					area.error = ss.str();
 					return false;
 			}
 		}
@@ -373,13 +387,13 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			if (itemNode.type != OTBM_ITEM) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
 
 			PropStream stream;
 			if (!loader.getProps(itemNode, stream)) {
-				setLastErrorString("Invalid item node.");
+				area.error = "Invalid item node.";
 				return false;
 			}
 
@@ -387,23 +401,104 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			if (!item) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
 
 			if (!item->unserializeItemNode(loader, itemNode, stream)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				delete item;
 				return false;
 			}
 
-			if (isHouseTile && item->isMoveable()) {
+			tile.items.push_back(item);
+		}
+	}
+	return true;
+}
+
+namespace {
+
+// the unique ids a loader thread stored on the item and its contents, registered in map order
+void registerUniqueIds(Item* item)
+{
+	uint16_t uniqueId = item->getUniqueId();
+	if (uniqueId != 0 && !g_game.addUniqueItem(uniqueId, item)) {
+		item->removeAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+	}
+
+	if (Container* container = item->getContainer()) {
+		for (Item* containerItem : container->getItemList()) {
+			registerUniqueIds(containerItem);
+		}
+	}
+}
+
+}
+
+bool IOMap::mergeTileArea(StagedTileArea& area, Map& map)
+{
+	static std::map<uint64_t, uint64_t> teleportMap;
+
+	for (StagedTile& staged : area.tiles) {
+		uint16_t x = staged.x;
+		uint16_t y = staged.y;
+		uint16_t z = staged.z;
+
+		House* house = nullptr;
+		Tile* tile = nullptr;
+		Item* ground_item = nullptr;
+
+		if (staged.isHouseTile) {
+			house = map.houses.addHouse(staged.houseId);
+			if (!house) {
+				std::ostringstream ss;
+				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << staged.houseId;
+				setLastErrorString(ss.str());
+				return false;
+			}
+
+			tile = new HouseTile(x, y, z, house);
+			house->addTile(static_cast<HouseTile*>(tile));
+		}
+
+		for (size_t i = 0; i < staged.items.size(); ++i) {
+			Item* item = staged.items[i];
+			staged.items[i] = nullptr;
+			registerUniqueIds(item);
+
+			Teleport* teleport = i < staged.attributeItemCount ? item->getTeleport() : nullptr;
+			if (teleport) {
+				const Position& destPos = teleport->getDestPos();
+				uint64_t teleportPosition = (static_cast<uint64_t>(x) << 24) | (y << 8) | z;
+				uint64_t destinationPosition = (static_cast<uint64_t>(destPos.x) << 24) | (destPos.y << 8) | destPos.z;
+				teleportMap.emplace(teleportPosition, destinationPosition);
+				auto it = teleportMap.find(destinationPosition);
+				if (it != teleportMap.end()) {
+					SPDLOG_WARN("[IOMap::loadMap] - "
+                                "Teleport in position: x {}, y {}, z {} "
+                                "is leading to another teleport", x, y, z);
+				}
+				for (auto const& it2 : teleportMap) {
+					if (it2.second == teleportPosition) {
+						uint16_t fx = (it2.first >> 24) & 0xFFFF;
+						uint16_t fy = (it2.first >> 8) & 0xFFFF;
+						uint8_t fz = (it2.first) & 0xFF;
+						SPDLOG_WARN("[IOMap::loadMap] - "
+                                    "Teleport in position: x {}, y {}, z {} "
+                                    "is leading to another teleport",
+                                    fx, fy, static_cast<uint16_t>(fz));
+					}
+				}
+			}
+
+			if (house && item->isMoveable()) {
 				SPDLOG_WARN("[IOMap::loadMap] - "
-                                    "Moveable item with ID: {}, in house: {}, "
-                                    "at position: x {}, y {}, z {}",
-                                    item->getID(), house->getId(), x, y, z);
+                            "Moveable item with ID: {}, in house: {}, "
+                            "at position: x {}, y {}, z {}",
+                            item->getID(), house->getId(), x, y, z);
 				delete item;
 			} else {
 				if (item->getItemCount() <= 0) {
@@ -425,12 +520,13 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 				}
 			}
 		}
+		staged.items.clear();
 
 		if (!tile) {
 			tile = createTile(ground_item, nullptr, x, y, z);
 		}
 
-		tile->setFlag(static_cast<tileflags_t>(tileflags));
+		tile->setFlag(static_cast<tileflags_t>(staged.flags));
 
 		map.setTile(x, y, z, tile);
 	}
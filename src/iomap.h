@@ -150,10 +150,37 @@ class IOMap
 		}
 
 	private:
+		// a tile area decoded away from the map, its items are not placed on tiles yet
+		struct StagedTile {
+			uint16_t x;
+			uint16_t y;
+			uint8_t z;
+			bool isHouseTile = false;
+			uint32_t houseId = 0;
+			uint32_t flags = TILESTATE_NONE;
+			// items given as tile attributes come first and are the only ones checked for teleport loops
+			size_t attributeItemCount = 0;
+			std::vector<Item*> items;
+		};
+
+		struct StagedTileArea {
+			StagedTileArea() = default;
+			~StagedTileArea();
+
+			// non-copyable
+			StagedTileArea(const StagedTileArea&) = delete;
+			StagedTileArea& operator=(const StagedTileArea&) = delete;
+
+			std::vector<StagedTile> tiles;
+			std::string error;
+		};
+
 		bool parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName);
 		bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
 		bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
-		bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map);
+		bool parseTileAreas(OTB::Loader& loader, const std::vector<const OTB::Node*>& tileAreaNodes, Map& map);
+		static bool decodeTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, StagedTileArea& area);
+		bool mergeTileArea(StagedTileArea& area, Map& map);
 		std::string errorString;
 };
 
@@ -29,14 +29,19 @@ void IOMapSerialize::loadHouseItems(Map* map)
 {
 	int64_t start = OTSYS_TIME();
 
-	DBResult_ptr result = Database::getInstance().storeQuery("SELECT `data` FROM `tile_store`");
+	DBStatement* statement = Database::getInstance().prepare("SELECT `data` FROM `tile_store`");
+	if (!statement) {
+		return;
+	}
+
+	DBStatementResult_ptr result = statement->storeQuery();
 	if (!result) {
 		return;
 	}
 
 	do {
 		unsigned long attrSize;
-		const char* attr = result->getStream("data", attrSize);
+		const char* attr = result->getStream(0, attrSize);
 
 		PropStream propStream;
 		propStream.init(attr, attrSize);
@@ -311,23 +316,32 @@ bool IOMapSerialize::saveHouseInfo()
 		return false;
 	}
 
-	std::ostringstream query;
+	// the same three statements for every house, bound with its values
+	DBStatement* selectStatement = db.prepare("SELECT `id` FROM `houses` WHERE `id` = ?");
+	DBStatement* updateStatement = db.prepare("UPDATE `houses` SET `owner` = ?, `paid` = ?, `warnings` = ?, `name` = ?, `town_id` = ?, `rent` = ?, `size` = ?, `beds` = ? WHERE `id` = ?");
+	DBStatement* insertStatement = db.prepare("INSERT INTO `houses` (`owner`, `paid`, `warnings`, `name`, `town_id`, `rent`, `size`, `beds`, `id`) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+	if (!selectStatement || !updateStatement || !insertStatement) {
+		return false;
+	}
+
 	for (const auto& it : g_game.map.houses.getHouses()) {
 		House* house = it.second;
-		query << "SELECT `id` FROM `houses` WHERE `id` = " << house->getId();
-		DBResult_ptr result = db.storeQuery(query.str());
-		if (result) {
-			query.str(std::string());
-			query << "UPDATE `houses` SET `owner` = " << house->getOwner() << ", `paid` = " << house->getPaidUntil() << ", `warnings` = " << house->getPayRentWarnings() << ", `name` = " << db.escapeString(house->getName()) << ", `town_id` = " << house->getTownId() << ", `rent` = " << house->getRent() << ", `size` = " << house->getTiles().size() << ", `beds` = " << house->getBedCount() << " WHERE `id` = " << house->getId();
-		} else {
-			query.str(std::string());
-			query << "INSERT INTO `houses` (`id`, `owner`, `paid`, `warnings`, `name`, `town_id`, `rent`, `size`, `beds`) VALUES (" << house->getId() << ',' << house->getOwner() << ',' << house->getPaidUntil() << ',' << house->getPayRentWarnings() << ',' << db.escapeString(house->getName()) << ',' << house->getTownId() << ',' << house->getRent() << ',' << house->getTiles().size() << ',' << house->getBedCount() << ')';
-		}
-
-		db.executeQuery(query.str());
-		query.str(std::string());
+		selectStatement->bind(0, house->getId());
+		DBStatement* statement = selectStatement->storeQuery() ? updateStatement : insertStatement;
+		statement->bind(0, house->getOwner());
+		statement->bind(1, house->getPaidUntil());
+		statement->bind(2, house->getPayRentWarnings());
+		statement->bind(3, house->getName());
+		statement->bind(4, house->getTownId());
+		statement->bind(5, house->getRent());
+		statement->bind(6, house->getTiles().size());
+		statement->bind(7, house->getBedCount());
+		statement->bind(8, house->getId());
+		statement->execute();
 	}
 
+	std::ostringstream query;
+
 	DBInsert stmt("INSERT INTO `house_lists` (`house_id` , `listid` , `list`) VALUES ");
 
 	for (const auto& it : g_game.map.houses.getHouses()) {
@@ -0,0 +1,500 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "iomapsnapshot.h"
+
+#include "depotlocker.h"
+#include "housetile.h"
+#include "iomap.h"
+
+#include <fstream>
+
+namespace {
+
+constexpr OTB::Identifier SNAPSHOT_IDENTIFIER = {{'O', 'T', 'M', 'S'}};
+const std::string ITEMS_OTB_FILE = "data/items/items.otb";
+
+// 64 bit FNV-1a over the whole file, 0 if it can not be read
+uint64_t hashFile(const std::string& fileName)
+{
+	OTB::MappedFile contents;
+	try {
+		contents.open(fileName);
+	} catch (const std::exception&) {
+		return 0;
+	}
+
+	uint64_t hash = 0xcbf29ce484222325;
+	for (char c : contents) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+void writeItem(PropWriteStream& stream, const Item* item)
+{
+	stream.write<uint16_t>(item->getID());
+
+	// doors keep their attributes out of the house item saves, the map still has them
+	const Door* door = item->getDoor();
+	if (door) {
+		item->Item::serializeAttr(stream);
+	} else {
+		item->serializeAttr(stream);
+	}
+
+	// the rest is only placed by the map editor, so the item saves leave it out
+	uint16_t actionId = item->getActionId();
+	if (actionId != 0 && !Item::items[item->getID()].moveable) {
+		stream.write<uint8_t>(ATTR_ACTION_ID);
+		stream.write<uint16_t>(actionId);
+	}
+
+	uint16_t uniqueId = item->getUniqueId();
+	if (uniqueId != 0) {
+		stream.write<uint8_t>(ATTR_UNIQUE_ID);
+		stream.write<uint16_t>(uniqueId);
+	}
+
+	if (door && door->getDoorId() != 0) {
+		stream.write<uint8_t>(ATTR_HOUSEDOORID);
+		stream.write<uint8_t>(door->getDoorId());
+	}
+
+	const Container* container = item->getContainer();
+	if (container) {
+		if (const DepotLocker* depotLocker = container->getDepotLocker()) {
+			stream.write<uint8_t>(ATTR_DEPOT_ID);
+			stream.write<uint16_t>(depotLocker->getDepotId());
+		}
+
+		stream.write<uint8_t>(ATTR_CONTAINER_ITEMS);
+		stream.write<uint32_t>(container->size());
+		for (const Item* child : container->getItemList()) {
+			writeItem(stream, child);
+		}
+	}
+
+	stream.write<uint8_t>(0x00); // attr end
+}
+
+template <typename T>
+bool readRecord(const OTB::MappedFile& file, uint64_t offset, T& record)
+{
+	if (offset > file.size() || file.size() - offset < sizeof(T)) {
+		return false;
+	}
+
+	std::memcpy(&record, file.data() + offset, sizeof(T));
+	return true;
+}
+
+}
+
+std::string IOMapSnapshot::getSnapshotFileName(const std::string& mapFileName)
+{
+	std::string fileName = mapFileName;
+	if (fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".otbm") == 0) {
+		fileName.resize(fileName.size() - 5);
+	}
+	return fileName + ".snapshot";
+}
+
+bool IOMapSnapshot::saveMap(const Map& map, const std::string& mapFileName)
+{
+	int64_t start = OTSYS_TIME();
+
+	PropWriteStream files;
+	files.writeString(map.spawnfile);
+	files.writeString(map.housefile);
+
+	PropWriteStream towns;
+	for (const auto& it : map.towns.getTowns()) {
+		const Town* town = it.second;
+		const Position& templePos = town->getTemplePosition();
+		towns.write<uint32_t>(town->getID());
+		towns.writeString(town->getName());
+		towns.write<uint16_t>(templePos.x);
+		towns.write<uint16_t>(templePos.y);
+		towns.write<uint8_t>(templePos.z);
+	}
+
+	PropWriteStream waypoints;
+	for (const auto& it : map.waypoints) {
+		waypoints.writeString(it.first);
+		waypoints.write<uint16_t>(it.second.x);
+		waypoints.write<uint16_t>(it.second.y);
+		waypoints.write<uint8_t>(it.second.z);
+	}
+
+	std::vector<Snapshot_tile> tiles;
+	PropWriteStream items;
+	map.forEachTile([&tiles, &items](Tile* tile) {
+		const Position& pos = tile->getPosition();
+		Snapshot_tile record = {};
+		record.x = pos.x;
+		record.y = pos.y;
+		record.z = pos.z;
+
+		if (HouseTile* houseTile = dynamic_cast<HouseTile*>(tile)) {
+			record.type = SNAPSHOT_TILE_HOUSE;
+			record.houseId = houseTile->getHouse()->getId();
+		} else if (dynamic_cast<DynamicTile*>(tile)) {
+			record.type = SNAPSHOT_TILE_DYNAMIC;
+		} else {
+			record.type = SNAPSHOT_TILE_STATIC;
+		}
+
+		// the other flags follow from the items
+		for (tileflags_t flag : {TILESTATE_PROTECTIONZONE, TILESTATE_NOPVPZONE, TILESTATE_PVPZONE, TILESTATE_NOLOGOUT}) {
+			if (tile->hasFlag(flag)) {
+				record.flags |= flag;
+			}
+		}
+
+		size_t offset;
+		items.getStream(offset);
+		record.itemsOffset = offset;
+
+		// written in the order Tile::internalAddThing puts them back
+		if (const Item* ground = tile->getGround()) {
+			writeItem(items, ground);
+			++record.itemCount;
+		}
+
+		if (const TileItemVector* itemList = tile->getItemList()) {
+			for (auto it = itemList->getBeginTopItem(), end = itemList->getEndTopItem(); it != end; ++it) {
+				writeItem(items, *it);
+				++record.itemCount;
+			}
+
+			for (auto it = itemList->getEndDownItem(), begin = itemList->getBeginDownItem(); it != begin;) {
+				writeItem(items, *--it);
+				++record.itemCount;
+			}
+		}
+		tiles.push_back(record);
+	});
+
+	Snapshot_header snapshotHeader = {};
+	snapshotHeader.identifier = SNAPSHOT_IDENTIFIER;
+	snapshotHeader.version = SNAPSHOT_VERSION;
+	snapshotHeader.mapHash = hashFile(mapFileName);
+	snapshotHeader.itemsHash = hashFile(ITEMS_OTB_FILE);
+	snapshotHeader.majorVersionItems = Item::items.majorVersion;
+	snapshotHeader.minorVersionItems = Item::items.minorVersion;
+	snapshotHeader.buildNumberItems = Item::items.buildNumber;
+	snapshotHeader.width = map.width;
+	snapshotHeader.height = map.height;
+	snapshotHeader.sectionCount = 5;
+
+	std::vector<Snapshot_section> sectionTable;
+	std::vector<std::pair<const char*, size_t>> sectionData;
+	uint64_t offset = sizeof(Snapshot_header) + snapshotHeader.sectionCount * sizeof(Snapshot_section);
+	auto addSection = [&](SnapshotSection_t type, uint32_t count, const char* data, size_t size) {
+		sectionTable.push_back({type, count, offset, size});
+		sectionData.emplace_back(data, size);
+		offset += size;
+	};
+
+	size_t size;
+	const char* data = files.getStream(size);
+	addSection(SNAPSHOT_SECTION_FILES, 2, data, size);
+	data = towns.getStream(size);
+	addSection(SNAPSHOT_SECTION_TOWNS, map.towns.getTowns().size(), data, size);
+	data = waypoints.getStream(size);
+	addSection(SNAPSHOT_SECTION_WAYPOINTS, map.waypoints.size(), data, size);
+	addSection(SNAPSHOT_SECTION_TILES, tiles.size(), reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(Snapshot_tile));
+	data = items.getStream(size);
+	addSection(SNAPSHOT_SECTION_ITEMS, 0, data, size);
+
+	const std::string fileName = getSnapshotFileName(mapFileName);
+	std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		setLastErrorString("Could not create " + fileName + '.');
+		return false;
+	}
+
+	out.write(reinterpret_cast<const char*>(&snapshotHeader), sizeof(snapshotHeader));
+	out.write(reinterpret_cast<const char*>(sectionTable.data()), sectionTable.size() * sizeof(Snapshot_section));
+	for (const auto& section : sectionData) {
+		out.write(section.first, section.second);
+	}
+
+	if (!out.good()) {
+		setLastErrorString("Could not write " + fileName + '.');
+		return false;
+	}
+
+	SPDLOG_INFO("Wrote map snapshot {} with {} tiles in {} seconds",
+                fileName, tiles.size(), (OTSYS_TIME() - start) / (1000.));
+	return true;
+}
+
+bool IOMapSnapshot::open(const std::string& mapFileName)
+{
+	const std::string fileName = getSnapshotFileName(mapFileName);
+	try {
+		file.open(fileName);
+	} catch (const std::exception&) {
+		setLastErrorString("There is no map snapshot " + fileName);
+		return false;
+	}
+
+	if (!readRecord(file, 0, header) || header.identifier != SNAPSHOT_IDENTIFIER) {
+		setLastErrorString(fileName + " is not a map snapshot");
+		return false;
+	}
+
+	if (header.version != SNAPSHOT_VERSION) {
+		setLastErrorString(fileName + " was written by another server version");
+		return false;
+	}
+
+	if (header.majorVersionItems != Item::items.majorVersion || header.minorVersionItems != Item::items.minorVersion ||
+			header.buildNumberItems != Item::items.buildNumber || header.itemsHash != hashFile(ITEMS_OTB_FILE)) {
+		setLastErrorString(fileName + " was built with another items.otb");
+		return false;
+	}
+
+	if (header.mapHash != hashFile(mapFileName)) {
+		setLastErrorString(fileName + " is older than " + mapFileName);
+		return false;
+	}
+
+	sections.resize(header.sectionCount);
+	for (uint32_t i = 0; i < header.sectionCount; ++i) {
+		Snapshot_section& section = sections[i];
+		if (!readRecord(file, sizeof(Snapshot_header) + i * sizeof(Snapshot_section), section) ||
+				section.offset > file.size() || file.size() - section.offset < section.size) {
+			setLastErrorString(fileName + " is truncated");
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IOMapSnapshot::getSection(SnapshotSection_t type, Snapshot_section& section) const
+{
+	for (const Snapshot_section& it : sections) {
+		if (it.type == type) {
+			section = it;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool IOMapSnapshot::loadMap(Map& map)
+{
+	int64_t start = OTSYS_TIME();
+
+	SPDLOG_INFO("Map size: {}x{}", header.width, header.height);
+	map.width = header.width;
+	map.height = header.height;
+
+	Snapshot_section section;
+	if (!getSection(SNAPSHOT_SECTION_FILES, section)) {
+		setLastErrorString("Could not find the file names.");
+		return false;
+	}
+
+	PropStream propStream;
+	propStream.init(file.data() + section.offset, section.size);
+	if (!propStream.readString(map.spawnfile) || !propStream.readString(map.housefile)) {
+		setLastErrorString("Could not read the file names.");
+		return false;
+	}
+
+	if (!loadTowns(map) || !loadWaypoints(map) || !loadTiles(map)) {
+		return false;
+	}
+
+	SPDLOG_INFO("Map loading time: {} seconds", (OTSYS_TIME() - start) / (1000.));
+	return true;
+}
+
+bool IOMapSnapshot::loadTowns(Map& map)
+{
+	Snapshot_section section;
+	if (!getSection(SNAPSHOT_SECTION_TOWNS, section)) {
+		setLastErrorString("Could not find the towns.");
+		return false;
+	}
+
+	PropStream propStream;
+	propStream.init(file.data() + section.offset, section.size);
+	for (uint32_t i = 0; i < section.count; ++i) {
+		uint32_t townId;
+		std::string townName;
+		OTBM_Destination_coords town_coords;
+		if (!propStream.read<uint32_t>(townId) || !propStream.readString(townName) || !propStream.read(town_coords)) {
+			setLastErrorString("Could not read town data.");
+			return false;
+		}
+
+		Town* town = map.towns.getTown(townId);
+		if (!town) {
+			town = new Town(townId);
+			map.towns.addTown(townId, town);
+		}
+
+		town->setName(townName);
+		town->setTemplePos(Position(town_coords.x, town_coords.y, town_coords.z));
+	}
+	return true;
+}
+
+bool IOMapSnapshot::loadWaypoints(Map& map)
+{
+	Snapshot_section section;
+	if (!getSection(SNAPSHOT_SECTION_WAYPOINTS, section)) {
+		setLastErrorString("Could not find the waypoints.");
+		return false;
+	}
+
+	PropStream propStream;
+	propStream.init(file.data() + section.offset, section.size);
+	for (uint32_t i = 0; i < section.count; ++i) {
+		std::string name;
+		OTBM_Destination_coords waypoint_coords;
+		if (!propStream.readString(name) || !propStream.read(waypoint_coords)) {
+			setLastErrorString("Could not read waypoint data.");
+			return false;
+		}
+
+		map.waypoints[name] = Position(waypoint_coords.x, waypoint_coords.y, waypoint_coords.z);
+	}
+	return true;
+}
+
+bool IOMapSnapshot::loadTiles(Map& map)
+{
+	Snapshot_section tilesSection, itemsSection;
+	if (!getSection(SNAPSHOT_SECTION_TILES, tilesSection) || !getSection(SNAPSHOT_SECTION_ITEMS, itemsSection) ||
+			tilesSection.size / sizeof(Snapshot_tile) < tilesSection.count) {
+		setLastErrorString("Could not find the tiles.");
+		return false;
+	}
+
+	const char* items = file.data() + itemsSection.offset;
+	for (uint32_t i = 0; i < tilesSection.count; ++i) {
+		Snapshot_tile record;
+		std::memcpy(&record, file.data() + tilesSection.offset + i * sizeof(Snapshot_tile), sizeof(Snapshot_tile));
+
+		const uint16_t x = record.x;
+		const uint16_t y = record.y;
+		const uint8_t z = record.z;
+		if (record.itemsOffset > itemsSection.size) {
+			std::ostringstream ss;
+			ss << "[x:" << x << ", y:" << y << ", z:" << static_cast<uint16_t>(z) << "] Could not find the items.";
+			setLastErrorString(ss.str());
+			return false;
+		}
+
+		Tile* tile;
+		if (record.type == SNAPSHOT_TILE_HOUSE) {
+			House* house = map.houses.addHouse(record.houseId);
+			if (!house) {
+				std::ostringstream ss;
+				ss << "[x:" << x << ", y:" << y << ", z:" << static_cast<uint16_t>(z) << "] Could not create house id: " << record.houseId;
+				setLastErrorString(ss.str());
+				return false;
+			}
+
+			HouseTile* houseTile = new HouseTile(x, y, z, house);
+			house->addTile(houseTile);
+			tile = houseTile;
+		} else if (record.type == SNAPSHOT_TILE_DYNAMIC) {
+			tile = new DynamicTile(x, y, z);
+		} else {
+			tile = new StaticTile(x, y, z);
+		}
+
+		PropStream propStream;
+		propStream.init(items + record.itemsOffset, itemsSection.size - record.itemsOffset);
+		for (uint32_t n = 0; n < record.itemCount; ++n) {
+			if (!loadItem(propStream, tile, nullptr)) {
+				std::ostringstream ss;
+				ss << "[x:" << x << ", y:" << y << ", z:" << static_cast<uint16_t>(z) << "] Failed to load item.";
+				setLastErrorString(ss.str());
+				delete tile;
+				return false;
+			}
+		}
+
+		tile->setFlag(static_cast<tileflags_t>(record.flags));
+		map.setTile(x, y, z, tile);
+	}
+	return true;
+}
+
+bool IOMapSnapshot::loadItem(PropStream& propStream, Tile* tile, Container* parent)
+{
+	uint16_t id;
+	if (!propStream.read<uint16_t>(id)) {
+		return false;
+	}
+
+	Item* item = Item::CreateItem(id);
+	if (!item) {
+		return false;
+	}
+
+	if (!item->unserializeAttr(propStream)) {
+		delete item;
+		return false;
+	}
+
+	if (Container* container = item->getContainer()) {
+		while (container->serializationCount > 0) {
+			if (!loadItem(propStream, nullptr, container)) {
+				delete item;
+				return false;
+			}
+			container->serializationCount--;
+		}
+
+		uint8_t endAttr;
+		if (!propStream.read<uint8_t>(endAttr) || endAttr != 0) {
+			delete item;
+			return false;
+		}
+	}
+
+	if (parent) {
+		parent->addItem(item);
+		parent->updateItemWeight(item->getWeight());
+		return true;
+	}
+
+	// decay starts over like for items read from the .otbm
+	item->setDecaying(DECAYING_FALSE);
+	const bool isGround = item->isGroundTile() && !tile->getGround();
+	tile->internalAddThing(item);
+	item->startDecaying();
+	if (!isGround) {
+		item->setLoadedFromMap(true);
+	}
+	return true;
+}
@@ -0,0 +1,136 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_IOMAPSNAPSHOT_H_D8F4395026614213811E04E11E661C4B
+#define FS_IOMAPSNAPSHOT_H_D8F4395026614213811E04E11E661C4B
+
+#include "fileloader.h"
+#include "map.h"
+
+/*
+	A snapshot holds what IOMap::loadMap reads from an .otbm file in flat sections
+	that are read straight from a memory mapped file:
+
+	header
+	section table
+	|--- SNAPSHOT_SECTION_FILES: spawn and house file names
+	|--- SNAPSHOT_SECTION_TOWNS: town id, name and temple position
+	|--- SNAPSHOT_SECTION_WAYPOINTS: waypoint name and position
+	|--- SNAPSHOT_SECTION_TILES: one fixed size record per tile
+	|--- SNAPSHOT_SECTION_ITEMS: item records the tile records point into
+
+	The header keeps hashes of the .otbm and items.otb it was built from, a
+	snapshot that does not match both is not used.
+*/
+
+enum SnapshotSection_t : uint32_t {
+	SNAPSHOT_SECTION_FILES = 1,
+	SNAPSHOT_SECTION_TOWNS = 2,
+	SNAPSHOT_SECTION_WAYPOINTS = 3,
+	SNAPSHOT_SECTION_TILES = 4,
+	SNAPSHOT_SECTION_ITEMS = 5,
+};
+
+enum SnapshotTileType_t : uint8_t {
+	SNAPSHOT_TILE_STATIC = 0,
+	SNAPSHOT_TILE_DYNAMIC = 1,
+	SNAPSHOT_TILE_HOUSE = 2,
+};
+
+#pragma pack(1)
+
+struct Snapshot_header {
+	std::array<char, 4> identifier;
+	uint32_t version;
+	uint64_t mapHash;
+	uint64_t itemsHash;
+	uint32_t majorVersionItems;
+	uint32_t minorVersionItems;
+	uint32_t buildNumberItems;
+	uint16_t width;
+	uint16_t height;
+	uint32_t sectionCount;
+};
+
+struct Snapshot_section {
+	uint32_t type;
+	uint32_t count;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct Snapshot_tile {
+	uint16_t x;
+	uint16_t y;
+	uint8_t z;
+	uint8_t type;
+	uint32_t flags;
+	uint32_t houseId;
+	uint32_t itemCount;
+	uint64_t itemsOffset;
+};
+
+#pragma pack()
+
+class IOMapSnapshot
+{
+	public:
+		static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+		// data/world/map.otbm keeps its snapshot in data/world/map.snapshot
+		static std::string getSnapshotFileName(const std::string& mapFileName);
+
+		/* Writes a snapshot of a map right after it was loaded from mapFileName
+		 * \returns Returns true if the snapshot was written
+		 */
+		bool saveMap(const Map& map, const std::string& mapFileName);
+
+		/* Maps the snapshot of mapFileName and checks it against the .otbm and items.otb
+		 * \returns Returns false if there is no usable snapshot, the map is left untouched
+		 */
+		bool open(const std::string& mapFileName);
+
+		/* Fills the map from an opened snapshot
+		 * \returns Returns false if the snapshot is damaged, the map may be partially loaded
+		 */
+		bool loadMap(Map& map);
+
+		const std::string& getLastErrorString() const {
+			return errorString;
+		}
+
+		void setLastErrorString(std::string error) {
+			errorString = std::move(error);
+		}
+
+	private:
+		bool getSection(SnapshotSection_t type, Snapshot_section& section) const;
+		bool loadTowns(Map& map);
+		bool loadWaypoints(Map& map);
+		bool loadTiles(Map& map);
+		bool loadItem(PropStream& propStream, Tile* tile, Container* parent);
+
+		OTB::MappedFile file;
+		Snapshot_header header;
+		std::vector<Snapshot_section> sections;
+		std::string errorString;
+};
+
+#endif
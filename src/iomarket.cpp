@@ -34,24 +34,29 @@ MarketOfferList IOMarket::getActiveOffers(MarketAction_t action, uint16_t itemId
 {
 	MarketOfferList offerList;
 
-	std::ostringstream query;
-	query << "SELECT `id`, `amount`, `price`, `created`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `sale` = " << action << " AND `itemtype` = " << itemId;
+	DBStatement* statement = Database::getInstance().prepare("SELECT `id`, `amount`, `price`, `created`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `sale` = ? AND `itemtype` = ?");
+	if (!statement) {
+		return offerList;
+	}
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
+	statement->bind(0, static_cast<uint8_t>(action));
+	statement->bind(1, itemId);
+	DBStatementResult_ptr result = statement->storeQuery();
 	if (!result) {
 		return offerList;
 	}
 
 	const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
+	// columns in the order of the select
 	do {
 		MarketOffer offer;
-		offer.amount = result->getNumber<uint16_t>("amount");
-		offer.price = result->getNumber<uint32_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-		offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-		if (result->getNumber<uint16_t>("anonymous") == 0) {
-			offer.playerName = result->getString("player_name");
+		offer.amount = result->getNumber<uint16_t>(1);
+		offer.price = result->getNumber<uint32_t>(2);
+		offer.timestamp = result->getNumber<uint32_t>(3) + marketOfferDuration;
+		offer.counter = result->getNumber<uint32_t>(0) & 0xFFFF;
+		if (result->getNumber<uint16_t>(4) == 0) {
+			offer.playerName = result->getString(5);
 		} else {
 			offer.playerName = "Anonymous";
 		}
@@ -66,21 +71,25 @@ MarketOfferList IOMarket::getOwnOffers(MarketAction_t action, uint32_t playerId)
 
 	const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-	std::ostringstream query;
-	query << "SELECT `id`, `amount`, `price`, `created`, `itemtype` FROM `market_offers` WHERE `player_id` = " << playerId << " AND `sale` = " << action;
+	DBStatement* statement = Database::getInstance().prepare("SELECT `id`, `amount`, `price`, `created`, `itemtype` FROM `market_offers` WHERE `player_id` = ? AND `sale` = ?");
+	if (!statement) {
+		return offerList;
+	}
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
+	statement->bind(0, playerId);
+	statement->bind(1, static_cast<uint8_t>(action));
+	DBStatementResult_ptr result = statement->storeQuery();
 	if (!result) {
 		return offerList;
 	}
 
 	do {
 		MarketOffer offer;
-		offer.amount = result->getNumber<uint16_t>("amount");
-		offer.price = result->getNumber<uint32_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-		offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-		offer.itemId = result->getNumber<uint16_t>("itemtype");
+		offer.amount = result->getNumber<uint16_t>(1);
+		offer.price = result->getNumber<uint32_t>(2);
+		offer.timestamp = result->getNumber<uint32_t>(3) + marketOfferDuration;
+		offer.counter = result->getNumber<uint32_t>(0) & 0xFFFF;
+		offer.itemId = result->getNumber<uint16_t>(4);
 		offerList.push_back(offer);
 	} while (result->next());
 	return offerList;
@@ -90,22 +99,26 @@ HistoryMarketOfferList IOMarket::getOwnHistory(MarketAction_t action, uint32_t p
 {
 	HistoryMarketOfferList offerList;
 
-	std::ostringstream query;
-	query << "SELECT `itemtype`, `amount`, `price`, `expires_at`, `state` FROM `market_history` WHERE `player_id` = " << playerId << " AND `sale` = " << action;
+	DBStatement* statement = Database::getInstance().prepare("SELECT `itemtype`, `amount`, `price`, `expires_at`, `state` FROM `market_history` WHERE `player_id` = ? AND `sale` = ?");
+	if (!statement) {
+		return offerList;
+	}
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
+	statement->bind(0, playerId);
+	statement->bind(1, static_cast<uint8_t>(action));
+	DBStatementResult_ptr result = statement->storeQuery();
 	if (!result) {
 		return offerList;
 	}
 
 	do {
 		HistoryMarketOffer offer;
-		offer.itemId = result->getNumber<uint16_t>("itemtype");
-		offer.amount = result->getNumber<uint16_t>("amount");
-		offer.price = result->getNumber<uint32_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("expires_at");
+		offer.itemId = result->getNumber<uint16_t>(0);
+		offer.amount = result->getNumber<uint16_t>(1);
+		offer.price = result->getNumber<uint32_t>(2);
+		offer.timestamp = result->getNumber<uint32_t>(3);
 
-		MarketOfferState_t offerState = static_cast<MarketOfferState_t>(result->getNumber<uint16_t>("state"));
+		MarketOfferState_t offerState = static_cast<MarketOfferState_t>(result->getNumber<uint16_t>(4));
 		if (offerState == OFFERSTATE_ACCEPTEDEX) {
 			offerState = OFFERSTATE_ACCEPTED;
 		}
@@ -225,25 +238,29 @@ MarketOfferEx IOMarket::getOfferByCounter(uint32_t timestamp, uint16_t counter)
 
 	const int32_t created = timestamp - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-	std::ostringstream query;
-	query << "SELECT `id`, `sale`, `itemtype`, `amount`, `created`, `price`, `player_id`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `created` = " << created << " AND (`id` & 65535) = " << counter << " LIMIT 1";
+	DBStatement* statement = Database::getInstance().prepare("SELECT `id`, `sale`, `itemtype`, `amount`, `created`, `price`, `player_id`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `created` = ? AND (`id` & 65535) = ? LIMIT 1");
+	DBStatementResult_ptr result;
+	if (statement) {
+		statement->bind(0, created);
+		statement->bind(1, counter);
+		result = statement->storeQuery();
+	}
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
 	if (!result) {
 		offer.id = 0;
 		return offer;
 	}
 
-	offer.id = result->getNumber<uint32_t>("id");
-	offer.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
-	offer.amount = result->getNumber<uint16_t>("amount");
-	offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-	offer.timestamp = result->getNumber<uint32_t>("created");
-	offer.price = result->getNumber<uint32_t>("price");
-	offer.itemId = result->getNumber<uint16_t>("itemtype");
-	offer.playerId = result->getNumber<uint32_t>("player_id");
-	if (result->getNumber<uint16_t>("anonymous") == 0) {
-		offer.playerName = result->getString("player_name");
+	offer.id = result->getNumber<uint32_t>(0);
+	offer.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>(1));
+	offer.amount = result->getNumber<uint16_t>(3);
+	offer.counter = result->getNumber<uint32_t>(0) & 0xFFFF;
+	offer.timestamp = result->getNumber<uint32_t>(4);
+	offer.price = result->getNumber<uint32_t>(5);
+	offer.itemId = result->getNumber<uint16_t>(2);
+	offer.playerId = result->getNumber<uint32_t>(6);
+	if (result->getNumber<uint16_t>(7) == 0) {
+		offer.playerName = result->getString(8);
 	} else {
 		offer.playerName = "Anonymous";
 	}
@@ -277,7 +294,7 @@ void IOMarket::appendHistory(uint32_t playerId, MarketAction_t type, uint16_t it
 	query << "INSERT INTO `market_history` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `expires_at`, `inserted`, `state`) VALUES ("
 		<< playerId << ',' << type << ',' << itemId << ',' << amount << ',' << price << ','
 		<< timestamp << ',' << time(nullptr) << ',' << state << ')';
-	g_databaseTasks.addTask(query.str());
+	g_databaseTasks.addTask(query.str(), nullptr, false, playerId);
 }
 
 bool IOMarket::moveOfferToHistory(uint32_t offerId, MarketOfferState_t state)
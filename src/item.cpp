@@ -39,6 +39,7 @@ extern Vocations g_vocations;
 extern Imbuements g_imbuements;
 
 Items Item::items;
+thread_local bool Item::deferUniqueIds = false;
 
 Item* Item::CreateItem(const uint16_t type, uint16_t count /*= 0*/)
 {
@@ -2263,7 +2264,7 @@ void Item::setUniqueId(uint16_t n)
 		return;
 	}
 
-	if (g_game.addUniqueItem(n, this)) {
+	if (deferUniqueIds || g_game.addUniqueItem(n, this)) {
 		getAttributes()->setUniqueId(n);
 	}
 }
@@ -541,6 +541,8 @@ class Item : virtual public Thing
 		static Container* CreateItemAsContainer(const uint16_t type, uint16_t size);
 		static Item* CreateItem(PropStream& propStream);
 		static Items items;
+		// set on map loader threads, unique ids read there are only stored and the loader registers them in map order
+		static thread_local bool deferUniqueIds;
 
 		// Constructor for items
 		Item(const uint16_t type, uint16_t count = 0);
@@ -24,6 +24,9 @@
 #define _ENABLE_ATOMIC_ALIGNMENT_FIX
 #endif
 
+#include <array>
+#include <atomic>
+
 #include <boost/lockfree/stack.hpp>
 
 /*
@@ -74,4 +77,77 @@ class LockfreePoolingAllocator : public std::allocator<T>
 		}
 };
 
+struct LockfreePoolStats
+{
+	std::atomic<uint64_t> sharedAllocations {0};
+	std::atomic<uint64_t> heapAllocations {0};
+	std::atomic<uint64_t> heapDeallocations {0};
+};
+
+/*
+ * Pool of fixed size blocks, every thread keeps a small cache of free blocks
+ * in front of the shared LockfreeFreeList. Blocks released by a consumer thread
+ * (e.g. the dispatcher) overflow into the shared list where the producer
+ * threads pick them up again, so only the slow paths are counted in the stats.
+ */
+template <std::size_t TSize, size_t CAPACITY, size_t CACHE_CAPACITY>
+class LockfreeCachedPool
+{
+	public:
+		static void* allocate() {
+			ThreadCache& cache = getCache();
+			if (cache.size != 0) {
+				return cache.blocks[--cache.size];
+			}
+
+			void* p;
+			if (LockfreeFreeList<TSize, CAPACITY>::get().pop(p)) {
+				getStats().sharedAllocations.fetch_add(1, std::memory_order_relaxed);
+				return p;
+			}
+
+			getStats().heapAllocations.fetch_add(1, std::memory_order_relaxed);
+			return operator new (TSize);
+		}
+
+		static void deallocate(void* p) {
+			ThreadCache& cache = getCache();
+			if (cache.size != CACHE_CAPACITY) {
+				cache.blocks[cache.size++] = p;
+				return;
+			}
+			release(p);
+		}
+
+		static LockfreePoolStats& getStats() {
+			static LockfreePoolStats stats;
+			return stats;
+		}
+
+	private:
+		static void release(void* p) {
+			if (!LockfreeFreeList<TSize, CAPACITY>::get().bounded_push(p)) {
+				getStats().heapDeallocations.fetch_add(1, std::memory_order_relaxed);
+				operator delete(p);
+			}
+		}
+
+		struct ThreadCache
+		{
+			~ThreadCache() {
+				while (size != 0) {
+					release(blocks[--size]);
+				}
+			}
+
+			std::array<void*, CACHE_CAPACITY> blocks;
+			size_t size = 0;
+		};
+
+		static ThreadCache& getCache() {
+			static thread_local ThreadCache cache;
+			return cache;
+		}
+};
+
 #endif
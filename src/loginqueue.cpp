@@ -0,0 +1,113 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "loginqueue.h"
+#include "database.h"
+
+LoginQueue::~LoginQueue()
+{
+	shutdown();
+}
+
+void LoginQueue::start(size_t threadCount, size_t maxQueued)
+{
+	this->maxQueued = maxQueued;
+	stopping = false;
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&LoginQueue::threadMain, this);
+	}
+}
+
+void LoginQueue::shutdown()
+{
+	std::deque<Job> dropped;
+	{
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		stopping = true;
+		dropped.swap(jobs);
+	}
+	jobSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+
+	for (Job& job : dropped) {
+		if (job.drop) {
+			job.drop();
+		}
+	}
+}
+
+bool LoginQueue::tryAddJob(std::function<void()> job, std::function<void()> drop/* = nullptr*/)
+{
+	if (isRunning()) {
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		if (maxQueued != 0 && jobs.size() >= maxQueued) {
+			return false;
+		}
+	}
+	addJob(std::move(job), std::move(drop));
+	return true;
+}
+
+void LoginQueue::addJob(std::function<void()> job, std::function<void()> drop/* = nullptr*/)
+{
+	if (!isRunning()) {
+		job();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> jobLockUnique(jobLock);
+		if (stopping) {
+			jobLockUnique.unlock();
+			if (drop) {
+				drop();
+			}
+			return;
+		}
+		jobs.push_back({std::move(job), std::move(drop)});
+	}
+	jobSignal.notify_one();
+}
+
+void LoginQueue::threadMain()
+{
+	std::unique_lock<std::mutex> jobLockUnique(jobLock);
+	while (true) {
+		jobSignal.wait(jobLockUnique, [this]() { return stopping || !jobs.empty(); });
+		if (stopping) {
+			break;
+		}
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		jobLockUnique.unlock();
+		job.run();
+		jobLockUnique.lock();
+	}
+	jobLockUnique.unlock();
+
+	Database::getInstance().releaseConnection();
+}
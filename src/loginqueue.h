@@ -0,0 +1,77 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_LOGINQUEUE_H_8525C282E5064646A21B8DDFB746D96B
+#define FS_LOGINQUEUE_H_8525C282E5064646A21B8DDFB746D96B
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+  * Runs the database half of logins, reading and building the player, on a pool of its own threads.
+  * The dispatcher only gets the checks against the online players and the placement that follows.
+  */
+class LoginQueue
+{
+	public:
+		LoginQueue() = default;
+		~LoginQueue();
+
+		// non-copyable
+		LoginQueue(const LoginQueue&) = delete;
+		LoginQueue& operator=(const LoginQueue&) = delete;
+
+		// 0 threads runs every job on the calling thread, as logins did before
+		void start(size_t threadCount, size_t maxQueued);
+		// drops the jobs that did not start and runs their drop callbacks on the calling thread
+		void shutdown();
+
+		bool isRunning() const {
+			return !threads.empty();
+		}
+
+		// false when maxQueued jobs are already waiting, the job is not kept then
+		bool tryAddJob(std::function<void()> job, std::function<void()> drop = nullptr);
+		// for logins the waiting list already let in, those are bounded there
+		// drop runs instead of job when the queue is stopped before the job started, to release what it holds
+		void addJob(std::function<void()> job, std::function<void()> drop = nullptr);
+
+	private:
+		struct Job {
+			std::function<void()> run;
+			std::function<void()> drop;
+		};
+
+		void threadMain();
+
+		std::vector<std::thread> threads;
+		std::deque<Job> jobs;
+		std::mutex jobLock;
+		std::condition_variable jobSignal;
+		size_t maxQueued = 0;
+		bool stopping = false;
+};
+
+extern LoginQueue g_loginQueue;
+
+#endif
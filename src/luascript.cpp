@@ -20,6 +20,7 @@
 #include "otpch.h"
 
 #include <boost/range/adaptor/reversed.hpp>
+#include <string_view>
 
 #include "luascript.h"
 #include "chat.h"
@@ -2120,6 +2121,11 @@ void LuaScriptInterface::registerFunctions()
 	registerEnumIn("configKeys", ConfigManager::WEATHER_THUNDER)
 	registerEnumIn("configKeys", ConfigManager::FREE_QUESTS)
 	registerEnumIn("configKeys", ConfigManager::ALL_CONSOLE_LOG)
+	registerEnumIn("configKeys", ConfigManager::SCHEDULER_TIMING_WHEEL)
+	registerEnumIn("configKeys", ConfigManager::GAME_LOOP_TICK_MODE)
+	registerEnumIn("configKeys", ConfigManager::PACKET_COMPRESSION)
+	registerEnumIn("configKeys", ConfigManager::MAP_SNAPSHOT)
+	registerEnumIn("configKeys", ConfigManager::ASYNC_PLAYER_SAVE)
 
 	registerEnumIn("configKeys", ConfigManager::SERVER_SAVE_NOTIFY_MESSAGE)
 	registerEnumIn("configKeys", ConfigManager::SERVER_SAVE_NOTIFY_DURATION)
@@ -2151,6 +2157,15 @@ void LuaScriptInterface::registerFunctions()
 	registerEnumIn("configKeys", ConfigManager::STORE_IMAGES_URL)
 	registerEnumIn("configKeys", ConfigManager::CLIENT_VERSION_STR)
 	registerEnumIn("configKeys", ConfigManager::PARTY_LIST_MAX_DISTANCE)
+	registerEnumIn("configKeys", ConfigManager::GAME_LOOP_FRAME_TIME)
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_PROFILER_INTERVAL)
+	registerEnumIn("configKeys", ConfigManager::NETWORK_THREADS)
+	registerEnumIn("configKeys", ConfigManager::MAP_LOADER_THREADS)
+	registerEnumIn("configKeys", ConfigManager::CREATURE_THINK_THREADS)
+	registerEnumIn("configKeys", ConfigManager::DATABASE_WORKER_THREADS)
+	registerEnumIn("configKeys", ConfigManager::LOGIN_THREADS)
+	registerEnumIn("configKeys", ConfigManager::LOGIN_QUEUE_SIZE)
+	registerEnumIn("configKeys", ConfigManager::PACKET_COMPRESSION_LEVEL)
 
 	registerEnumIn("configKeys", ConfigManager::SQL_PORT)
 	registerEnumIn("configKeys", ConfigManager::MAX_PLAYERS)
@@ -4368,12 +4383,26 @@ int LuaScriptInterface::luaAddEvent(lua_State* L)
 	uint32_t delay = std::max<uint32_t>(100, getNumber<uint32_t>(globalState, 2));
 	lua_pop(globalState, 1);
 
+	// profile the timer under the place the callback was defined, the name is built once per place
+	lua_Debug debug;
+	lua_pushvalue(globalState, -1);
+	lua_getinfo(globalState, ">S", &debug);
+	size_t source = std::hash<std::string_view>()(debug.short_src) * 31 + static_cast<size_t>(debug.linedefined);
+	auto categoryIt = g_luaEnvironment.timerEventCategories.find(source);
+	if (categoryIt == g_luaEnvironment.timerEventCategories.end()) {
+		uint16_t newCategory = TaskProfiler::getInstance().registerCategory(
+			std::string("addEvent ") + debug.short_src + ':' + std::to_string(debug.linedefined), TASK_CATEGORY_LUA_EVENT
+		);
+		categoryIt = g_luaEnvironment.timerEventCategories.emplace(source, newCategory).first;
+	}
+	uint16_t category = categoryIt->second;
+
 	eventDesc.function = luaL_ref(globalState, LUA_REGISTRYINDEX);
 	eventDesc.scriptId = getScriptEnv()->getScriptId();
 
 	auto& lastTimerEventId = g_luaEnvironment.lastEventTimerId;
 	eventDesc.eventId = g_scheduler.addEvent(createSchedulerTask(
-		delay, std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId)
+		delay, std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId), category
 	));
 
 	g_luaEnvironment.timerEvents.emplace(lastTimerEventId, std::move(eventDesc));
@@ -4903,7 +4932,7 @@ int LuaScriptInterface::luaGameGetSpectators(lua_State* L)
 	int32_t minRangeY = getNumber<int32_t>(L, 6, 0);
 	int32_t maxRangeY = getNumber<int32_t>(L, 7, 0);
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
 
 	lua_createtable(L, spectators.size(), 0);
@@ -5703,7 +5732,7 @@ int LuaScriptInterface::luaPositionIsSightClear(lua_State* L)
 int LuaScriptInterface::luaPositionSendMagicEffect(lua_State* L)
 {
 	// position:sendMagicEffect(magicEffect[, player = nullptr])
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	if (lua_gettop(L) >= 3) {
 		Player* player = getPlayer(L, 3);
 		if (player) {
@@ -5726,7 +5755,7 @@ int LuaScriptInterface::luaPositionSendMagicEffect(lua_State* L)
 int LuaScriptInterface::luaPositionSendDistanceEffect(lua_State* L)
 {
 	// position:sendDistanceEffect(positionEx, distanceEffect[, player = nullptr])
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	if (lua_gettop(L) >= 4) {
 		Player* player = getPlayer(L, 4);
 		if (player) {
@@ -8254,7 +8283,7 @@ int LuaScriptInterface::luaCreatureReload(lua_State* L)
 	}
 
 	const Position& position = creature->getPosition();
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, false, true); // 3 parâmetro é multifloor, ver se há necessidade de usar.
 	for (Creature* spectator : spectators) {
 		Player* tmpPlayer = spectator->getPlayer();
@@ -8783,7 +8812,7 @@ int LuaScriptInterface::luaCreatureSay(lua_State* L)
 		return 1;
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	if (target) {
 		spectators.insert(target);
 	}
@@ -11969,7 +11998,7 @@ int LuaScriptInterface::luaPlayerSetGhostMode(lua_State* L)
 	Tile* tile = player->getTile();
 	const Position& position = player->getPosition();
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, true, true);
 	for (Creature* spectator : spectators) {
 		Player* tmpPlayer = spectator->getPlayer();
@@ -12416,7 +12445,7 @@ int LuaScriptInterface::luaMonsterSetType(lua_State* L) {
 			}
 		}
 		// Reload creature on spectators
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, monster->getPosition(), true);
 		for (Creature* spectator : spectators) {
 			if (Player* tmpPlayer = spectator->getPlayer()) {
@@ -1757,6 +1757,8 @@ class LuaEnvironment : public LuaScriptInterface
 		void executeTimerEvent(uint32_t eventIndex);
 
 		std::unordered_map<uint32_t, LuaTimerEventDesc> timerEvents;
+		// profiler categories of addEvent callbacks by a hash of where they were defined, see luaAddEvent
+		std::unordered_map<size_t, uint16_t> timerEventCategories;
 		std::unordered_map<uint32_t, Combat*> combatMap;
 		std::unordered_map<uint32_t, AreaCombat*> areaMap;
 
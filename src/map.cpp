@@ -21,20 +21,35 @@
 
 #include "iomap.h"
 #include "iomapserialize.h"
+#include "iomapsnapshot.h"
 #include "combat.h"
 #include "creature.h"
 #include "game.h"
 #include "monster.h"
+#include "scheduler.h"
 
 extern Game g_game;
+extern Scheduler g_scheduler;
 
 bool Map::loadMap(const std::string& identifier, bool loadHouses, bool loadSpawns)
 {
 	int64_t start = OTSYS_TIME();
-	IOMap loader;
-	if (!loader.loadMap(this, identifier)) {
-		SPDLOG_ERROR("[Map::loadMap] - {}", loader.getLastErrorString());
-		return false;
+	IOMapSnapshot snapshot;
+	if (g_config.getBoolean(ConfigManager::MAP_SNAPSHOT) && snapshot.open(identifier)) {
+		if (!snapshot.loadMap(*this)) {
+			SPDLOG_ERROR("[Map::loadMap] - {}", snapshot.getLastErrorString());
+			return false;
+		}
+	} else {
+		if (g_config.getBoolean(ConfigManager::MAP_SNAPSHOT)) {
+			SPDLOG_WARN("[Map::loadMap] - {}, loading {} instead", snapshot.getLastErrorString(), identifier);
+		}
+
+		IOMap loader;
+		if (!loader.loadMap(this, identifier)) {
+			SPDLOG_ERROR("[Map::loadMap] - {}", loader.getLastErrorString());
+			return false;
+		}
 	}
 
 	if (loadSpawns) {
@@ -86,7 +101,7 @@ Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
 		return nullptr;
 	}
 
-	const QTreeLeafNode* leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+	const QTreeLeafNode* leaf = getQTNode(x, y);
 	if (!leaf) {
 		return nullptr;
 	}
@@ -107,35 +122,43 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	}
 
 	QTreeLeafNode::newLeaf = false;
+#ifdef MAP_SECTOR_STORAGE
+	QTreeLeafNode* leaf = sectors.createSector(x, y);
+#else
 	QTreeLeafNode* leaf = root.createLeaf(x, y, 15);
+#endif
 
 	if (QTreeLeafNode::newLeaf) {
 		//update north
-		QTreeLeafNode* northLeaf = root.getLeaf(x, y - FLOOR_SIZE);
+		QTreeLeafNode* northLeaf = getQTNode(x, y - FLOOR_SIZE);
 		if (northLeaf) {
 			northLeaf->leafS = leaf;
 		}
 
 		//update west leaf
-		QTreeLeafNode* westLeaf = root.getLeaf(x - FLOOR_SIZE, y);
+		QTreeLeafNode* westLeaf = getQTNode(x - FLOOR_SIZE, y);
 		if (westLeaf) {
 			westLeaf->leafE = leaf;
 		}
 
 		//update south
-		QTreeLeafNode* southLeaf = root.getLeaf(x, y + FLOOR_SIZE);
+		QTreeLeafNode* southLeaf = getQTNode(x, y + FLOOR_SIZE);
 		if (southLeaf) {
 			leaf->leafS = southLeaf;
 		}
 
 		//update east
-		QTreeLeafNode* eastLeaf = root.getLeaf(x + FLOOR_SIZE, y);
+		QTreeLeafNode* eastLeaf = getQTNode(x + FLOOR_SIZE, y);
 		if (eastLeaf) {
 			leaf->leafE = eastLeaf;
 		}
 	}
 
+#ifdef MAP_SECTOR_STORAGE
+	Floor* floor = sectors.createFloor(leaf, z);
+#else
 	Floor* floor = leaf->createFloor(z);
+#endif
 	uint32_t offsetX = x & FLOOR_MASK;
 	uint32_t offsetY = y & FLOOR_MASK;
 
@@ -158,6 +181,54 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	} else {
 		tile = newTile;
 	}
+	floor->setProjectileBlocking(x, y, tile->hasFlag(TILESTATE_BLOCKPROJECTILE));
+}
+
+namespace {
+
+void forEachLeafTile(const QTreeLeafNode& leaf, const std::function<void(Tile*)>& callback)
+{
+	for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+		const Floor* floor = leaf.getFloor(z);
+		if (!floor) {
+			continue;
+		}
+
+		for (auto& row : floor->tiles) {
+			for (Tile* tile : row) {
+				if (tile) {
+					callback(tile);
+				}
+			}
+		}
+	}
+}
+
+}
+
+void Map::forEachTile(const std::function<void(Tile*)>& callback) const
+{
+#ifdef MAP_SECTOR_STORAGE
+	for (const QTreeLeafNode& sector : sectors.getSectors()) {
+		forEachLeafTile(sector, callback);
+	}
+#else
+	std::vector<const QTreeNode*> nodes {&root};
+	while (!nodes.empty()) {
+		const QTreeNode* node = nodes.back();
+		nodes.pop_back();
+		if (node->isLeaf()) {
+			forEachLeafTile(*static_cast<const QTreeLeafNode*>(node), callback);
+			continue;
+		}
+
+		for (const QTreeNode* child : node->child) {
+			if (child) {
+				nodes.push_back(child);
+			}
+		}
+	}
+#endif
 }
 
 bool Map::placeCreature(const Position& centerPos, Creature* creature, bool extendedPos/* = false*/, bool forceLogin/* = false*/)
@@ -257,7 +328,7 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 
 	bool teleport = forceTeleport || !newTile.getGround() || !Position::areInRange<1, 1, 0>(oldPos, newPos);
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	getSpectators(spectators, oldPos, true);
 	getSpectators(spectators, newPos, true);
 
@@ -322,7 +393,7 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 	newTile.postAddNotification(&creature, &oldTile, 0);
 }
 
-void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
+void Map::getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
 {
 	int_fast32_t min_y = centerPos.y + minRangeY;
 	int_fast32_t min_x = centerPos.x + minRangeX;
@@ -342,7 +413,7 @@ void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& ce
 	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
 	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
 
-	const QTreeLeafNode* startLeaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, starty1);
+	const QTreeLeafNode* startLeaf = getQTNode(startx1, starty1);
 	const QTreeLeafNode* leafS = startLeaf;
 	const QTreeLeafNode* leafE;
 
@@ -362,119 +433,105 @@ void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& ce
 						continue;
 					}
 
-					spectators.insert(creature);
+					spectators.emplace_back(creature);
 				}
 				leafE = leafE->leafE;
 			} else {
-				leafE = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, nx + FLOOR_SIZE, ny);
+				leafE = getQTNode(nx + FLOOR_SIZE, ny);
 			}
 		}
 
 		if (leafS) {
 			leafS = leafS->leafS;
 		} else {
-			leafS = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, ny + FLOOR_SIZE);
+			leafS = getQTNode(startx1, ny + FLOOR_SIZE);
 		}
 	}
 }
 
-void Map::getSpectators(SpectatorHashSet& spectators, const Position& centerPos, bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
+void Map::getSpectators(SpectatorVec& spectators, const Position& centerPos, bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
 {
 	if (centerPos.z >= MAP_MAX_LAYERS) {
 		return;
 	}
 
-	bool foundCache = false;
-	bool cacheResult = false;
-
 	minRangeX = (minRangeX == 0 ? -maxViewportX : -minRangeX);
 	maxRangeX = (maxRangeX == 0 ? maxViewportX : maxRangeX);
 	minRangeY = (minRangeY == 0 ? -maxViewportY : -minRangeY);
 	maxRangeY = (maxRangeY == 0 ? maxViewportY : maxRangeY);
 
-	if (minRangeX == -maxViewportX && maxRangeX == maxViewportX && minRangeY == -maxViewportY && maxRangeY == maxViewportY && multifloor) {
-		if (onlyPlayers) {
-			auto it = playersSpectatorCache.find(centerPos);
-			if (it != playersSpectatorCache.end()) {
-				if (!spectators.empty()) {
-					const SpectatorHashSet& cachedSpectators = it->second;
-					spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
-				} else {
-					spectators = it->second;
-				}
-
-				foundCache = true;
-			}
-		}
-
-		if (!foundCache) {
-			auto it = spectatorCache.find(centerPos);
-			if (it != spectatorCache.end()) {
-				if (!onlyPlayers) {
-					if (!spectators.empty()) {
-						const SpectatorHashSet& cachedSpectators = it->second;
-						spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
-					} else {
-						spectators = it->second;
-					}
-				} else {
-					const SpectatorHashSet& cachedSpectators = it->second;
-					for (Creature* spectator : cachedSpectators) {
-						if (spectator->getPlayer()) {
-							spectators.insert(spectator);
-						}
-					}
-				}
-
-				foundCache = true;
-			} else {
-				cacheResult = true;
-			}
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+
+	if (multifloor) {
+		if (centerPos.z > 7) {
+			//underground
+
+			//8->15
+			minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+			maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
+		} else if (centerPos.z == 6) {
+			minRangeZ = 0;
+			maxRangeZ = 8;
+		} else if (centerPos.z == 7) {
+			minRangeZ = 0;
+			maxRangeZ = 9;
+		} else {
+			minRangeZ = 0;
+			maxRangeZ = 7;
 		}
+	} else {
+		minRangeZ = centerPos.z;
+		maxRangeZ = centerPos.z;
 	}
 
-	if (!foundCache) {
-		int32_t minRangeZ;
-		int32_t maxRangeZ;
-
-		if (multifloor) {
-			if (centerPos.z > 7) {
-				//underground
+	// the leaves keep their creature lists up to date on every move, so they are read directly
+	if (spectators.empty()) {
+		getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+	} else {
+		SpectatorVec found;
+		getSpectatorsInternal(found, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+		spectators.addSpectators(found);
+	}
+}
 
-				//8->15
-				minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-				maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-			} else if (centerPos.z == 6) {
-				minRangeZ = 0;
-				maxRangeZ = 8;
-			} else if (centerPos.z == 7) {
-				minRangeZ = 0;
-				maxRangeZ = 9;
-			} else {
-				minRangeZ = 0;
-				maxRangeZ = 7;
-			}
-		} else {
-			minRangeZ = centerPos.z;
-			maxRangeZ = centerPos.z;
-		}
+void Map::onTileCreatureChange(const Position& pos)
+{
+	if (QTreeLeafNode* leaf = getQTNode(pos.x, pos.y)) {
+		++leaf->version;
+	}
+}
 
-		getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+void Map::onTileItemChange(const Position& pos, const Item& item)
+{
+	// corpses, loot and decoration do not change where creatures can walk
+	if (!item.isGroundTile() && Item::items[item.getID()].floorChange == 0 && !item.getMagicField() && !item.getTeleport() &&
+			!item.hasProperty(CONST_PROP_BLOCKSOLID) && !item.hasProperty(CONST_PROP_BLOCKPATH) &&
+			!item.hasProperty(CONST_PROP_NOFIELDBLOCKPATH) && !item.hasProperty(CONST_PROP_IMMOVABLENOFIELDBLOCKPATH)) {
+		return;
+	}
 
-		if (cacheResult) {
-			if (onlyPlayers) {
-				playersSpectatorCache[centerPos] = spectators;
-			} else {
-				spectatorCache[centerPos] = spectators;
-			}
-		}
+	if (QTreeLeafNode* leaf = getQTNode(pos.x, pos.y)) {
+		++leaf->version;
 	}
+	flowFields.onTileChange(pos);
 }
 
-void Map::clearSpectatorCache()
+void Map::setProjectileBlocking(const Position& pos, bool blocking)
 {
-	spectatorCache.clear();
-	playersSpectatorCache.clear();
+	if (pos.z >= MAP_MAX_LAYERS) {
+		return;
+	}
+
+	QTreeLeafNode* leaf = getQTNode(pos.x, pos.y);
+	if (!leaf) {
+		return;
+	}
+
+	Floor* floor = leaf->getFloor(pos.z);
+	if (floor) {
+		floor->setProjectileBlocking(pos.x, pos.y, blocking);
+	}
 }
 
 bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight /*= true*/,
@@ -507,42 +564,143 @@ bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool
 	return isSightClear(fromPos, toPos, false);
 }
 
-bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
+namespace {
+
+// walks the tiles of a sight line from start to destination, excluding start, until visit returns false
+template <typename Visit>
+bool walkSightLine(int32_t x, int32_t y, int32_t destX, int32_t destY, Visit&& visit)
 {
-	if (fromPos == toPos) {
-		return true;
+	const int32_t mx = x < destX ? 1 : x == destX ? 0 : -1;
+	const int32_t my = y < destY ? 1 : y == destY ? 0 : -1;
+
+	const int32_t A = destY - y;
+	const int32_t B = x - destX;
+	const int32_t C = -(A * destX + B * destY);
+
+	while (x != destX || y != destY) {
+		int32_t move_hor = std::abs(A * (x + mx) + B * (y) + C);
+		int32_t move_ver = std::abs(A * (x) + B * (y + my) + C);
+		int32_t move_cross = std::abs(A * (x + mx) + B * (y + my) + C);
+
+		if (y != destY && (x == destX || move_hor > move_ver || move_hor > move_cross)) {
+			y += my;
+		}
+
+		if (x != destX && (y == destY || move_ver > move_hor || move_ver > move_cross)) {
+			x += mx;
+		}
+
+		if (!visit(x, y)) {
+			return false;
+		}
 	}
+	return true;
+}
 
-	Position start(fromPos.z > toPos.z ? toPos : fromPos);
-	Position destination(fromPos.z > toPos.z ? fromPos : toPos);
+// sight lines only depend on the offset between both ends, so the ones within
+// this range are walked once and kept as relative steps
+constexpr int32_t SIGHT_TABLE_RANGE = 16;
+constexpr int32_t SIGHT_TABLE_WIDTH = SIGHT_TABLE_RANGE * 2 + 1;
 
-	const int8_t mx = start.x < destination.x ? 1 : start.x == destination.x ? 0 : -1;
-	const int8_t my = start.y < destination.y ? 1 : start.y == destination.y ? 0 : -1;
+class SightTable
+{
+	public:
+		struct Step {
+			int8_t x, y;
+		};
 
-	int32_t A = Position::getOffsetY(destination, start);
-	int32_t B = Position::getOffsetX(start, destination);
-	int32_t C = -(A * destination.x + B * destination.y);
+		SightTable() {
+			for (int32_t dx = -SIGHT_TABLE_RANGE; dx <= SIGHT_TABLE_RANGE; ++dx) {
+				for (int32_t dy = -SIGHT_TABLE_RANGE; dy <= SIGHT_TABLE_RANGE; ++dy) {
+					first[index(dx, dy)] = steps.size();
+					walkSightLine(0, 0, dx, dy, [this](int32_t x, int32_t y) {
+						steps.push_back({static_cast<int8_t>(x), static_cast<int8_t>(y)});
+						return true;
+					});
+				}
+			}
+			first[SIGHT_TABLE_WIDTH * SIGHT_TABLE_WIDTH] = steps.size();
+		}
 
-	while (start.x != destination.x || start.y != destination.y) {
-		int32_t move_hor = std::abs(A * (start.x + mx) + B * (start.y) + C);
-		int32_t move_ver = std::abs(A * (start.x) + B * (start.y + my) + C);
-		int32_t move_cross = std::abs(A * (start.x + mx) + B * (start.y + my) + C);
+		static bool contains(int32_t dx, int32_t dy) {
+			return std::abs(dx) <= SIGHT_TABLE_RANGE && std::abs(dy) <= SIGHT_TABLE_RANGE;
+		}
 
-		if (start.y != destination.y && (start.x == destination.x || move_hor > move_ver || move_hor > move_cross)) {
-			start.y += my;
+		const Step* begin(int32_t dx, int32_t dy) const {
+			return steps.data() + first[index(dx, dy)];
+		}
+		const Step* end(int32_t dx, int32_t dy) const {
+			return steps.data() + first[index(dx, dy) + 1];
 		}
 
-		if (start.x != destination.x && (start.y == destination.y || move_ver > move_hor || move_ver > move_cross)) {
-			start.x += mx;
+	private:
+		static int32_t index(int32_t dx, int32_t dy) {
+			return (dx + SIGHT_TABLE_RANGE) * SIGHT_TABLE_WIDTH + (dy + SIGHT_TABLE_RANGE);
 		}
 
-		const Tile* tile = getTile(start.x, start.y, start.z);
-		if (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		std::vector<Step> steps;
+		std::array<uint32_t, SIGHT_TABLE_WIDTH * SIGHT_TABLE_WIDTH + 1> first;
+};
+
+const SightTable sightTable;
+
+// reads the projectile bitmap of one floor, looking the leaf up again only when the line leaves it
+class ProjectileBlockingReader
+{
+	public:
+		ProjectileBlockingReader(const Map& map, uint8_t z) : map(map), z(z) {}
+
+		bool isBlocking(uint16_t x, uint16_t y) {
+			const int32_t leafX = x >> FLOOR_BITS;
+			const int32_t leafY = y >> FLOOR_BITS;
+			if (leafX != lastLeafX || leafY != lastLeafY) {
+				lastLeafX = leafX;
+				lastLeafY = leafY;
+				const QTreeLeafNode* leaf = map.getQTNode(x, y);
+				floor = leaf ? leaf->getFloor(z) : nullptr;
+			}
+			return floor && floor->blocksProjectile(x, y);
+		}
+
+	private:
+		const Map& map;
+		const Floor* floor = nullptr;
+		int32_t lastLeafX = -1;
+		int32_t lastLeafY = -1;
+		uint8_t z;
+};
+
+}
+
+bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
+{
+	if (fromPos == toPos) {
+		return true;
+	}
+
+	Position start(fromPos.z > toPos.z ? toPos : fromPos);
+	Position destination(fromPos.z > toPos.z ? fromPos : toPos);
+
+	if (start.z < MAP_MAX_LAYERS) {
+		ProjectileBlockingReader reader(*this, start.z);
+		const int32_t dx = Position::getOffsetX(destination, start);
+		const int32_t dy = Position::getOffsetY(destination, start);
+		if (SightTable::contains(dx, dy)) {
+			for (auto step = sightTable.begin(dx, dy), end = sightTable.end(dx, dy); step != end; ++step) {
+				if (reader.isBlocking(start.x + step->x, start.y + step->y)) {
+					return false;
+				}
+			}
+		} else if (!walkSightLine(start.x, start.y, destination.x, destination.y, [&reader](int32_t x, int32_t y) {
+				return !reader.isBlocking(x, y);
+			})) {
 			return false;
 		}
 	}
 
 	// now we need to perform a jump between floors to see if everything is clear (literally)
+	start.x = destination.x;
+	start.y = destination.y;
 	while (start.z != destination.z) {
 		const Tile* tile = getTile(start.x, start.y, start.z);
 		if (tile && tile->getThingCount() > 0) {
@@ -585,11 +743,47 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 }
 
 bool Map::getPathMatching(const Creature& creature, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+{
+	const Position& startPos = creature.getPosition();
+
+	bool found;
+	if (pathCache.find(creature.getID(), startPos, pathCondition.getTargetPos(), fpp, dirList, found)) {
+		return found;
+	}
+
+	found = findPath(creature, dirList, pathCondition, fpp);
+	pathCache.store(*this, creature.getID(), startPos, pathCondition.getTargetPos(), fpp, dirList, found);
+	return found;
+}
+
+bool Map::getPathMatching(const Position& start, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+{
+	bool found;
+	if (pathCache.find(0, start, pathCondition.getTargetPos(), fpp, dirList, found)) {
+		return found;
+	}
+
+	found = findPath(start, dirList, pathCondition, fpp);
+	pathCache.store(*this, 0, start, pathCondition.getTargetPos(), fpp, dirList, found);
+	return found;
+}
+
+bool Map::searchPath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp, std::forward_list<Direction>& dirList) const
+{
+	return findPath(creature, dirList, FrozenPathingConditionCall(targetPos), fpp);
+}
+
+void Map::cachePath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp, const std::forward_list<Direction>& dirList, bool found) const
+{
+	pathCache.store(*this, creature.getID(), creature.getPosition(), targetPos, fpp, dirList, found);
+}
+
+bool Map::findPath(const Creature& creature, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
 	Position pos = creature.getPosition();
 	Position endPos;
 
-	AStarNodes nodes(pos.x, pos.y);
+	AStarNodes& nodes = AStarNodes::getThreadNodes(pos.x, pos.y);
 
 	int32_t bestMatch = 0;
 
@@ -759,12 +953,12 @@ bool Map::getPathMatching(const Creature& creature, std::forward_list<Direction>
 	return true;
 }
 
-bool Map::getPathMatching(const Position& start, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+bool Map::findPath(const Position& start, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
 	Position pos = start;
 	Position endPos;
 
-	AStarNodes nodes(pos.x, pos.y);
+	AStarNodes& nodes = AStarNodes::getThreadNodes(pos.x, pos.y);
 
 	int32_t bestMatch = 0;
 
@@ -953,19 +1147,28 @@ bool Map::getPathMatching(const Position& start, std::forward_list<Direction>& d
 
 // AStarNodes
 
-AStarNodes::AStarNodes(uint32_t x, uint32_t y)
-	: nodes(), openNodes()
+AStarNodes& AStarNodes::getThreadNodes(uint32_t x, uint32_t y)
 {
-	curNode = 1;
+	static thread_local AStarNodes threadNodes;
+	threadNodes.reset(x, y);
+	return threadNodes;
+}
+
+void AStarNodes::reset(uint32_t x, uint32_t y)
+{
+	if (++generation > std::numeric_limits<uint16_t>::max()) {
+		grid.fill(0);
+		generation = 1;
+	}
+
+	startX = x;
+	startY = y;
+	outsideGrid.clear();
+	openCount = 0;
+	curNode = 0;
 	closedNodes = 0;
-	openNodes[0] = true;
-
-	AStarNode& startNode = nodes[0];
-	startNode.parent = nullptr;
-	startNode.x = x;
-	startNode.y = y;
-	startNode.f = 0;
-	nodeTable[(x << 16) | y] = nodes;
+
+	createOpenNode(nullptr, x, y, 0);
 }
 
 AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
@@ -974,44 +1177,38 @@ AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y,
 		return nullptr;
 	}
 
-	size_t retNode = curNode++;
-	openNodes[retNode] = true;
-
+	uint16_t retNode = curNode++;
 	AStarNode* node = nodes + retNode;
-	nodeTable[(x << 16) | y] = node;
 	node->parent = parent;
 	node->x = x;
 	node->y = y;
 	node->f = f;
+
+	uint32_t gridX = x - startX + GRID_RADIUS;
+	uint32_t gridY = y - startY + GRID_RADIUS;
+	if (gridX < GRID_SIZE && gridY < GRID_SIZE) {
+		grid[gridY * GRID_SIZE + gridX] = (generation << 16) | retNode;
+	} else {
+		outsideGrid.push_back(retNode);
+	}
+
+	pushOpen(retNode);
 	return node;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
-	if (curNode == 0) {
+	if (openCount == 0) {
 		return nullptr;
 	}
-
-	int32_t best_node_f = std::numeric_limits<int32_t>::max();
-	int32_t best_node = -1;
-	for (size_t i = 0; i < curNode; i++) {
-		if (openNodes[i] && nodes[i].f < best_node_f) {
-			best_node_f = nodes[i].f;
-			best_node = i;
-		}
-	}
-
-	if (best_node >= 0) {
-		return nodes + best_node;
-	}
-	return nullptr;
+	return nodes + openHeap[0];
 }
 
 void AStarNodes::closeNode(AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	openNodes[index] = false;
+	removeOpen(index);
 	++closedNodes;
 }
 
@@ -1019,9 +1216,12 @@ void AStarNodes::openNode(AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	if (!openNodes[index]) {
-		openNodes[index] = true;
+	if (heapPosition[index] < 0) {
+		pushOpen(index);
 		--closedNodes;
+	} else {
+		// still open with a lower f now
+		siftUp(heapPosition[index]);
 	}
 }
 
@@ -1032,11 +1232,83 @@ int_fast32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 {
-	auto it = nodeTable.find((x << 16) | y);
-	if (it == nodeTable.end()) {
-		return nullptr;
+	uint32_t gridX = x - startX + GRID_RADIUS;
+	uint32_t gridY = y - startY + GRID_RADIUS;
+	if (gridX < GRID_SIZE && gridY < GRID_SIZE) {
+		uint32_t entry = grid[gridY * GRID_SIZE + gridX];
+		if ((entry >> 16) != generation) {
+			return nullptr;
+		}
+		return nodes + (entry & 0xFFFF);
 	}
-	return it->second;
+
+	for (uint16_t index : outsideGrid) {
+		if (nodes[index].x == x && nodes[index].y == y) {
+			return nodes + index;
+		}
+	}
+	return nullptr;
+}
+
+void AStarNodes::pushOpen(uint16_t index)
+{
+	openHeap[openCount] = index;
+	heapPosition[index] = openCount;
+	siftUp(openCount++);
+}
+
+void AStarNodes::removeOpen(uint16_t index)
+{
+	int16_t position = heapPosition[index];
+	if (position < 0) {
+		return;
+	}
+
+	heapPosition[index] = -1;
+	if (static_cast<size_t>(position) != --openCount) {
+		openHeap[position] = openHeap[openCount];
+		heapPosition[openHeap[position]] = position;
+		siftDown(position);
+		siftUp(position);
+	}
+}
+
+void AStarNodes::siftUp(size_t position)
+{
+	uint16_t index = openHeap[position];
+	while (position != 0) {
+		size_t parent = (position - 1) / 2;
+		if (!isBetter(index, openHeap[parent])) {
+			break;
+		}
+		openHeap[position] = openHeap[parent];
+		heapPosition[openHeap[position]] = position;
+		position = parent;
+	}
+	openHeap[position] = index;
+	heapPosition[index] = position;
+}
+
+void AStarNodes::siftDown(size_t position)
+{
+	uint16_t index = openHeap[position];
+	while (true) {
+		size_t child = position * 2 + 1;
+		if (child >= openCount) {
+			break;
+		}
+		if (child + 1 < openCount && isBetter(openHeap[child + 1], openHeap[child])) {
+			++child;
+		}
+		if (!isBetter(openHeap[child], index)) {
+			break;
+		}
+		openHeap[position] = openHeap[child];
+		heapPosition[openHeap[position]] = position;
+		position = child;
+	}
+	openHeap[position] = index;
+	heapPosition[index] = position;
 }
 
 int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos, bool preferDiagonal)
@@ -1069,6 +1341,131 @@ int_fast32_t AStarNodes::getTileWalkCost(const Creature& creature, const Tile* t
 	return cost;
 }
 
+// PathCache
+namespace {
+
+uint64_t packPathParams(const FindPathParams& fpp)
+{
+	uint64_t params = static_cast<uint16_t>(fpp.maxSearchDist);
+	params = (params << 16) | static_cast<uint16_t>(fpp.minTargetDist);
+	params = (params << 16) | static_cast<uint16_t>(fpp.maxTargetDist);
+	params = (params << 1) | fpp.fullPathSearch;
+	params = (params << 1) | fpp.clearSight;
+	params = (params << 1) | fpp.allowDiagonal;
+	params = (params << 1) | fpp.keepDistance;
+	params = (params << 1) | fpp.absoluteDist;
+	params = (params << 1) | fpp.preferDiagonal;
+	return params;
+}
+
+}
+
+PathCache::Entry& PathCache::getEntry(uint32_t creatureId, const Position& startPos, const Position& targetPos, uint64_t params)
+{
+	size_t hash = std::hash<uint64_t>()(params);
+	hash = hash * 31 + creatureId;
+	hash = hash * 31 + (static_cast<uint64_t>(startPos.x) << 24 | static_cast<uint64_t>(startPos.y) << 8 | startPos.z);
+	hash = hash * 31 + (static_cast<uint64_t>(targetPos.x) << 24 | static_cast<uint64_t>(targetPos.y) << 8 | targetPos.z);
+	return entries[hash % entries.size()];
+}
+
+bool PathCache::find(uint32_t creatureId, const Position& startPos, const Position& targetPos, const FindPathParams& fpp,
+	std::forward_list<Direction>& dirList, bool& found)
+{
+	const uint64_t params = packPathParams(fpp);
+	Entry& entry = getEntry(creatureId, startPos, targetPos, params);
+	if (!entry.used || entry.creatureId != creatureId || entry.params != params || entry.startPos != startPos || entry.targetPos != targetPos) {
+		++stats.misses;
+		return false;
+	}
+
+	for (const auto& leafVersion : entry.leafVersions) {
+		if (leafVersion.first->getVersion() != leafVersion.second) {
+			entry.used = false;
+			++stats.invalidations;
+			++stats.misses;
+			return false;
+		}
+	}
+
+	++stats.hits;
+	dirList = entry.dirList;
+	found = entry.found;
+	return true;
+}
+
+void PathCache::store(const Map& map, uint32_t creatureId, const Position& startPos, const Position& targetPos, const FindPathParams& fpp,
+	const std::forward_list<Direction>& dirList, bool found)
+{
+	// the leaves the result depends on: around the path, or the whole search area when nothing was found
+	int32_t minX = std::min(startPos.x, targetPos.x), maxX = std::max(startPos.x, targetPos.x);
+	int32_t minY = std::min(startPos.y, targetPos.y), maxY = std::max(startPos.y, targetPos.y);
+	if (found) {
+		Position pos = startPos;
+		for (Direction dir : dirList) {
+			pos = getNextPosition(dir, pos);
+			minX = std::min<int32_t>(minX, pos.x);
+			maxX = std::max<int32_t>(maxX, pos.x);
+			minY = std::min<int32_t>(minY, pos.y);
+			maxY = std::max<int32_t>(maxY, pos.y);
+		}
+		minX -= 1;
+		maxX += 1;
+		minY -= 1;
+		maxY += 1;
+	} else {
+		if (fpp.maxSearchDist <= 0 || fpp.maxSearchDist > PATH_CACHE_MAX_FAILED_SEARCH_DIST) {
+			return;
+		}
+		minX = startPos.x - fpp.maxSearchDist;
+		maxX = startPos.x + fpp.maxSearchDist;
+		minY = startPos.y - fpp.maxSearchDist;
+		maxY = startPos.y + fpp.maxSearchDist;
+	}
+
+	const uint64_t params = packPathParams(fpp);
+	Entry& entry = getEntry(creatureId, startPos, targetPos, params);
+	entry.creatureId = creatureId;
+	entry.params = params;
+	entry.startPos = startPos;
+	entry.targetPos = targetPos;
+	entry.used = true;
+	entry.found = found;
+	entry.dirList = dirList;
+	entry.leafVersions.clear();
+
+	minX = std::max<int32_t>(minX, 0) & ~FLOOR_MASK;
+	minY = std::max<int32_t>(minY, 0) & ~FLOOR_MASK;
+	maxX = std::min<int32_t>(maxX, std::numeric_limits<uint16_t>::max());
+	maxY = std::min<int32_t>(maxY, std::numeric_limits<uint16_t>::max());
+	for (int32_t y = minY; y <= maxY; y += FLOOR_SIZE) {
+		for (int32_t x = minX; x <= maxX; x += FLOOR_SIZE) {
+			const QTreeLeafNode* leaf = map.getQTNode(x, y);
+			if (leaf) {
+				entry.leafVersions.emplace_back(leaf, leaf->getVersion());
+			}
+		}
+	}
+}
+
+void PathCache::startReports(uint32_t interval)
+{
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&PathCache::logReport, this, interval, getStats())));
+}
+
+void PathCache::logReport(uint32_t interval, PathCacheStats last)
+{
+	PathCacheStats current = getStats();
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&PathCache::logReport, this, interval, current)));
+
+	uint64_t hits = current.hits - last.hits;
+	uint64_t searches = hits + current.misses - last.misses;
+	if (searches != 0) {
+		SPDLOG_INFO("[Path cache] {:.1f} searches/s, {:.1f}% served from cache, {} entries invalidated by tile changes",
+			searches * 1000.0 / interval, hits * 100.0 / searches, current.invalidations - last.invalidations);
+	}
+}
+
 // Floor
 Floor::~Floor()
 {
@@ -1122,9 +1519,11 @@ bool QTreeLeafNode::newLeaf = false;
 
 QTreeLeafNode::~QTreeLeafNode()
 {
+#ifndef MAP_SECTOR_STORAGE
 	for (auto* ptr : array) {
 		delete ptr;
 	}
+#endif
 }
 
 Floor* QTreeLeafNode::createFloor(uint32_t z)
@@ -1159,6 +1558,32 @@ void QTreeLeafNode::removeCreature(Creature* c)
 	}
 }
 
+#ifdef MAP_SECTOR_STORAGE
+// SectorDirectory
+QTreeLeafNode* SectorDirectory::createSector(uint16_t x, uint16_t y)
+{
+	Block*& block = directory[(y >> BLOCK_TILE_BITS) * DIRECTORY_SIZE + (x >> BLOCK_TILE_BITS)];
+	if (!block) {
+		block = &blocks.emplace_back();
+	}
+
+	QTreeLeafNode*& sector = block->sectors[(y >> FLOOR_BITS) & BLOCK_MASK][(x >> FLOOR_BITS) & BLOCK_MASK];
+	if (!sector) {
+		sector = &sectors.emplace_back();
+	}
+	return sector;
+}
+
+Floor* SectorDirectory::createFloor(QTreeLeafNode* sector, uint8_t z)
+{
+	// the floors live in the arena, the sector only points at them
+	if (!sector->array[z]) {
+		sector->array[z] = &floors.emplace_back();
+	}
+	return sector->array[z];
+}
+#endif
+
 uint32_t Map::clean() const
 {
 	uint64_t start = OTSYS_TIME();
@@ -20,9 +20,13 @@
 #ifndef FS_MAP_H_E3953D57C058461F856F5221D359DAFA
 #define FS_MAP_H_E3953D57C058461F856F5221D359DAFA
 
+#include <array>
+#include <deque>
+
 #include "position.h"
 #include "item.h"
 #include "fileloader.h"
+#include "flowfield.h"
 
 #include "tools.h"
 #include "tile.h"
@@ -54,7 +58,8 @@ static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
 class AStarNodes
 {
 	public:
-		AStarNodes(uint32_t x, uint32_t y);
+		// the nodes are reused by every search on the calling thread, reset to a single open start node
+		static AStarNodes& getThreadNodes(uint32_t x, uint32_t y);
 
 		AStarNode* createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f);
 		AStarNode* getBestNode();
@@ -67,16 +72,98 @@ class AStarNodes
 		static int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
+		AStarNodes() = default;
+
+		void reset(uint32_t x, uint32_t y);
+
+		// the open nodes are a binary heap ordered by f and then by creation, so equal
+		// paths are picked in the same order as by a scan over the nodes
+		bool isBetter(uint16_t lhs, uint16_t rhs) const {
+			return nodes[lhs].f < nodes[rhs].f || (nodes[lhs].f == nodes[rhs].f && lhs < rhs);
+		}
+		void pushOpen(uint16_t index);
+		void removeOpen(uint16_t index);
+		void siftUp(size_t position);
+		void siftDown(size_t position);
+
+		// node lookup around the start position, the few nodes outside of it are scanned
+		static constexpr int32_t GRID_RADIUS = 64;
+		static constexpr int32_t GRID_SIZE = GRID_RADIUS * 2;
+
 		AStarNode nodes[MAX_NODES];
-		bool openNodes[MAX_NODES];
-		std::unordered_map<uint32_t, AStarNode*> nodeTable;
-		size_t curNode;
-		int_fast32_t closedNodes;
+		uint16_t openHeap[MAX_NODES];
+		int16_t heapPosition[MAX_NODES];
+		size_t openCount = 0;
+
+		// an entry belongs to the current search if its high half matches the generation
+		std::array<uint32_t, GRID_SIZE * GRID_SIZE> grid {};
+		std::vector<uint16_t> outsideGrid;
+		uint32_t generation = 0;
+		uint32_t startX = 0;
+		uint32_t startY = 0;
+
+		size_t curNode = 0;
+		int_fast32_t closedNodes = 0;
 };
 
-using SpectatorCache = std::map<Position, SpectatorHashSet>;
+// room for the paths a think bucket of a crowded world searches ahead, see ThinkPlanner
+static constexpr size_t PATH_CACHE_SIZE = 4096;
+// failed searches are only kept when they could not look further than this
+static constexpr int32_t PATH_CACHE_MAX_FAILED_SEARCH_DIST = 16;
+
+struct PathCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t invalidations = 0;
+};
+
+class QTreeLeafNode;
+
+/**
+  * Results of recent path searches, keyed by creature, start, target and search parameters.
+  * An entry is reused while every leaf around its path keeps the version it had when the path was stored.
+  */
+class PathCache
+{
+	public:
+		PathCache() : entries(PATH_CACHE_SIZE) {}
+
+		bool find(uint32_t creatureId, const Position& startPos, const Position& targetPos, const FindPathParams& fpp,
+			std::forward_list<Direction>& dirList, bool& found);
+		void store(const Map& map, uint32_t creatureId, const Position& startPos, const Position& targetPos, const FindPathParams& fpp,
+			const std::forward_list<Direction>& dirList, bool found);
+
+		PathCacheStats getStats() const {
+			return stats;
+		}
+
+		void startReports(uint32_t interval);
+		void logReport(uint32_t interval, PathCacheStats last);
 
+	private:
+		struct Entry {
+			uint32_t creatureId = 0;
+			uint64_t params = 0;
+			Position startPos;
+			Position targetPos;
+			bool used = false;
+			bool found = false;
+			std::forward_list<Direction> dirList;
+			std::vector<std::pair<const QTreeLeafNode*, uint32_t>> leafVersions;
+		};
+
+		Entry& getEntry(uint32_t creatureId, const Position& startPos, const Position& targetPos, uint64_t params);
+
+		std::vector<Entry> entries;
+		PathCacheStats stats;
+};
+
+#ifdef MAP_SECTOR_STORAGE
+// sectors of 32x32 tiles per floor
+static constexpr int32_t FLOOR_BITS = 5;
+#else
 static constexpr int32_t FLOOR_BITS = 3;
+#endif
 static constexpr int32_t FLOOR_SIZE = (1 << FLOOR_BITS);
 static constexpr int32_t FLOOR_MASK = (FLOOR_SIZE - 1);
 
@@ -88,11 +175,25 @@ struct Floor {
 	Floor(const Floor&) = delete;
 	Floor& operator=(const Floor&) = delete;
 
+	bool blocksProjectile(uint16_t x, uint16_t y) const {
+		const uint32_t bit = ((x & FLOOR_MASK) << FLOOR_BITS) | (y & FLOOR_MASK);
+		return (projectileBlocking[bit >> 6] >> (bit & 63)) & 1;
+	}
+	void setProjectileBlocking(uint16_t x, uint16_t y, bool blocking) {
+		const uint32_t bit = ((x & FLOOR_MASK) << FLOOR_BITS) | (y & FLOOR_MASK);
+		if (blocking) {
+			projectileBlocking[bit >> 6] |= (uint64_t(1) << (bit & 63));
+		} else {
+			projectileBlocking[bit >> 6] &= ~(uint64_t(1) << (bit & 63));
+		}
+	}
+
 	Tile* tiles[FLOOR_SIZE][FLOOR_SIZE] = {};
+	// one bit per tile, set while anything on it blocks projectiles, so sight lines never touch the tiles
+	uint64_t projectileBlocking[(FLOOR_SIZE * FLOOR_SIZE + 63) / 64] = {};
 };
 
 class FrozenPathingConditionCall;
-class QTreeLeafNode;
 
 class QTreeNode
 {
@@ -153,8 +254,14 @@ class QTreeLeafNode final : public QTreeNode
 		void addCreature(Creature* c);
 		void removeCreature(Creature* c);
 
+		// bumped whenever walkability inside the leaf may have changed
+		uint32_t getVersion() const {
+			return version;
+		}
+
 	private:
 		static bool newLeaf;
+		uint32_t version = 0;
 		QTreeLeafNode* leafS = nullptr;
 		QTreeLeafNode* leafE = nullptr;
 		Floor* array[MAP_MAX_LAYERS] = {};
@@ -163,8 +270,57 @@ class QTreeLeafNode final : public QTreeNode
 
 		friend class Map;
 		friend class QTreeNode;
+		friend class SectorDirectory;
 };
 
+#ifdef MAP_SECTOR_STORAGE
+/**
+  * Flat two level directory of map sectors, used instead of the quadtree when built with MAP_SECTOR_STORAGE.
+  * A lookup is two array reads. Sectors and their floors are taken from arenas while the map loads.
+  */
+class SectorDirectory
+{
+	public:
+		// 32x32 sectors per block, so a block covers 1024x1024 tiles and 64x64 blocks the whole map
+		static constexpr int32_t BLOCK_BITS = 5;
+		static constexpr int32_t BLOCK_SIZE = 1 << BLOCK_BITS;
+		static constexpr int32_t BLOCK_MASK = BLOCK_SIZE - 1;
+		static constexpr int32_t BLOCK_TILE_BITS = BLOCK_BITS + FLOOR_BITS;
+		static constexpr int32_t DIRECTORY_SIZE = 1 << (16 - BLOCK_TILE_BITS);
+
+		SectorDirectory() = default;
+
+		// non-copyable
+		SectorDirectory(const SectorDirectory&) = delete;
+		SectorDirectory& operator=(const SectorDirectory&) = delete;
+
+		QTreeLeafNode* getSector(uint16_t x, uint16_t y) const {
+			const Block* block = directory[(y >> BLOCK_TILE_BITS) * DIRECTORY_SIZE + (x >> BLOCK_TILE_BITS)];
+			if (!block) {
+				return nullptr;
+			}
+			return block->sectors[(y >> FLOOR_BITS) & BLOCK_MASK][(x >> FLOOR_BITS) & BLOCK_MASK];
+		}
+
+		QTreeLeafNode* createSector(uint16_t x, uint16_t y);
+		Floor* createFloor(QTreeLeafNode* sector, uint8_t z);
+
+		const std::deque<QTreeLeafNode>& getSectors() const {
+			return sectors;
+		}
+
+	private:
+		struct Block {
+			QTreeLeafNode* sectors[BLOCK_SIZE][BLOCK_SIZE] = {};
+		};
+
+		std::array<Block*, DIRECTORY_SIZE * DIRECTORY_SIZE> directory = {};
+		std::deque<Block> blocks;
+		std::deque<QTreeLeafNode> sectors;
+		std::deque<Floor> floors;
+};
+#endif
+
 /**
   * Map class.
   * Holds all the actual map-data
@@ -209,6 +365,11 @@ class Map
 			setTile(pos.x, pos.y, pos.z, newTile);
 		}
 
+		/**
+		  * Calls back with every tile of the map, in no particular order.
+		  */
+		void forEachTile(const std::function<void(Tile*)>& callback) const;
+
 		/**
 		  * Place a creature on the map
 		  * \param centerPos The position to place the creature
@@ -220,11 +381,20 @@ class Map
 
 		void moveCreature(Creature& creature, Tile& newTile, bool forceTeleport = false);
 
-		void getSpectators(SpectatorHashSet& spectators, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
+		void getSpectators(SpectatorVec& spectators, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
 						   int32_t minRangeX = 0, int32_t maxRangeX = 0,
 						   int32_t minRangeY = 0, int32_t maxRangeY = 0);
 
-		void clearSpectatorCache();
+		// a creature entered or left the tile at pos
+		void onTileCreatureChange(const Position& pos);
+		// an item was added to, removed from or replaced on the tile at pos
+		void onTileItemChange(const Position& pos, const Item& item);
+		// the tile at pos gained its first or lost its last projectile blocking item
+		void setProjectileBlocking(const Position& pos, bool blocking);
+
+		PathCacheStats getPathCacheStats() const {
+			return pathCache.getStats();
+		}
 
 		/**
 		  * Checks if you can throw an object to that position
@@ -257,20 +427,42 @@ class Map
 		bool getPathMatching(const Position& startPos, std::forward_list<Direction>& dirList,
 			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
 
+		// follow path search that skips the path cache, several threads may search at once while the map does not change
+		bool searchPath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp, std::forward_list<Direction>& dirList) const;
+		// keeps a searchPath result for the next getPathMatching of the same creature
+		void cachePath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp,
+			const std::forward_list<Direction>& dirList, bool found) const;
+
 		std::map<std::string, Position> waypoints;
 
+#ifdef MAP_SECTOR_STORAGE
+		QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) {
+			return sectors.getSector(x, y);
+		}
+		const QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) const {
+			return sectors.getSector(x, y);
+		}
+#else
 		QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) {
 			return QTreeNode::getLeafStatic<QTreeLeafNode*, QTreeNode*>(&root, x, y);
 		}
+		const QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) const {
+			return QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+		}
+#endif
 
 		Spawns spawns;
 		Towns towns;
 		Houses houses;
+		FlowFields flowFields;
 	private:
-		SpectatorCache spectatorCache;
-		SpectatorCache playersSpectatorCache;
+		mutable PathCache pathCache;
 
+#ifdef MAP_SECTOR_STORAGE
+		SectorDirectory sectors;
+#else
 		QTreeNode root;
+#endif
 
 		std::string spawnfile;
 		std::string housefile;
@@ -278,14 +470,20 @@ class Map
 		uint32_t width = 0;
 		uint32_t height = 0;
 
+		bool findPath(const Creature& creature, std::forward_list<Direction>& dirList,
+			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+		bool findPath(const Position& startPos, std::forward_list<Direction>& dirList,
+			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+
 		// Actually scans the map for spectators
-		void getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos,
+		void getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos,
 								   int32_t minRangeX, int32_t maxRangeX,
 								   int32_t minRangeY, int32_t maxRangeY,
 								   int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
 
 		friend class Game;
 		friend class IOMap;
+		friend class IOMapSnapshot;
 };
 
 #endif
@@ -26,8 +26,12 @@
 #include "databasetasks.h"
 #include "events.h"
 #include "game.h"
+#include "iomap.h"
+#include "iomapsnapshot.h"
 #include "iomarket.h"
+#include "loginqueue.h"
 #include "modules.h"
+#include "playersaves.h"
 #include "protocollogin.h"
 #include "protocolstatus.h"
 #include "rsa.h"
@@ -42,6 +46,8 @@
 #endif
 
 DatabaseTasks g_databaseTasks;
+PlayerSaves g_playerSaves;
+LoginQueue g_loginQueue;
 Dispatcher g_dispatcher;
 Scheduler g_scheduler;
 
@@ -102,6 +108,8 @@ void loadModules() {
 	SPDLOG_INFO("Server protocol: {}",
 		g_config.getString(ConfigManager::CLIENT_VERSION_STR));
 
+	g_scheduler.setTimingWheel(g_config.getBoolean(ConfigManager::SCHEDULER_TIMING_WHEEL));
+
 	// set RSA key
 	try {
 		g_RSA.loadPEM("key.pem");
@@ -127,6 +135,11 @@ void loadModules() {
 	}
 
 	g_databaseTasks.start();
+	if (g_config.getBoolean(ConfigManager::ASYNC_PLAYER_SAVE)) {
+		g_playerSaves.start();
+	}
+	g_loginQueue.start(std::max<int32_t>(g_config.getNumber(ConfigManager::LOGIN_THREADS), 0),
+		std::max<int32_t>(g_config.getNumber(ConfigManager::LOGIN_QUEUE_SIZE), 0));
 	DatabaseManager::updateDatabase();
 
 	if (g_config.getBoolean(ConfigManager::OPTIMIZE_DATABASE)
@@ -175,6 +188,33 @@ void loadModules() {
 	g_game.loadBoostedCreature();
 }
 
+// loads only what the map needs and writes its snapshot next to the .otbm
+bool buildMapSnapshot() {
+	if (!g_config.load()) {
+		SPDLOG_ERROR("Cannot load: config.lua");
+		return false;
+	}
+
+	if (Item::items.loadFromOtb("data/items/items.otb") != ERROR_NONE || !Item::items.loadFromXml()) {
+		SPDLOG_ERROR("Cannot load: items.otb or items.xml");
+		return false;
+	}
+
+	const std::string mapFileName = "data/world/" + g_config.getString(ConfigManager::MAP_NAME) + ".otbm";
+	IOMap loader;
+	if (!loader.loadMap(&g_game.map, mapFileName)) {
+		SPDLOG_ERROR("[buildMapSnapshot] - {}", loader.getLastErrorString());
+		return false;
+	}
+
+	IOMapSnapshot snapshot;
+	if (!snapshot.saveMap(g_game.map, mapFileName)) {
+		SPDLOG_ERROR("[buildMapSnapshot] - {}", snapshot.getLastErrorString());
+		return false;
+	}
+	return true;
+}
+
 #ifndef UNIT_TESTING
 int main(int argc, char* argv[]) {
 #ifdef DEBUG_LOG
@@ -187,6 +227,10 @@ int main(int argc, char* argv[]) {
 	// Setup bad allocation handler
 	std::set_new_handler(badAllocationHandler);
 
+	if (argc > 1 && strcmp(argv[1], "--build-map-snapshot") == 0) {
+		return buildMapSnapshot() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	ServiceManager serviceManager;
 
 	g_dispatcher.start();
@@ -200,10 +244,12 @@ int main(int argc, char* argv[]) {
 	if (serviceManager.is_running()) {
 		SPDLOG_INFO("{} {}", g_config.getString(ConfigManager::SERVER_NAME),
                     "server online!");
-		serviceManager.run();
+		serviceManager.run(g_config.getNumber(ConfigManager::NETWORK_THREADS));
 	} else {
 		SPDLOG_ERROR("No services running. The server is NOT online!");
+		g_loginQueue.shutdown();
 		g_databaseTasks.shutdown();
+		g_playerSaves.shutdown();
 		g_dispatcher.shutdown();
 	}
 
@@ -32,7 +32,7 @@ const std::chrono::milliseconds OUTPUTMESSAGE_AUTOSEND_DELAY {10};
 void OutputMessagePool::scheduleSendAll()
 {
 	auto functor = std::bind(&OutputMessagePool::sendAll, this);
-	g_scheduler.addEvent(createSchedulerTask(OUTPUTMESSAGE_AUTOSEND_DELAY.count(), functor));
+	g_scheduler.addEvent(createSchedulerTask(OUTPUTMESSAGE_AUTOSEND_DELAY.count(), functor, TASK_CATEGORY_OUTPUT));
 }
 
 void OutputMessagePool::sendAll()
@@ -45,7 +45,7 @@ void OutputMessagePool::sendAll()
 		}
 	}
 
-	if (!bufferedProtocols.empty()) {
+	if (autoSend && !bufferedProtocols.empty()) {
 		scheduleSendAll();
 	}
 }
@@ -53,7 +53,7 @@ void OutputMessagePool::sendAll()
 void OutputMessagePool::addProtocolToAutosend(Protocol_ptr protocol)
 {
 	//dispatcher thread
-	if (bufferedProtocols.empty()) {
+	if (autoSend && bufferedProtocols.empty()) {
 		scheduleSendAll();
 	}
 	bufferedProtocols.emplace_back(protocol);
@@ -43,16 +43,24 @@ class OutputMessage : public NetworkMessage
 			add_header(info.length);
 		}
 
-		void addCryptoHeader(uint8_t addChecksum, uint32_t& sequence) {
+		void addCryptoHeader(uint8_t addChecksum, uint32_t& sequence, bool compressed = false) {
 			if (addChecksum == 1) {
 				add_header(adlerChecksum(buffer + outputBufferStart, info.length));
 			} else if (addChecksum == 2) {
-				add_header(sequence++);
+				add_header(compressed ? (sequence++ | 1u << 31) : sequence++);
 			}
 
 			writeMessageLength();
 		}
 
+		// swaps the body for its compressed form, before any header was added
+		void replaceBody(const uint8_t* body, size_t length) {
+			assert(outputBufferStart == INITIAL_BUFFER_POSITION);
+			memcpy(buffer + outputBufferStart, body, length);
+			info.length = length;
+			info.position = outputBufferStart + length;
+		}
+
 		void append(const NetworkMessage& msg) {
 			auto msgLen = msg.getLength();
 			memcpy(buffer + info.position, msg.getBuffer() + 8, msgLen);
@@ -95,6 +103,11 @@ class OutputMessagePool
 		void sendAll();
 		void scheduleSendAll();
 
+		// when disabled the buffered protocols are only flushed by explicit sendAll calls
+		void setAutoSend(bool enabled) {
+			autoSend = enabled;
+		}
+
 		static OutputMessage_ptr getOutputMessage();
 
 		void addProtocolToAutosend(Protocol_ptr protocol);
@@ -104,6 +117,7 @@ class OutputMessagePool
 		//NOTE: A vector is used here because this container is mostly read
 		//and relatively rarely modified (only when a client connects/disconnects)
 		std::vector<Protocol_ptr> bufferedProtocols;
+		bool autoSend = true;
 };
 
 
@@ -703,13 +703,16 @@ void Player::addStorageValue(const uint32_t key, const int32_t value, const bool
 		getStorageValue(key, oldValue);
 
 		storageMap[key] = value;
+		if (oldValue != value) {
+			dirtyStorageKeys[key] = ++storageVersion;
+		}
 
 		if (!isLogin) {
 			auto currentFrameTime = g_dispatcher.getDispatcherCycle();
 			g_events->eventOnStorageUpdate(this, key, value, oldValue, currentFrameTime);
 		}
-	} else {
-		storageMap.erase(key);
+	} else if (storageMap.erase(key) != 0) {
+		dirtyStorageKeys[key] = ++storageVersion;
 	}
 }
 
@@ -1459,9 +1462,10 @@ void Player::onRemoveCreature(Creature* creature, bool isLogout)
 
 		IOLoginData::updateOnlineStatus(guid, false);
 
+		// the save thread retries failed writes itself
 		bool saved = false;
 		for (uint32_t tries = 0; tries < 3; ++tries) {
-			if (IOLoginData::savePlayer(this)) {
+			if (IOLoginData::savePlayerAsync(this)) {
 				saved = true;
 				break;
 			}
@@ -1948,7 +1952,7 @@ void Player::addExperience(Creature* source, uint64_t exp, bool sendText/* = fal
 		message.primary.color = TEXTCOLOR_WHITE_EXP;
 		sendTextMessage(message);
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, position, false, true);
 		spectators.erase(this);
 		if (!spectators.empty()) {
@@ -2041,7 +2045,7 @@ void Player::removeExperience(uint64_t exp, bool sendText/* = false*/)
 		message.primary.color = TEXTCOLOR_RED;
 		sendTextMessage(message);
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, position, false, true);
 		spectators.erase(this);
 		if (!spectators.empty()) {
@@ -3663,7 +3667,7 @@ bool Player::setAttackedCreature(Creature* creature)
 	}
 
 	if (creature) {
-		g_dispatcher.addTask(createTask(std::bind(&Game::checkCreatureAttack, &g_game, getID())));
+		g_dispatcher.addTask(createTask(std::bind(&Game::checkCreatureAttack, &g_game, getID()), TASK_CATEGORY_CREATURE_ATTACK));
 	}
 	return true;
 }
@@ -3719,7 +3723,7 @@ void Player::doAttacking(uint32_t)
 			result = Weapon::useFist(this, attackedCreature);
 		}
 
-		SchedulerTask* task = createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, delay), std::bind(&Game::checkCreatureAttack, &g_game, getID()));
+		SchedulerTask* task = createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, delay), std::bind(&Game::checkCreatureAttack, &g_game, getID()), TASK_CATEGORY_CREATURE_ATTACK);
 		if (!classicSpeed) {
 			setNextActionTask(task, false);
 		} else {
@@ -4213,12 +4217,33 @@ void Player::genReservedStorageRange()
 	// generate outfits range
 	uint32_t outfits_key = PSTRG_OUTFITS_RANGE_START;
 	for (const OutfitEntry& entry : outfits) {
-		storageMap[++outfits_key] = (entry.lookType << 16) | entry.addons;
+		setReservedStorageValue(++outfits_key, (entry.lookType << 16) | entry.addons);
 	}
+	eraseStorageRange(outfits_key + 1, PSTRG_OUTFITS_RANGE_START + PSTRG_OUTFITS_RANGE_SIZE);
 	// generate familiars range
 	uint32_t familiar_key = PSTRG_FAMILIARS_RANGE_START;
 	for (const FamiliarEntry& entry : familiars) {
-		storageMap[++familiar_key] = (entry.lookType << 16);
+		setReservedStorageValue(++familiar_key, (entry.lookType << 16));
+	}
+	eraseStorageRange(familiar_key + 1, PSTRG_FAMILIARS_RANGE_START + PSTRG_FAMILIARS_RANGE_SIZE);
+}
+
+void Player::setReservedStorageValue(uint32_t key, int32_t value)
+{
+	auto it = storageMap.find(key);
+	if (it == storageMap.end() || it->second != value) {
+		storageMap[key] = value;
+		dirtyStorageKeys[key] = ++storageVersion;
+	}
+}
+
+void Player::eraseStorageRange(uint32_t firstKey, uint32_t lastKey)
+{
+	// keys of outfits and familiars removed since the range was last generated
+	auto it = storageMap.lower_bound(firstKey);
+	while (it != storageMap.end() && it->first <= lastKey) {
+		dirtyStorageKeys[it->first] = ++storageVersion;
+		it = storageMap.erase(it);
 	}
 }
 
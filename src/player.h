@@ -87,6 +87,20 @@ enum PlayerAsyncOngoingTaskFlags : uint64_t {
 	PlayerAsyncTask_RecentPvPKills = 1 << 2
 };
 
+// tables a player save rewrites only when their rows changed since the last save
+enum PlayerSaveSection_t : uint8_t {
+	PLAYER_SAVE_SECTION_STASH,
+	PLAYER_SAVE_SECTION_SPELLS,
+	PLAYER_SAVE_SECTION_KILLS,
+	PLAYER_SAVE_SECTION_ITEMS,
+	PLAYER_SAVE_SECTION_DEPOT,
+	PLAYER_SAVE_SECTION_REWARDS,
+	PLAYER_SAVE_SECTION_INBOX,
+	PLAYER_SAVE_SECTION_PREY,
+
+	PLAYER_SAVE_SECTION_LAST
+};
+
 struct VIPEntry {
 	VIPEntry(uint32_t initGuid, std::string initName, std::string initDescription, uint32_t initIcon, bool initNotify) :
 		guid(initGuid), name(std::move(initName)), description(std::move(initDescription)), icon(initIcon), notify(initNotify) {}
@@ -512,7 +526,6 @@ class Player final : public Creature, public Cylinder
 		void addStorageValue(const uint32_t key, const int32_t value, const bool isLogin = false);
 		bool getStorageValue(const uint32_t key, int32_t& value) const;
 		void genReservedStorageRange();
-
 		void setGroup(Group* newGroup) {
 			group = newGroup;
 		}
@@ -1916,6 +1929,9 @@ class Player final : public Creature, public Cylinder
  private:
 		std::forward_list<Condition*> getMuteConditions() const;
 
+		void setReservedStorageValue(uint32_t key, int32_t value);
+		void eraseStorageRange(uint32_t firstKey, uint32_t lastKey);
+
 		void checkTradeState(const Item* item);
 		bool hasCapacity(const Item* item, uint32_t count) const;
 
@@ -1977,6 +1993,16 @@ class Player final : public Creature, public Cylinder
 		std::map<uint32_t, DepotChest*> depotChests;
 		std::map<uint8_t, int64_t> moduleDelayMap;
 		std::map<uint32_t, int32_t> storageMap;
+		// keys written or erased since the last save that reached the database, with the storageVersion of the change
+		std::map<uint32_t, uint64_t> dirtyStorageKeys;
+		uint64_t storageVersion = 0;
+		// fingerprints of the rows each section had at the last written save, 0 before the first one
+		std::array<uint64_t, PLAYER_SAVE_SECTION_LAST> savedSections = {};
+		bool storageSaved = false;
+		// captured saves the database has not answered yet, see IOLoginData::finishPlayerSave
+		uint32_t savesInFlight = 0;
+		uint64_t saveSequence = 0;
+		uint64_t savedSequence = 0;
 
 		std::map<uint32_t, Reward*> rewardMap;
 
@@ -0,0 +1,152 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "playersaves.h"
+#include "game.h"
+
+void PlayerSaves::addSave(PlayerSave&& save)
+{
+	std::unique_lock<std::mutex> saveLockUnique(saveLock);
+	if (getState() != THREAD_STATE_RUNNING) {
+		saveLockUnique.unlock();
+		std::vector<PlayerSave> batch;
+		batch.push_back(std::move(save));
+		writeSaves(batch);
+		finishSaves(batch);
+		return;
+	}
+
+	++pending[save.guid];
+	saves.push_back(std::move(save));
+	saveLockUnique.unlock();
+	saveSignal.notify_one();
+}
+
+bool PlayerSaves::waitFor(uint32_t guid)
+{
+	std::unique_lock<std::mutex> saveLockUnique(saveLock);
+	if (pending.find(guid) == pending.end()) {
+		return false;
+	}
+
+	doneSignal.wait(saveLockUnique, [this, guid]() { return pending.find(guid) == pending.end(); });
+	return true;
+}
+
+void PlayerSaves::threadMain()
+{
+	std::unique_lock<std::mutex> saveLockUnique(saveLock);
+	while (getState() != THREAD_STATE_TERMINATED) {
+		if (saves.empty()) {
+			saveSignal.wait(saveLockUnique);
+			continue;
+		}
+
+		std::vector<PlayerSave> batch;
+		while (!saves.empty() && batch.size() < PLAYER_SAVE_BATCH_SIZE) {
+			batch.push_back(std::move(saves.front()));
+			saves.pop_front();
+		}
+
+		saveLockUnique.unlock();
+		writeSaves(batch);
+		saveLockUnique.lock();
+		finishSaves(batch);
+	}
+	saveLockUnique.unlock();
+
+	Database::getInstance().releaseConnection();
+}
+
+void PlayerSaves::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(saveLock);
+		setState(THREAD_STATE_TERMINATED);
+	}
+	saveSignal.notify_one();
+
+	// the batch being written goes first, so no player gets an older save on top of a newer one
+	join();
+
+	std::vector<PlayerSave> batch;
+	{
+		std::lock_guard<std::mutex> lockClass(saveLock);
+		batch.assign(std::make_move_iterator(saves.begin()), std::make_move_iterator(saves.end()));
+		saves.clear();
+	}
+
+	writeSaves(batch);
+
+	std::lock_guard<std::mutex> lockClass(saveLock);
+	finishSaves(batch);
+}
+
+void PlayerSaves::writeSaves(std::vector<PlayerSave>& batch)
+{
+	if (batch.size() > 1) {
+		DBTransaction transaction;
+		if (transaction.begin()) {
+			bool written = true;
+			for (PlayerSave& save : batch) {
+				if (!IOLoginData::writePlayerSave(save)) {
+					written = false;
+					break;
+				}
+			}
+
+			if (written && transaction.commit()) {
+				return;
+			}
+		}
+	}
+
+	// one transaction per player, so a failing save does not take the others with it
+	for (PlayerSave& save : batch) {
+		bool saved = false;
+		for (uint32_t tries = 0; tries < PLAYER_SAVE_TRIES && !saved; ++tries) {
+			saved = IOLoginData::executePlayerSave(save);
+		}
+
+		if (!saved) {
+			SPDLOG_WARN("Error while saving player: {}", save.name);
+		}
+	}
+}
+
+void PlayerSaves::finishSaves(const std::vector<PlayerSave>& batch)
+{
+	for (const PlayerSave& save : batch) {
+		auto it = pending.find(save.guid);
+		if (it != pending.end() && --it->second == 0) {
+			pending.erase(it);
+		}
+
+		// the player it was captured from may have logged out meanwhile
+		g_dispatcher.addTask(createTask([playerId = save.playerId, state = save.state, written = save.written]() {
+			if (Player* player = g_game.getPlayerByID(playerId)) {
+				IOLoginData::finishPlayerSave(player, state, written);
+			}
+		}));
+	}
+	doneSignal.notify_all();
+}
@@ -0,0 +1,67 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_PLAYERSAVES_H_25B5F1A9E7B947DE9D7C54D8B22AD12B
+#define FS_PLAYERSAVES_H_25B5F1A9E7B947DE9D7C54D8B22AD12B
+
+#include <condition_variable>
+#include <deque>
+#include "thread_holder_base.h"
+#include "iologindata.h"
+
+// saves written in one transaction when the queue is that long
+static constexpr size_t PLAYER_SAVE_BATCH_SIZE = 32;
+static constexpr uint32_t PLAYER_SAVE_TRIES = 3;
+
+/**
+  * Writes captured player saves on its own thread, oldest first.
+  * Anything that reads or writes a player's rows calls waitFor before, so it never sees a save half way.
+  */
+class PlayerSaves : public ThreadHolder<PlayerSaves>
+{
+	public:
+		void addSave(PlayerSave&& save);
+
+		// blocks while a save of guid is queued or being written, true when it had to wait
+		bool waitFor(uint32_t guid);
+
+		bool isRunning() const {
+			return getState() == THREAD_STATE_RUNNING;
+		}
+
+		// stops the thread and writes what is left on the calling thread
+		void shutdown();
+
+		void threadMain();
+
+	private:
+		void writeSaves(std::vector<PlayerSave>& batch);
+		void finishSaves(const std::vector<PlayerSave>& batch);
+
+		std::deque<PlayerSave> saves;
+		std::unordered_map<uint32_t, uint32_t> pending;
+		std::mutex saveLock;
+		std::condition_variable saveSignal;
+		std::condition_variable doneSignal;
+};
+
+extern PlayerSaves g_playerSaves;
+
+#endif
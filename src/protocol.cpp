@@ -24,11 +24,36 @@
 #include "rsa.h"
 #include "xtea.h"
 
+#include <zlib.h>
+
 extern RSA2 g_RSA;
 
-void Protocol::onSendMessage(const OutputMessage_ptr& msg)
+namespace {
+
+// smaller messages (walks, effects, pings) rarely get any shorter
+constexpr size_t COMPRESSION_MIN_LENGTH = 128;
+// leaves room for the stored block headers if deflate cannot shrink the body
+constexpr size_t COMPRESSION_MAX_LENGTH = NetworkMessage::MAX_BODY_LENGTH - 64;
+
+}
+
+Protocol::Protocol(Connection_ptr initConnection) : connection(initConnection) {}
+
+Protocol::~Protocol()
 {
+	if (deflateStream) {
+		deflateEnd(deflateStream.get());
+	}
+}
+
+bool Protocol::onSendMessage(const OutputMessage_ptr& msg)
+{
+	//network thread, on the connection's strand in the order the messages were sent
 	if (!rawMessages) {
+		bool compressed = false;
+		if (deflateStream && !compress(*msg, compressed)) {
+			return false;
+		}
 		msg->writeMessageLength();
 
 		if (encryptionEnabled) {
@@ -36,10 +61,76 @@ void Protocol::onSendMessage(const OutputMessage_ptr& msg)
 			if (!compactCrypt) {
 				msg->addCryptoHeader((checksumEnabled ? 1 : 0), sequenceNumber);
 			} else {
-				msg->addCryptoHeader(2, sequenceNumber);
+				msg->addCryptoHeader(2, sequenceNumber, compressed);
 			}
 		}
 	}
+	return true;
+}
+
+bool Protocol::enableCompression(int32_t level)
+{
+	if (!compactCrypt || deflateStream) {
+		return false;
+	}
+
+	deflateStream.reset(new z_stream());
+	// raw deflate without the zlib header and trailer, the same format the client inflates
+	if (deflateInit2(deflateStream.get(), std::min<int32_t>(std::max<int32_t>(level, Z_BEST_SPEED), Z_BEST_COMPRESSION), Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+		SPDLOG_ERROR("[Protocol::enableCompression] - {}", deflateStream->msg ? deflateStream->msg : "deflateInit2 failed");
+		deflateStream.reset();
+		return false;
+	}
+	return true;
+}
+
+bool Protocol::compress(OutputMessage& msg, bool& compressed)
+{
+	size_t length = msg.getLength();
+	if (length < COMPRESSION_MIN_LENGTH || length > COMPRESSION_MAX_LENGTH) {
+		return true;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	static thread_local std::array<uint8_t, NetworkMessage::MAX_BODY_LENGTH> deflated;
+	deflateStream->next_in = msg.getOutputBuffer();
+	deflateStream->avail_in = length;
+	deflateStream->next_out = deflated.data();
+	deflateStream->avail_out = deflated.size();
+
+	// the sync flush ends the message on a byte boundary without resetting the window, so the
+	// map descriptions and item lists sent before still serve as the dictionary
+	if (deflate(deflateStream.get(), Z_SYNC_FLUSH) != Z_OK || deflateStream->avail_in != 0 || deflateStream->avail_out == 0) {
+		// the stream took part of the body and no longer matches the client's, it can't continue
+		SPDLOG_ERROR("[Protocol::compress] - deflate failed on {} bytes", length);
+		deflateEnd(deflateStream.get());
+		deflateStream.reset();
+		disconnect();
+		return false;
+	}
+
+	size_t compressedLength = deflated.size() - deflateStream->avail_out;
+	msg.replaceBody(deflated.data(), compressedLength);
+	compressed = true;
+
+	uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	compressedMessages.fetch_add(1, std::memory_order_relaxed);
+	compressionInput.fetch_add(length, std::memory_order_relaxed);
+	compressionOutput.fetch_add(compressedLength, std::memory_order_relaxed);
+	compressionTime.fetch_add(nanoseconds, std::memory_order_relaxed);
+	ConnectionManager::getInstance().recordCompression(length, compressedLength, nanoseconds);
+	return true;
+}
+
+Protocol::CompressionStats Protocol::getCompressionStats() const
+{
+	CompressionStats stats;
+	stats.messages = compressedMessages.load(std::memory_order_relaxed);
+	stats.inputBytes = compressionInput.load(std::memory_order_relaxed);
+	stats.outputBytes = compressionOutput.load(std::memory_order_relaxed);
+	stats.nanoseconds = compressionTime.load(std::memory_order_relaxed);
+	return stats;
 }
 
 void Protocol::onRecvMessage(NetworkMessage& msg)
@@ -23,11 +23,13 @@
 #include "connection.h"
 #include "xtea.h"
 
+struct z_stream_s;
+
 class Protocol : public std::enable_shared_from_this<Protocol>
 {
 	public:
-		explicit Protocol(Connection_ptr initConnection) : connection(initConnection) {}
-		virtual ~Protocol() = default;
+		explicit Protocol(Connection_ptr initConnection);
+		virtual ~Protocol();
 
 		// non-copyable
 		Protocol(const Protocol&) = delete;
@@ -35,7 +37,8 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 
 		virtual void parsePacket(NetworkMessage&) {}
 
-		virtual void onSendMessage(const OutputMessage_ptr& msg);
+		// false when the message could not be encoded, it must not be written then
+		virtual bool onSendMessage(const OutputMessage_ptr& msg);
 		void onRecvMessage(NetworkMessage& msg);
 		virtual void onRecvFirstMessage(NetworkMessage& msg) = 0;
 		virtual void onConnect() {}
@@ -63,6 +66,15 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 			}
 		}
 
+		struct CompressionStats {
+			uint64_t messages = 0;
+			uint64_t inputBytes = 0;
+			uint64_t outputBytes = 0;
+			uint64_t nanoseconds = 0;
+		};
+		// deflate totals of this connection so far, any thread
+		CompressionStats getCompressionStats() const;
+
 	protected:
 		void disconnect() const {
 			if (auto conn = getConnection()) {
@@ -91,11 +103,17 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 			rawMessages = value;
 		}
 
+		// deflates the bodies of the larger messages from now on, the sequence number of a
+		// compressed message has its high bit set, so only compact clients can use it
+		bool enableCompression(int32_t level);
+
 		virtual void release() {}
 
 	private:
 		void XTEA_encrypt(OutputMessage& msg) const;
 		bool XTEA_decrypt(NetworkMessage& msg) const;
+		// false when deflate failed and the connection is being closed, compressed tells whether the body was replaced
+		bool compress(OutputMessage& msg, bool& compressed);
 
 		friend class Connection;
 
@@ -108,6 +126,13 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 		bool checksumEnabled = true;
 		bool compactCrypt = false;
 		bool rawMessages = false;
+
+		// one stream for the whole connection, so the client's window carries across messages
+		std::unique_ptr<z_stream_s> deflateStream;
+		std::atomic<uint64_t> compressedMessages {0};
+		std::atomic<uint64_t> compressionInput {0};
+		std::atomic<uint64_t> compressionOutput {0};
+		std::atomic<uint64_t> compressionTime {0};
 };
 
 #endif
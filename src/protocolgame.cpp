@@ -33,6 +33,7 @@
 #include "iologindata.h"
 #include "iomarket.h"
 #include "waitlist.h"
+#include "loginqueue.h"
 #include "ban.h"
 #include "scheduler.h"
 #include "modules.h"
@@ -196,6 +197,14 @@ void ProtocolGame::AddItem(NetworkMessage &msg, const Item *item)
 void ProtocolGame::release()
 {
 	//dispatcher thread
+	CompressionStats compressionStats = getCompressionStats();
+	if (compressionStats.inputBytes != 0)
+	{
+		SPDLOG_INFO("[ProtocolGame::release] - {} deflated {} messages from {} to {} bytes ({:.1f}%) in {:.1f} ms",
+			player ? player->getName() : "connection", compressionStats.messages, compressionStats.inputBytes, compressionStats.outputBytes,
+			compressionStats.outputBytes * 100.0 / compressionStats.inputBytes, compressionStats.nanoseconds / 1000000.0);
+	}
+
 	if (player && player->client == shared_from_this())
 	{
 		player->client.reset();
@@ -213,154 +222,275 @@ void ProtocolGame::login(const std::string &name, uint32_t accountId, OperatingS
 	Player *foundPlayer = g_game.getPlayerByName(name);
 	if (!foundPlayer || g_config.getBoolean(ConfigManager::ALLOW_CLONES))
 	{
-		player = new Player(getThis());
-		player->setName(name);
-
-		player->incrementReferenceCounter();
-		player->setID();
-
-		if (!IOLoginData::preloadPlayer(player, name))
+		// the character is read on a login thread, the dispatcher only gets it back to place it
+		if (!g_loginQueue.tryAddJob(std::bind(&ProtocolGame::preloadLogin, getThis(), name, accountId, operatingSystem)))
 		{
-			disconnectClient("Your character could not be loaded.");
-			return;
-		}
-
-		if (IOBan::isPlayerNamelocked(player->getGUID()))
-		{
-			disconnectClient("Your character has been namelocked.");
-			return;
+			sendWaitingList("Too many players are logging in.\nPlease wait a moment.", WaitingList::getTime(1));
 		}
+		return;
+	}
 
-		if (g_game.getGameState() == GAME_STATE_CLOSING && !player->hasFlag(PlayerFlag_CanAlwaysLogin))
-		{
-			disconnectClient("The game is just going down.\nPlease try again later.");
-			return;
-		}
+	if (eventConnect != 0 || !g_config.getBoolean(ConfigManager::REPLACE_KICK_ON_LOGIN))
+	{
+		//Already trying to connect
+		disconnectClient("You are already logged in.");
+		return;
+	}
 
-		if (g_game.getGameState() == GAME_STATE_CLOSED && !player->hasFlag(PlayerFlag_CanAlwaysLogin))
-		{
-			disconnectClient("Server is currently closed.\nPlease try again later.");
-			return;
-		}
+	if (foundPlayer->client)
+	{
+		foundPlayer->disconnect();
+		foundPlayer->isConnecting = true;
 
-		if (g_config.getBoolean(ConfigManager::ONLY_PREMIUM_ACCOUNT) && !player->isPremium() && (player->getGroup()->id < account::GROUP_TYPE_GAMEMASTER || player->getAccountType() < account::ACCOUNT_TYPE_GAMEMASTER))
-		{
-			disconnectClient("Your premium time for this account is out.\n\nTo play please buy additional premium time from our website");
-			return;
-		}
+		eventConnect = g_scheduler.addEvent(createSchedulerTask(1000, std::bind(&ProtocolGame::connect, getThis(), foundPlayer->getID(), operatingSystem)));
+	}
+	else
+	{
+		connect(foundPlayer->getID(), operatingSystem);
+	}
+	OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
+}
 
-		if (g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) && player->getAccountType() < account::ACCOUNT_TYPE_GAMEMASTER && g_game.getPlayerByAccount(player->getAccount()))
-		{
-			disconnectClient("You may only login with one character\nof your account at the same time.");
-			return;
-		}
+void ProtocolGame::preloadLogin(const std::string &name, uint32_t accountId, OperatingSystem_t operatingSystem)
+{
+	//login thread
+	Player *loginPlayer = new Player(getThis());
+	loginPlayer->setName(name);
+	loginPlayer->incrementReferenceCounter();
 
-		if (!player->hasFlag(PlayerFlag_CannotBeBanned))
+	std::string error;
+	std::string banMessage;
+	if (!IOLoginData::preloadPlayer(loginPlayer, name))
+	{
+		error = "Your character could not be loaded.";
+	}
+	else if (IOBan::isPlayerNamelocked(loginPlayer->getGUID()))
+	{
+		error = "Your character has been namelocked.";
+	}
+	else if (!loginPlayer->hasFlag(PlayerFlag_CannotBeBanned))
+	{
+		BanInfo banInfo;
+		if (IOBan::isAccountBanned(accountId, banInfo))
 		{
-			BanInfo banInfo;
-			if (IOBan::isAccountBanned(accountId, banInfo))
+			if (banInfo.reason.empty())
 			{
-				if (banInfo.reason.empty())
-				{
-					banInfo.reason = "(none)";
-				}
+				banInfo.reason = "(none)";
+			}
 
-				std::ostringstream ss;
-				if (banInfo.expiresAt > 0)
-				{
-					ss << "Your account has been banned until " << formatDateShort(banInfo.expiresAt) << " by " << banInfo.bannedBy << ".\n\nReason specified:\n"
-					   << banInfo.reason;
-				}
-				else
-				{
-					ss << "Your account has been permanently banned by " << banInfo.bannedBy << ".\n\nReason specified:\n"
-					   << banInfo.reason;
-				}
-				disconnectClient(ss.str());
-				return;
+			std::ostringstream ss;
+			if (banInfo.expiresAt > 0)
+			{
+				ss << "Your account has been banned until " << formatDateShort(banInfo.expiresAt) << " by " << banInfo.bannedBy << ".\n\nReason specified:\n"
+				   << banInfo.reason;
+			}
+			else
+			{
+				ss << "Your account has been permanently banned by " << banInfo.bannedBy << ".\n\nReason specified:\n"
+				   << banInfo.reason;
 			}
+			banMessage = ss.str();
 		}
+	}
 
-		WaitingList &waitingList = WaitingList::getInstance();
-		if (!waitingList.clientLogin(player))
-		{
-			uint32_t currentSlot = waitingList.getClientSlot(player);
-			uint32_t retryTime = WaitingList::getTime(currentSlot);
-			std::ostringstream ss;
+	g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::admitLogin, getThis(), loginPlayer, operatingSystem, error, banMessage)));
+}
 
-			ss << "Too many players online.\nYou are at place "
-			   << currentSlot << " on the waiting list.";
+void ProtocolGame::admitLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, const std::string &error, const std::string &banMessage)
+{
+	//dispatcher thread
+	if (isConnectionExpired())
+	{
+		abortLogin(loginPlayer);
+		return;
+	}
 
-			auto output = OutputMessagePool::getOutputMessage();
-			output->addByte(0x16);
-			output->addString(ss.str());
-			output->addByte(retryTime);
-			send(output);
-			disconnect();
-			return;
-		}
+	if (!error.empty())
+	{
+		abortLogin(loginPlayer, error);
+		return;
+	}
 
-		if (!IOLoginData::loadPlayerById(player, player->getGUID()))
-		{
-			disconnectClient("Your character could not be loaded.");
-			SPDLOG_WARN("Player {} could not be loaded", player->getName());
-			return;
-		}
+	if (g_game.getGameState() == GAME_STATE_CLOSING && !loginPlayer->hasFlag(PlayerFlag_CanAlwaysLogin))
+	{
+		abortLogin(loginPlayer, "The game is just going down.\nPlease try again later.");
+		return;
+	}
 
-		// New Prey
-		if (!IOLoginData::loadPlayerPreyData(player))
-		{
-			SPDLOG_WARN("[ProtocolGame::login] - "
-                        "Prey data could not be loaded from player: {}",
-                        player->getName());
-			return;
-		};
+	if (g_game.getGameState() == GAME_STATE_CLOSED && !loginPlayer->hasFlag(PlayerFlag_CanAlwaysLogin))
+	{
+		abortLogin(loginPlayer, "Server is currently closed.\nPlease try again later.");
+		return;
+	}
 
-		player->setOperatingSystem(operatingSystem);
+	if (g_config.getBoolean(ConfigManager::ONLY_PREMIUM_ACCOUNT) && !loginPlayer->isPremium() && (loginPlayer->getGroup()->id < account::GROUP_TYPE_GAMEMASTER || loginPlayer->getAccountType() < account::ACCOUNT_TYPE_GAMEMASTER))
+	{
+		abortLogin(loginPlayer, "Your premium time for this account is out.\n\nTo play please buy additional premium time from our website");
+		return;
+	}
 
-		if (!g_game.placeCreature(player, player->getLoginPosition()))
-		{
-			if (!g_game.placeCreature(player, player->getTemplePosition(), false, true))
-			{
-				disconnectClient("Temple position is wrong. Please, contact the administrator.");
-				SPDLOG_WARN("Player {} temple position is wrong", player->getName());
-				return;
-			}
-		}
+	if (isAccountOnline(loginPlayer))
+	{
+		abortLogin(loginPlayer, "You may only login with one character\nof your account at the same time.");
+		return;
+	}
 
-		if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX)
-		{
-			player->registerCreatureEvent("ExtendedOpcode");
-		}
+	if (!banMessage.empty())
+	{
+		abortLogin(loginPlayer, banMessage);
+		return;
+	}
 
-		player->lastIP = player->getIP();
-		player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
-		acceptPackets = true;
+	WaitingList &waitingList = WaitingList::getInstance();
+	if (!waitingList.clientLogin(loginPlayer))
+	{
+		uint32_t currentSlot = waitingList.getClientSlot(loginPlayer);
+		std::ostringstream ss;
+
+		ss << "Too many players online.\nYou are at place "
+		   << currentSlot << " on the waiting list.";
+
+		abortLogin(loginPlayer);
+		sendWaitingList(ss.str(), WaitingList::getTime(currentSlot));
+		return;
 	}
-	else
+
+	queueLoadLogin(loginPlayer, operatingSystem, 0);
+}
+
+void ProtocolGame::queueLoadLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, uint32_t reloads)
+{
+	//dispatcher thread
+	uint32_t loadWrites = IOLoginData::beginLoginLoad(loginPlayer->getGUID());
+	g_loginQueue.addJob(std::bind(&ProtocolGame::loadLogin, getThis(), loginPlayer, operatingSystem, loadWrites, reloads),
+		std::bind(&ProtocolGame::finishLogin, getThis(), loginPlayer, operatingSystem, loadWrites, reloads, false, DeferredPlayerLoad()));
+}
+
+void ProtocolGame::loadLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, uint32_t loadWrites, uint32_t reloads)
+{
+	//login thread
+	DeferredPlayerLoad deferred;
+	bool loaded = IOLoginData::loadPlayerById(loginPlayer, loginPlayer->getGUID(), &deferred);
+	if (!loaded)
+	{
+		SPDLOG_WARN("Player {} could not be loaded", loginPlayer->getName());
+	}
+	// New Prey
+	else if (!IOLoginData::loadPlayerPreyData(loginPlayer))
+	{
+		SPDLOG_WARN("[ProtocolGame::loadLogin] - "
+					"Prey data could not be loaded from player: {}",
+					loginPlayer->getName());
+		loaded = false;
+	}
+
+	g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::finishLogin, getThis(), loginPlayer, operatingSystem, loadWrites, reloads, loaded, std::move(deferred))));
+}
+
+void ProtocolGame::finishLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, uint32_t loadWrites, uint32_t reloads, bool loaded, const DeferredPlayerLoad &deferred)
+{
+	//dispatcher thread
+	// the character was saved offline after the login thread read it, placing what it read would undo that on the next save
+	if (IOLoginData::finishLoginLoad(loginPlayer->getGUID(), loadWrites) && loaded && !isConnectionExpired())
 	{
-		if (eventConnect != 0 || !g_config.getBoolean(ConfigManager::REPLACE_KICK_ON_LOGIN))
+		if (reloads >= LOGIN_MAX_RELOADS)
 		{
-			//Already trying to connect
-			disconnectClient("You are already logged in.");
+			WaitingList::getInstance().loginFinished();
+			abortLogin(loginPlayer, "Your character is being updated.\nPlease try again in a moment.");
 			return;
 		}
 
-		if (foundPlayer->client)
-		{
-			foundPlayer->disconnect();
-			foundPlayer->isConnecting = true;
+		Player *reloadPlayer = new Player(getThis());
+		reloadPlayer->setGUID(loginPlayer->getGUID());
+		reloadPlayer->setName(loginPlayer->getName());
+		reloadPlayer->incrementReferenceCounter();
+		abortLogin(loginPlayer);
 
-			eventConnect = g_scheduler.addEvent(createSchedulerTask(1000, std::bind(&ProtocolGame::connect, getThis(), foundPlayer->getID(), operatingSystem)));
-		}
-		else
+		// the waiting list slot stays taken until the reload is placed
+		queueLoadLogin(reloadPlayer, operatingSystem, reloads + 1);
+		return;
+	}
+
+	WaitingList::getInstance().loginFinished();
+
+	if (isConnectionExpired())
+	{
+		abortLogin(loginPlayer);
+		return;
+	}
+
+	if (!loaded)
+	{
+		abortLogin(loginPlayer, "Your character could not be loaded.");
+		return;
+	}
+
+	// others may have logged in while the character loaded
+	if (!g_config.getBoolean(ConfigManager::ALLOW_CLONES) && g_game.getPlayerByName(loginPlayer->getName()))
+	{
+		abortLogin(loginPlayer, "You are already logged in.");
+		return;
+	}
+
+	if (isAccountOnline(loginPlayer))
+	{
+		abortLogin(loginPlayer, "You may only login with one character\nof your account at the same time.");
+		return;
+	}
+
+	player = loginPlayer;
+	player->setID();
+	IOLoginData::finishPlayerLoad(player, deferred);
+	player->setOperatingSystem(operatingSystem);
+
+	if (!g_game.placeCreature(player, player->getLoginPosition()))
+	{
+		if (!g_game.placeCreature(player, player->getTemplePosition(), false, true))
 		{
-			connect(foundPlayer->getID(), operatingSystem);
+			disconnectClient("Temple position is wrong. Please, contact the administrator.");
+			SPDLOG_WARN("Player {} temple position is wrong", player->getName());
+			return;
 		}
 	}
+
+	if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX)
+	{
+		player->registerCreatureEvent("ExtendedOpcode");
+	}
+
+	player->lastIP = player->getIP();
+	player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
+	acceptPackets = true;
 	OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
 }
 
+void ProtocolGame::abortLogin(Player *loginPlayer, const std::string &message/* = ""*/)
+{
+	//dispatcher thread, the player never entered the game
+	loginPlayer->client.reset();
+	loginPlayer->decrementReferenceCounter();
+
+	if (!message.empty())
+	{
+		disconnectClient(message);
+	}
+}
+
+bool ProtocolGame::isAccountOnline(const Player *loginPlayer) const
+{
+	return g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) && loginPlayer->getAccountType() < account::ACCOUNT_TYPE_GAMEMASTER && g_game.getPlayerByAccount(loginPlayer->getAccount());
+}
+
+void ProtocolGame::sendWaitingList(const std::string &message, uint8_t retryTime)
+{
+	auto output = OutputMessagePool::getOutputMessage();
+	output->addByte(0x16);
+	output->addString(message);
+	output->addByte(retryTime);
+	send(output);
+	disconnect();
+}
+
 void ProtocolGame::connect(uint32_t playerId, OperatingSystem_t operatingSystem)
 {
 	eventConnect = 0;
@@ -481,7 +611,11 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage &msg)
 	enableXTEAEncryption();
 	setXTEAKey(std::move(key));
 
-	msg.skipBytes(1); // gamemaster flag
+	uint8_t clientFlags = msg.getByte(); // gamemaster flag
+	if ((clientFlags & CLIENT_FLAG_COMPRESSION) != 0 && g_config.getBoolean(ConfigManager::PACKET_COMPRESSION))
+	{
+		enableCompression(g_config.getNumber(ConfigManager::PACKET_COMPRESSION_LEVEL));
+	}
 
 	std::string sessionKey = msg.getString();
 	size_t pos = sessionKey.find('\n');
@@ -629,43 +763,43 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 
 	// Modules system
 	if(recvbyte != 0xD3){
-		g_dispatcher.addTask(createTask(std::bind(&Modules::executeOnRecvbyte, g_modules, player, msg, recvbyte)));
+		g_dispatcher.addTask(createTask(std::bind(&Modules::executeOnRecvbyte, g_modules, player, msg, recvbyte), TASK_CATEGORY_MODULES));
 	}
 
 	switch (recvbyte) {
-		case 0x14: g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::logout, getThis(), true, false))); break;
-		case 0x1D: addGameTask(&Game::playerReceivePingBack, player->getID()); break;
-		case 0x1E: addGameTask(&Game::playerReceivePing, player->getID()); break;
+		case 0x14: g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::logout, getThis(), true, false), recvbyte)); break;
+		case 0x1D: addGameTask(recvbyte, &Game::playerReceivePingBack, player->getID()); break;
+		case 0x1E: addGameTask(recvbyte, &Game::playerReceivePing, player->getID()); break;
 		case 0x2a: addBestiaryTrackerList(msg); break;
 		case 0x2c: parseLeaderFinderWindow(msg); break;
 		case 0x2d: parseMemberFinderWindow(msg); break;
 		case 0x28: parseStashWithdraw(msg); break;
 		case 0x32: parseExtendedOpcode(msg); break; //otclient extended opcode
 		case 0x64: parseAutoWalk(msg); break;
-		case 0x65: addGameTask(&Game::playerMove, player->getID(), DIRECTION_NORTH); break;
-		case 0x66: addGameTask(&Game::playerMove, player->getID(), DIRECTION_EAST); break;
-		case 0x67: addGameTask(&Game::playerMove, player->getID(), DIRECTION_SOUTH); break;
-		case 0x68: addGameTask(&Game::playerMove, player->getID(), DIRECTION_WEST); break;
-		case 0x69: addGameTask(&Game::playerStopAutoWalk, player->getID()); break;
-		case 0x6A: addGameTask(&Game::playerMove, player->getID(), DIRECTION_NORTHEAST); break;
-		case 0x6B: addGameTask(&Game::playerMove, player->getID(), DIRECTION_SOUTHEAST); break;
-		case 0x6C: addGameTask(&Game::playerMove, player->getID(), DIRECTION_SOUTHWEST); break;
-		case 0x6D: addGameTask(&Game::playerMove, player->getID(), DIRECTION_NORTHWEST); break;
-		case 0x6F: addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_NORTH); break;
-		case 0x70: addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_EAST); break;
-		case 0x71: addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_SOUTH); break;
-		case 0x72: addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_WEST); break;
+		case 0x65: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_NORTH); break;
+		case 0x66: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_EAST); break;
+		case 0x67: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_SOUTH); break;
+		case 0x68: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_WEST); break;
+		case 0x69: addGameTask(recvbyte, &Game::playerStopAutoWalk, player->getID()); break;
+		case 0x6A: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_NORTHEAST); break;
+		case 0x6B: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_SOUTHEAST); break;
+		case 0x6C: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_SOUTHWEST); break;
+		case 0x6D: addGameTask(recvbyte, &Game::playerMove, player->getID(), DIRECTION_NORTHWEST); break;
+		case 0x6F: addGameTaskTimed(recvbyte, DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_NORTH); break;
+		case 0x70: addGameTaskTimed(recvbyte, DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_EAST); break;
+		case 0x71: addGameTaskTimed(recvbyte, DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_SOUTH); break;
+		case 0x72: addGameTaskTimed(recvbyte, DISPATCHER_TASK_EXPIRATION, &Game::playerTurn, player->getID(), DIRECTION_WEST); break;
 		case 0x73: parseTeleport(msg); break;
 		case 0x77: parseHotkeyEquip(msg); break;
 		case 0x78: parseThrow(msg); break;
 		case 0x79: parseLookInShop(msg); break;
 		case 0x7A: parsePlayerPurchase(msg); break;
 		case 0x7B: parsePlayerSale(msg); break;
-		case 0x7C: addGameTask(&Game::playerCloseShop, player->getID()); break;
+		case 0x7C: addGameTask(recvbyte, &Game::playerCloseShop, player->getID()); break;
 		case 0x7D: parseRequestTrade(msg); break;
 		case 0x7E: parseLookInTrade(msg); break;
-		case 0x7F: addGameTask(&Game::playerAcceptTrade, player->getID()); break;
-		case 0x80: addGameTask(&Game::playerCloseTrade, player->getID()); break;
+		case 0x7F: addGameTask(recvbyte, &Game::playerAcceptTrade, player->getID()); break;
+		case 0x80: addGameTask(recvbyte, &Game::playerCloseTrade, player->getID()); break;
 		case 0x82: parseUseItem(msg); break;
 		case 0x83: parseUseItemEx(msg); break;
 		case 0x84: parseUseWithCreature(msg); break;
@@ -684,11 +818,11 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		case 0x91: parseQuickLootBlackWhitelist(msg); break;
 		case 0x92: parseRequestLockItems(); break;
 		case 0x96: parseSay(msg); break;
-		case 0x97: addGameTask(&Game::playerRequestChannels, player->getID()); break;
+		case 0x97: addGameTask(recvbyte, &Game::playerRequestChannels, player->getID()); break;
 		case 0x98: parseOpenChannel(msg); break;
 		case 0x99: parseCloseChannel(msg); break;
 		case 0x9A: parseOpenPrivateChannel(msg); break;
-		case 0x9E: addGameTask(&Game::playerCloseNpcChannel, player->getID()); break;
+		case 0x9E: addGameTask(recvbyte, &Game::playerCloseNpcChannel, player->getID()); break;
 		case 0xA0: parseFightModes(msg); break;
 		case 0xA1: parseAttack(msg); break;
 		case 0xA2: parseFollow(msg); break;
@@ -696,22 +830,22 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		case 0xA4: parseJoinParty(msg); break;
 		case 0xA5: parseRevokePartyInvite(msg); break;
 		case 0xA6: parsePassPartyLeadership(msg); break;
-		case 0xA7: addGameTask(&Game::playerLeaveParty, player->getID()); break;
+		case 0xA7: addGameTask(recvbyte, &Game::playerLeaveParty, player->getID()); break;
 		case 0xA8: parseEnableSharedPartyExperience(msg); break;
-		case 0xAA: addGameTask(&Game::playerCreatePrivateChannel, player->getID()); break;
+		case 0xAA: addGameTask(recvbyte, &Game::playerCreatePrivateChannel, player->getID()); break;
 		case 0xAB: parseChannelInvite(msg); break;
 		case 0xAC: parseChannelExclude(msg); break;
 		case 0xB1: parseHighscores(msg); break;
-		case 0xBE: addGameTask(&Game::playerCancelAttackAndFollow, player->getID()); break;
+		case 0xBE: addGameTask(recvbyte, &Game::playerCancelAttackAndFollow, player->getID()); break;
 		case 0xC7: parseTournamentLeaderboard(msg); break;
 		case 0xC9: /* update tile */ break;
 		case 0xCA: parseUpdateContainer(msg); break;
 		case 0xCB: parseBrowseField(msg); break;
 		case 0xCC: parseSeekInContainer(msg); break;
 		case 0xCD: parseInspectionObject(msg); break;
-		case 0xD2: addGameTask(&Game::playerRequestOutfit, player->getID()); break;
+		case 0xD2: addGameTask(recvbyte, &Game::playerRequestOutfit, player->getID()); break;
 		//g_dispatcher.addTask(createTask(std::bind(&Modules::executeOnRecvbyte, g_modules, player, msg, recvbyte)));
-		case 0xD3: g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::parseSetOutfit, this, msg))); break;
+		case 0xD3: g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::parseSetOutfit, this, msg), recvbyte)); break;
 		case 0xD4: parseToggleMount(msg); break;
 		case 0xD5: parseApplyImbuement(msg); break;
 		case 0xD6: parseClearingImbuement(msg); break;
@@ -729,7 +863,7 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		case 0xE8: parseDebugAssert(msg); break;
 		case 0xEE: parseGreet(msg); break;
 		case 0xEF: if (!g_config.getBoolean(ConfigManager::STOREMODULES)) { parseCoinTransfer(msg); } break; /* premium coins transfer */
-		case 0xF0: addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerShowQuestLog, player->getID()); break;
+		case 0xF0: addGameTaskTimed(recvbyte, DISPATCHER_TASK_EXPIRATION, &Game::playerShowQuestLog, player->getID()); break;
 		case 0xF1: parseQuestLine(msg); break;
 		// case 0xF2: parseRuleViolationReport(msg); break;
 		case 0xF3: /* get object info */ break;
@@ -767,7 +901,7 @@ void ProtocolGame::parseHotkeyEquip(NetworkMessage &msg)
 		return;
 	}
 	uint16_t spriteid = msg.get<uint16_t>();
-	addGameTask(&Game::onPressHotkeyEquip, player, spriteid);
+	addGameTask(0x77, &Game::onPressHotkeyEquip, player, spriteid);
 	return;
 }
 
@@ -1021,31 +1155,31 @@ bool ProtocolGame::canSee(int32_t x, int32_t y, int32_t z) const
 void ProtocolGame::parseChannelInvite(NetworkMessage &msg)
 {
 	const std::string name = msg.getString();
-	addGameTask(&Game::playerChannelInvite, player->getID(), name);
+	addGameTask(0xAB, &Game::playerChannelInvite, player->getID(), name);
 }
 
 void ProtocolGame::parseChannelExclude(NetworkMessage &msg)
 {
 	const std::string name = msg.getString();
-	addGameTask(&Game::playerChannelExclude, player->getID(), name);
+	addGameTask(0xAC, &Game::playerChannelExclude, player->getID(), name);
 }
 
 void ProtocolGame::parseOpenChannel(NetworkMessage &msg)
 {
 	uint16_t channelId = msg.get<uint16_t>();
-	addGameTask(&Game::playerOpenChannel, player->getID(), channelId);
+	addGameTask(0x98, &Game::playerOpenChannel, player->getID(), channelId);
 }
 
 void ProtocolGame::parseCloseChannel(NetworkMessage &msg)
 {
 	uint16_t channelId = msg.get<uint16_t>();
-	addGameTask(&Game::playerCloseChannel, player->getID(), channelId);
+	addGameTask(0x99, &Game::playerCloseChannel, player->getID(), channelId);
 }
 
 void ProtocolGame::parseOpenPrivateChannel(NetworkMessage &msg)
 {
 	const std::string receiver = msg.getString();
-	addGameTask(&Game::playerOpenPrivateChannel, player->getID(), receiver);
+	addGameTask(0x9A, &Game::playerOpenPrivateChannel, player->getID(), receiver);
 }
 
 void ProtocolGame::parseAutoWalk(NetworkMessage &msg)
@@ -1098,7 +1232,7 @@ void ProtocolGame::parseAutoWalk(NetworkMessage &msg)
 		return;
 	}
 
-	addGameTask(&Game::playerAutoWalk, player->getID(), path);
+	addGameTask(0x64, &Game::playerAutoWalk, player->getID(), path);
 }
 
 void ProtocolGame::parseSetOutfit(NetworkMessage &msg)
@@ -1156,7 +1290,7 @@ void ProtocolGame::parseSetOutfit(NetworkMessage &msg)
 void ProtocolGame::parseToggleMount(NetworkMessage &msg)
 {
 	bool mount = msg.getByte() != 0;
-	addGameTask(&Game::playerToggleMount, player->getID(), mount);
+	addGameTask(0xD4, &Game::playerToggleMount, player->getID(), mount);
 }
 
 void ProtocolGame::parseApplyImbuement(NetworkMessage &msg)
@@ -1164,18 +1298,18 @@ void ProtocolGame::parseApplyImbuement(NetworkMessage &msg)
 	uint8_t slot = msg.getByte();
 	uint32_t imbuementId = msg.get<uint32_t>();
 	bool protectionCharm = msg.getByte() != 0x00;
-	addGameTask(&Game::playerApplyImbuement, player->getID(), imbuementId, slot, protectionCharm);
+	addGameTask(0xD5, &Game::playerApplyImbuement, player->getID(), imbuementId, slot, protectionCharm);
 }
 
 void ProtocolGame::parseClearingImbuement(NetworkMessage &msg)
 {
 	uint8_t slot = msg.getByte();
-	addGameTask(&Game::playerClearingImbuement, player->getID(), slot);
+	addGameTask(0xD6, &Game::playerClearingImbuement, player->getID(), slot);
 }
 
 void ProtocolGame::parseCloseImbuingWindow(NetworkMessage &)
 {
-	addGameTask(&Game::playerCloseImbuingWindow, player->getID());
+	addGameTask(0xD7, &Game::playerCloseImbuingWindow, player->getID());
 }
 
 void ProtocolGame::parseUseItem(NetworkMessage &msg)
@@ -1184,7 +1318,7 @@ void ProtocolGame::parseUseItem(NetworkMessage &msg)
 	uint16_t spriteId = msg.get<uint16_t>();
 	uint8_t stackpos = msg.getByte();
 	uint8_t index = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerUseItem, player->getID(), pos, stackpos, index, spriteId);
+	addGameTaskTimed(0x82, DISPATCHER_TASK_EXPIRATION, &Game::playerUseItem, player->getID(), pos, stackpos, index, spriteId);
 }
 
 void ProtocolGame::parseUseItemEx(NetworkMessage &msg)
@@ -1195,7 +1329,7 @@ void ProtocolGame::parseUseItemEx(NetworkMessage &msg)
 	Position toPos = msg.getPosition();
 	uint16_t toSpriteId = msg.get<uint16_t>();
 	uint8_t toStackPos = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerUseItemEx, player->getID(), fromPos, fromStackPos, fromSpriteId, toPos, toStackPos, toSpriteId);
+	addGameTaskTimed(0x83, DISPATCHER_TASK_EXPIRATION, &Game::playerUseItemEx, player->getID(), fromPos, fromStackPos, fromSpriteId, toPos, toStackPos, toSpriteId);
 }
 
 void ProtocolGame::parseUseWithCreature(NetworkMessage &msg)
@@ -1204,31 +1338,31 @@ void ProtocolGame::parseUseWithCreature(NetworkMessage &msg)
 	uint16_t spriteId = msg.get<uint16_t>();
 	uint8_t fromStackPos = msg.getByte();
 	uint32_t creatureId = msg.get<uint32_t>();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerUseWithCreature, player->getID(), fromPos, fromStackPos, creatureId, spriteId);
+	addGameTaskTimed(0x84, DISPATCHER_TASK_EXPIRATION, &Game::playerUseWithCreature, player->getID(), fromPos, fromStackPos, creatureId, spriteId);
 }
 
 void ProtocolGame::parseCloseContainer(NetworkMessage &msg)
 {
 	uint8_t cid = msg.getByte();
-	addGameTask(&Game::playerCloseContainer, player->getID(), cid);
+	addGameTask(0x87, &Game::playerCloseContainer, player->getID(), cid);
 }
 
 void ProtocolGame::parseUpArrowContainer(NetworkMessage &msg)
 {
 	uint8_t cid = msg.getByte();
-	addGameTask(&Game::playerMoveUpContainer, player->getID(), cid);
+	addGameTask(0x88, &Game::playerMoveUpContainer, player->getID(), cid);
 }
 
 void ProtocolGame::parseUpdateContainer(NetworkMessage &msg)
 {
 	uint8_t cid = msg.getByte();
-	addGameTask(&Game::playerUpdateContainer, player->getID(), cid);
+	addGameTask(0xCA, &Game::playerUpdateContainer, player->getID(), cid);
 }
 
 void ProtocolGame::parseTeleport(NetworkMessage &msg)
 {
 	Position newPosition = msg.getPosition();
-	addGameTask(&Game::playerTeleport, player->getID(), newPosition);
+	addGameTask(0x73, &Game::playerTeleport, player->getID(), newPosition);
 }
 
 void ProtocolGame::parseThrow(NetworkMessage &msg)
@@ -1241,7 +1375,7 @@ void ProtocolGame::parseThrow(NetworkMessage &msg)
 
 	if (toPos != fromPos)
 	{
-		addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerMoveThing, player->getID(), fromPos, spriteId, fromStackpos, toPos, count);
+		addGameTaskTimed(0x78, DISPATCHER_TASK_EXPIRATION, &Game::playerMoveThing, player->getID(), fromPos, spriteId, fromStackpos, toPos, count);
 	}
 }
 
@@ -1250,13 +1384,13 @@ void ProtocolGame::parseLookAt(NetworkMessage &msg)
 	Position pos = msg.getPosition();
 	msg.skipBytes(2); // spriteId
 	uint8_t stackpos = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerLookAt, player->getID(), pos, stackpos);
+	addGameTaskTimed(0x8C, DISPATCHER_TASK_EXPIRATION, &Game::playerLookAt, player->getID(), pos, stackpos);
 }
 
 void ProtocolGame::parseLookInBattleList(NetworkMessage &msg)
 {
 	uint32_t creatureId = msg.get<uint32_t>();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerLookInBattleList, player->getID(), creatureId);
+	addGameTaskTimed(0x8D, DISPATCHER_TASK_EXPIRATION, &Game::playerLookInBattleList, player->getID(), creatureId);
 }
 
 void ProtocolGame::parseQuickLoot(NetworkMessage &msg)
@@ -1264,7 +1398,7 @@ void ProtocolGame::parseQuickLoot(NetworkMessage &msg)
 	Position pos = msg.getPosition();
 	uint16_t spriteId = msg.get<uint16_t>();
 	uint8_t stackpos = msg.getByte();
-	addGameTask(&Game::playerQuickLoot, player->getID(), pos, spriteId, stackpos, nullptr);
+	addGameTask(0x8F, &Game::playerQuickLoot, player->getID(), pos, spriteId, stackpos, nullptr);
 }
 
 void ProtocolGame::parseLootContainer(NetworkMessage &msg)
@@ -1276,22 +1410,22 @@ void ProtocolGame::parseLootContainer(NetworkMessage &msg)
 		Position pos = msg.getPosition();
 		uint16_t spriteId = msg.get<uint16_t>();
 		uint8_t stackpos = msg.getByte();
-		addGameTask(&Game::playerSetLootContainer, player->getID(), category, pos, spriteId, stackpos);
+		addGameTask(0x90, &Game::playerSetLootContainer, player->getID(), category, pos, spriteId, stackpos);
 	}
 	else if (action == 1)
 	{
 		ObjectCategory_t category = (ObjectCategory_t)msg.getByte();
-		addGameTask(&Game::playerClearLootContainer, player->getID(), category);
+		addGameTask(0x90, &Game::playerClearLootContainer, player->getID(), category);
 	}
 	else if (action == 2)
 	{
 		ObjectCategory_t category = (ObjectCategory_t)msg.getByte();
-		addGameTask(&Game::playerOpenLootContainer, player->getID(), category);
+		addGameTask(0x90, &Game::playerOpenLootContainer, player->getID(), category);
 	}
 	else if (action == 3)
 	{
 		bool useMainAsFallback = msg.getByte() == 1;
-		addGameTask(&Game::playerSetQuickLootFallback, player->getID(), useMainAsFallback);
+		addGameTask(0x90, &Game::playerSetQuickLootFallback, player->getID(), useMainAsFallback);
 	}
 }
 
@@ -1308,12 +1442,12 @@ void ProtocolGame::parseQuickLootBlackWhitelist(NetworkMessage &msg)
 		listedItems.push_back(msg.get<uint16_t>());
 	}
 
-	addGameTask(&Game::playerQuickLootBlackWhitelist, player->getID(), filter, listedItems);
+	addGameTask(0x91, &Game::playerQuickLootBlackWhitelist, player->getID(), filter, listedItems);
 }
 
 void ProtocolGame::parseRequestLockItems()
 {
-	addGameTask(&Game::playerRequestLockFind, player->getID());
+	addGameTask(0x92, &Game::playerRequestLockFind, player->getID());
 }
 
 void ProtocolGame::parseSay(NetworkMessage &msg)
@@ -1346,7 +1480,7 @@ void ProtocolGame::parseSay(NetworkMessage &msg)
 		return;
 	}
 
-	addGameTask(&Game::playerSay, player->getID(), channelId, type, receiver, text);
+	addGameTask(0x96, &Game::playerSay, player->getID(), channelId, type, receiver, text);
 }
 
 void ProtocolGame::parseFightModes(NetworkMessage &msg)
@@ -1370,28 +1504,28 @@ void ProtocolGame::parseFightModes(NetworkMessage &msg)
 		fightMode = FIGHTMODE_DEFENSE;
 	}
 
-	addGameTask(&Game::playerSetFightModes, player->getID(), fightMode, rawChaseMode != 0, rawSecureMode != 0);
+	addGameTask(0xA0, &Game::playerSetFightModes, player->getID(), fightMode, rawChaseMode != 0, rawSecureMode != 0);
 }
 
 void ProtocolGame::parseAttack(NetworkMessage &msg)
 {
 	uint32_t creatureId = msg.get<uint32_t>();
 	// msg.get<uint32_t>(); creatureId (same as above)
-	addGameTask(&Game::playerSetAttackedCreature, player->getID(), creatureId);
+	addGameTask(0xA1, &Game::playerSetAttackedCreature, player->getID(), creatureId);
 }
 
 void ProtocolGame::parseFollow(NetworkMessage &msg)
 {
 	uint32_t creatureId = msg.get<uint32_t>();
 	// msg.get<uint32_t>(); creatureId (same as above)
-	addGameTask(&Game::playerFollowCreature, player->getID(), creatureId);
+	addGameTask(0xA2, &Game::playerFollowCreature, player->getID(), creatureId);
 }
 
 void ProtocolGame::parseTextWindow(NetworkMessage &msg)
 {
 	uint32_t windowTextId = msg.get<uint32_t>();
 	const std::string newText = msg.getString();
-	addGameTask(&Game::playerWriteItem, player->getID(), windowTextId, newText);
+	addGameTask(0x89, &Game::playerWriteItem, player->getID(), windowTextId, newText);
 }
 
 void ProtocolGame::parseHouseWindow(NetworkMessage &msg)
@@ -1399,14 +1533,14 @@ void ProtocolGame::parseHouseWindow(NetworkMessage &msg)
 	uint8_t doorId = msg.getByte();
 	uint32_t id = msg.get<uint32_t>();
 	const std::string text = msg.getString();
-	addGameTask(&Game::playerUpdateHouseWindow, player->getID(), doorId, id, text);
+	addGameTask(0x8A, &Game::playerUpdateHouseWindow, player->getID(), doorId, id, text);
 }
 
 void ProtocolGame::parseLookInShop(NetworkMessage &msg)
 {
 	uint16_t id = msg.get<uint16_t>();
 	uint8_t count = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerLookInShop, player->getID(), id, count);
+	addGameTaskTimed(0x79, DISPATCHER_TASK_EXPIRATION, &Game::playerLookInShop, player->getID(), id, count);
 }
 
 void ProtocolGame::parsePlayerPurchase(NetworkMessage &msg)
@@ -1416,7 +1550,7 @@ void ProtocolGame::parsePlayerPurchase(NetworkMessage &msg)
 	uint8_t amount = msg.getByte();
 	bool ignoreCap = msg.getByte() != 0;
 	bool inBackpacks = msg.getByte() != 0;
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerPurchaseItem, player->getID(), id, count, amount, ignoreCap, inBackpacks);
+	addGameTaskTimed(0x7A, DISPATCHER_TASK_EXPIRATION, &Game::playerPurchaseItem, player->getID(), id, count, amount, ignoreCap, inBackpacks);
 }
 
 void ProtocolGame::parsePlayerSale(NetworkMessage &msg)
@@ -1425,7 +1559,7 @@ void ProtocolGame::parsePlayerSale(NetworkMessage &msg)
 	uint8_t count = msg.getByte();
 	uint8_t amount = msg.getByte();
 	bool ignoreEquipped = msg.getByte() != 0;
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerSellItem, player->getID(), id, count, amount, ignoreEquipped);
+	addGameTaskTimed(0x7B, DISPATCHER_TASK_EXPIRATION, &Game::playerSellItem, player->getID(), id, count, amount, ignoreEquipped);
 }
 
 void ProtocolGame::parseRequestTrade(NetworkMessage &msg)
@@ -1434,26 +1568,26 @@ void ProtocolGame::parseRequestTrade(NetworkMessage &msg)
 	uint16_t spriteId = msg.get<uint16_t>();
 	uint8_t stackpos = msg.getByte();
 	uint32_t playerId = msg.get<uint32_t>();
-	addGameTask(&Game::playerRequestTrade, player->getID(), pos, stackpos, playerId, spriteId);
+	addGameTask(0x7D, &Game::playerRequestTrade, player->getID(), pos, stackpos, playerId, spriteId);
 }
 
 void ProtocolGame::parseLookInTrade(NetworkMessage &msg)
 {
 	bool counterOffer = (msg.getByte() == 0x01);
 	uint8_t index = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerLookInTrade, player->getID(), counterOffer, index);
+	addGameTaskTimed(0x7E, DISPATCHER_TASK_EXPIRATION, &Game::playerLookInTrade, player->getID(), counterOffer, index);
 }
 
 void ProtocolGame::parseAddVip(NetworkMessage &msg)
 {
 	const std::string name = msg.getString();
-	addGameTask(&Game::playerRequestAddVip, player->getID(), name);
+	addGameTask(0xDC, &Game::playerRequestAddVip, player->getID(), name);
 }
 
 void ProtocolGame::parseRemoveVip(NetworkMessage &msg)
 {
 	uint32_t guid = msg.get<uint32_t>();
-	addGameTask(&Game::playerRequestRemoveVip, player->getID(), guid);
+	addGameTask(0xDD, &Game::playerRequestRemoveVip, player->getID(), guid);
 }
 
 void ProtocolGame::parseEditVip(NetworkMessage &msg)
@@ -1462,7 +1596,7 @@ void ProtocolGame::parseEditVip(NetworkMessage &msg)
 	const std::string description = msg.getString();
 	uint32_t icon = std::min<uint32_t>(10, msg.get<uint32_t>()); // 10 is max icon in 9.63
 	bool notify = msg.getByte() != 0;
-	addGameTask(&Game::playerRequestEditVip, player->getID(), guid, description, icon, notify);
+	addGameTask(0xDE, &Game::playerRequestEditVip, player->getID(), guid, description, icon, notify);
 }
 
 void ProtocolGame::parseRotateItem(NetworkMessage &msg)
@@ -1470,7 +1604,7 @@ void ProtocolGame::parseRotateItem(NetworkMessage &msg)
 	Position pos = msg.getPosition();
 	uint16_t spriteId = msg.get<uint16_t>();
 	uint8_t stackpos = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerRotateItem, player->getID(), pos, stackpos, spriteId);
+	addGameTaskTimed(0x85, DISPATCHER_TASK_EXPIRATION, &Game::playerRotateItem, player->getID(), pos, stackpos, spriteId);
 }
 
 void ProtocolGame::parseWrapableItem(NetworkMessage &msg)
@@ -1478,7 +1612,7 @@ void ProtocolGame::parseWrapableItem(NetworkMessage &msg)
 	Position pos = msg.getPosition();
 	uint16_t spriteId = msg.get<uint16_t>();
 	uint8_t stackpos = msg.getByte();
-	addGameTaskTimed(DISPATCHER_TASK_EXPIRATION, &Game::playerWrapableItem, player->getID(), pos, stackpos, spriteId);
+	addGameTaskTimed(0x8B, DISPATCHER_TASK_EXPIRATION, &Game::playerWrapableItem, player->getID(), pos, stackpos, spriteId);
 }
 
 void ProtocolGame::parseInspectionObject(NetworkMessage &msg)
@@ -1691,7 +1825,7 @@ void ProtocolGame::parseTournamentLeaderboard(NetworkMessage &msg)
 	uint8_t elementsPerPage = msg.getByte();
 	(void)elementsPerPage;
 
-	addGameTask(&Game::playerTournamentLeaderboard, player->getID(), ledaerboardType);
+	addGameTask(0xC7, &Game::playerTournamentLeaderboard, player->getID(), ledaerboardType);
 }
 
 void ProtocolGame::parseConfigureShowOffSocket(NetworkMessage& msg)
@@ -1719,7 +1853,7 @@ void ProtocolGame::parseRuleViolationReport(NetworkMessage &msg)
 		msg.get<uint32_t>(); // statement id, used to get whatever player have said, we don't log that.
 	}
 
-	addGameTask(&Game::playerReportRuleViolationReport, player->getID(), targetName, reportType, reportReason, comment, translation);
+	addGameTask(0xF2, &Game::playerReportRuleViolationReport, player->getID(), targetName, reportType, reportReason, comment, translation);
 }
 
 void ProtocolGame::parseBestiarysendRaces()
@@ -2400,13 +2534,13 @@ void ProtocolGame::parseBugReport(NetworkMessage &msg)
 		position = msg.getPosition();
 	}
 
-	addGameTask(&Game::playerReportBug, player->getID(), message, position, category);
+	addGameTask(0xE6, &Game::playerReportBug, player->getID(), message, position, category);
 }
 
 void ProtocolGame::parseGreet(NetworkMessage &msg)
 {
 	uint32_t npcId = msg.get<uint32_t>();
-	addGameTask(&Game::playerNpcGreet, player->getID(), npcId);
+	addGameTask(0xEE, &Game::playerNpcGreet, player->getID(), npcId);
 }
 
 void ProtocolGame::parseDebugAssert(NetworkMessage &msg)
@@ -2422,48 +2556,48 @@ void ProtocolGame::parseDebugAssert(NetworkMessage &msg)
 	std::string date = msg.getString();
 	std::string description = msg.getString();
 	std::string comment = msg.getString();
-	addGameTask(&Game::playerDebugAssert, player->getID(), assertLine, date, description, comment);
+	addGameTask(0xE8, &Game::playerDebugAssert, player->getID(), assertLine, date, description, comment);
 }
 
 void ProtocolGame::parseInviteToParty(NetworkMessage &msg)
 {
 	uint32_t targetId = msg.get<uint32_t>();
-	addGameTask(&Game::playerInviteToParty, player->getID(), targetId);
+	addGameTask(0xA3, &Game::playerInviteToParty, player->getID(), targetId);
 }
 
 void ProtocolGame::parseJoinParty(NetworkMessage &msg)
 {
 	uint32_t targetId = msg.get<uint32_t>();
-	addGameTask(&Game::playerJoinParty, player->getID(), targetId);
+	addGameTask(0xA4, &Game::playerJoinParty, player->getID(), targetId);
 }
 
 void ProtocolGame::parseRevokePartyInvite(NetworkMessage &msg)
 {
 	uint32_t targetId = msg.get<uint32_t>();
-	addGameTask(&Game::playerRevokePartyInvitation, player->getID(), targetId);
+	addGameTask(0xA5, &Game::playerRevokePartyInvitation, player->getID(), targetId);
 }
 
 void ProtocolGame::parsePassPartyLeadership(NetworkMessage &msg)
 {
 	uint32_t targetId = msg.get<uint32_t>();
-	addGameTask(&Game::playerPassPartyLeadership, player->getID(), targetId);
+	addGameTask(0xA6, &Game::playerPassPartyLeadership, player->getID(), targetId);
 }
 
 void ProtocolGame::parseEnableSharedPartyExperience(NetworkMessage &msg)
 {
 	bool sharedExpActive = msg.getByte() == 1;
-	addGameTask(&Game::playerEnableSharedPartyExperience, player->getID(), sharedExpActive);
+	addGameTask(0xA8, &Game::playerEnableSharedPartyExperience, player->getID(), sharedExpActive);
 }
 
 void ProtocolGame::parseQuestLine(NetworkMessage &msg)
 {
 	uint16_t questId = msg.get<uint16_t>();
-	addGameTask(&Game::playerShowQuestLine, player->getID(), questId);
+	addGameTask(0xF1, &Game::playerShowQuestLine, player->getID(), questId);
 }
 
 void ProtocolGame::parseMarketLeave()
 {
-	addGameTask(&Game::playerLeaveMarket, player->getID());
+	addGameTask(0xF4, &Game::playerLeaveMarket, player->getID());
 }
 
 void ProtocolGame::parseMarketBrowse(NetworkMessage &msg)
@@ -2472,23 +2606,23 @@ void ProtocolGame::parseMarketBrowse(NetworkMessage &msg)
 
 	if (browseId == MARKETREQUEST_OWN_OFFERS)
 	{
-		addGameTask(&Game::playerBrowseMarketOwnOffers, player->getID());
+		addGameTask(0xF5, &Game::playerBrowseMarketOwnOffers, player->getID());
 	}
 	else if (browseId == MARKETREQUEST_OWN_HISTORY)
 	{
-		addGameTask(&Game::playerBrowseMarketOwnHistory, player->getID());
+		addGameTask(0xF5, &Game::playerBrowseMarketOwnHistory, player->getID());
 	}
 	else
 	{
     player->sendMarketEnter(player->getLastDepotId());
-		addGameTask(&Game::playerBrowseMarket, player->getID(), browseId);
+		addGameTask(0xF5, &Game::playerBrowseMarket, player->getID(), browseId);
 	}
 }
 
 void ProtocolGame::parseStoreOpen(NetworkMessage &msg)
 {
 	uint8_t serviceType = msg.getByte();
-	addGameTaskTimed(600, &Game::playerStoreOpen, player->getID(), serviceType);
+	addGameTaskTimed(0xFA, 600, &Game::playerStoreOpen, player->getID(), serviceType);
 }
 
 void ProtocolGame::parseStoreRequestOffers(NetworkMessage &message)
@@ -2501,7 +2635,7 @@ void ProtocolGame::parseStoreRequestOffers(NetworkMessage &message)
 
 	if (index >= 0)
 	{
-		addGameTaskTimed(350, &Game::playerShowStoreCategoryOffers, player->getID(),
+		addGameTaskTimed(0xFB, 350, &Game::playerShowStoreCategoryOffers, player->getID(),
 						 g_game.gameStore.getCategoryOffers().at(index));
 	}
 	else
@@ -2520,7 +2654,7 @@ void ProtocolGame::parseStoreBuyOffer(NetworkMessage &message)
 	{
 		additionalInfo = message.getString();
 	}
-	addGameTaskTimed(350, &Game::playerBuyStoreOffer, player->getID(), offerId, productType, additionalInfo);
+	addGameTaskTimed(0xFC, 350, &Game::playerBuyStoreOffer, player->getID(), offerId, productType, additionalInfo);
 }
 
 void ProtocolGame::parseStoreOpenTransactionHistory(NetworkMessage &msg)
@@ -2531,13 +2665,13 @@ void ProtocolGame::parseStoreOpenTransactionHistory(NetworkMessage &msg)
 		GameStore::HISTORY_ENTRIES_PER_PAGE = entriesPerPage;
 	}
 
-	addGameTaskTimed(2000, &Game::playerStoreTransactionHistory, player->getID(), 1);
+	addGameTaskTimed(0xFD, 2000, &Game::playerStoreTransactionHistory, player->getID(), 1);
 }
 
 void ProtocolGame::parseStoreRequestTransactionHistory(NetworkMessage &msg)
 {
 	uint32_t pageNumber = msg.get<uint32_t>();
-	addGameTaskTimed(2000, &Game::playerStoreTransactionHistory, player->getID(), pageNumber);
+	addGameTaskTimed(0xFE, 2000, &Game::playerStoreTransactionHistory, player->getID(), pageNumber);
 }
 
 void ProtocolGame::parseCoinTransfer(NetworkMessage &msg)
@@ -2547,7 +2681,7 @@ void ProtocolGame::parseCoinTransfer(NetworkMessage &msg)
 
 	if (amount > 0)
 	{
-		addGameTaskTimed(350, &Game::playerCoinTransfer, player->getID(), receiverName, amount);
+		addGameTaskTimed(0xEF, 350, &Game::playerCoinTransfer, player->getID(), receiverName, amount);
 	}
 
 	updateCoinBalance();
@@ -2562,7 +2696,7 @@ void ProtocolGame::parseMarketCreateOffer(NetworkMessage &msg)
 	bool anonymous = (msg.getByte() != 0);
 	if (amount > 0 && price > 0)
 	{
-		addGameTask(&Game::playerCreateMarketOffer, player->getID(), type, spriteId, amount, price, anonymous);
+		addGameTask(0xF6, &Game::playerCreateMarketOffer, player->getID(), type, spriteId, amount, price, anonymous);
 	}
 }
 
@@ -2572,7 +2706,7 @@ void ProtocolGame::parseMarketCancelOffer(NetworkMessage &msg)
 	uint16_t counter = msg.get<uint16_t>();
 	if (counter > 0)
 	{
-		addGameTask(&Game::playerCancelMarketOffer, player->getID(), timestamp, counter);
+		addGameTask(0xF7, &Game::playerCancelMarketOffer, player->getID(), timestamp, counter);
 	}
 
 	updateCoinBalance();
@@ -2585,7 +2719,7 @@ void ProtocolGame::parseMarketAcceptOffer(NetworkMessage &msg)
 	uint16_t amount = msg.get<uint16_t>();
 	if (amount > 0 && counter > 0)
 	{
-		addGameTask(&Game::playerAcceptMarketOffer, player->getID(), timestamp, counter, amount);
+		addGameTask(0xF8, &Game::playerAcceptMarketOffer, player->getID(), timestamp, counter, amount);
 	}
 
 	updateCoinBalance();
@@ -2596,20 +2730,20 @@ void ProtocolGame::parseModalWindowAnswer(NetworkMessage &msg)
 	uint32_t id = msg.get<uint32_t>();
 	uint8_t button = msg.getByte();
 	uint8_t choice = msg.getByte();
-	addGameTask(&Game::playerAnswerModalWindow, player->getID(), id, button, choice);
+	addGameTask(0xF9, &Game::playerAnswerModalWindow, player->getID(), id, button, choice);
 }
 
 void ProtocolGame::parseBrowseField(NetworkMessage &msg)
 {
 	const Position &pos = msg.getPosition();
-	addGameTask(&Game::playerBrowseField, player->getID(), pos);
+	addGameTask(0xCB, &Game::playerBrowseField, player->getID(), pos);
 }
 
 void ProtocolGame::parseSeekInContainer(NetworkMessage &msg)
 {
 	uint8_t containerId = msg.getByte();
 	uint16_t index = msg.get<uint16_t>();
-	addGameTask(&Game::playerSeekInContainer, player->getID(), containerId, index);
+	addGameTask(0xCC, &Game::playerSeekInContainer, player->getID(), containerId, index);
 }
 
 // Send methods
@@ -6626,7 +6760,7 @@ void ProtocolGame::parseExtendedOpcode(NetworkMessage &msg)
 	const std::string &buffer = msg.getString();
 
 	// process additional opcodes via lua script event
-	addGameTask(&Game::parsePlayerExtendedOpcode, player->getID(), opcode, buffer);
+	addGameTask(0x32, &Game::parsePlayerExtendedOpcode, player->getID(), opcode, buffer);
 }
 
 void ProtocolGame::sendItemsPrice()
@@ -6704,28 +6838,28 @@ void ProtocolGame::parseStashWithdraw(NetworkMessage &msg)
 			uint16_t spriteId = msg.get<uint16_t>();
 			uint8_t stackpos = msg.getByte();
 			uint32_t count = msg.getByte();
-			addGameTask(&Game::playerStowItem, player, pos, spriteId, stackpos, count, false);
+			addGameTask(0x28, &Game::playerStowItem, player, pos, spriteId, stackpos, count, false);
 			break;
 		}
 		case SUPPLY_STASH_ACTION_STOW_CONTAINER: {
 			Position pos = msg.getPosition();
 			uint16_t spriteId = msg.get<uint16_t>();
 			uint8_t stackpos = msg.getByte();
-			addGameTask(&Game::playerStowItem, player, pos, spriteId, stackpos, 0, false);
+			addGameTask(0x28, &Game::playerStowItem, player, pos, spriteId, stackpos, 0, false);
 			break;
 		}
 		case SUPPLY_STASH_ACTION_STOW_STACK: {
 			Position pos = msg.getPosition();
 			uint16_t spriteId = msg.get<uint16_t>();
 			uint8_t stackpos = msg.getByte();
-			addGameTask(&Game::playerStowItem, player, pos, spriteId, stackpos, 0, true);
+			addGameTask(0x28, &Game::playerStowItem, player, pos, spriteId, stackpos, 0, true);
 			break;
 		}
 		case SUPPLY_STASH_ACTION_WITHDRAW: {
 			uint16_t spriteId = msg.get<uint16_t>();
 			uint32_t count = msg.get<uint32_t>();
 			uint8_t stackpos = msg.getByte();
-			addGameTask(&Game::playerStashWithdraw, player, spriteId, count, stackpos);
+			addGameTask(0x28, &Game::playerStashWithdraw, player, spriteId, count, stackpos);
 			break;
 		}
 		default:
@@ -40,11 +40,15 @@ class Tile;
 class Connection;
 class Quest;
 class ProtocolGame;
+struct DeferredPlayerLoad;
 using ProtocolGame_ptr = std::shared_ptr<ProtocolGame>;
 
 extern ConfigManager g_config;
 extern Game g_game;
 
+// times a login reads the character again because it was saved offline meanwhile, before it gives up
+static constexpr uint32_t LOGIN_MAX_RELOADS = 3;
+
 struct TextMessage
 {
 	MessageClasses type = MESSAGE_STATUS;
@@ -77,6 +81,11 @@ public:
 	{
 		use_checksum = true
 	};
+	// bits of the login's gamemaster byte, unmodified clients only send 0 or 1
+	enum
+	{
+		CLIENT_FLAG_COMPRESSION = 1 << 7
+	};
 	static const char *protocol_name()
 	{
 		return "gameworld protocol";
@@ -103,6 +112,16 @@ private:
 		return std::static_pointer_cast<ProtocolGame>(shared_from_this());
 	}
 	void connect(uint32_t playerId, OperatingSystem_t operatingSystem);
+	// the steps of a login after the first, alternating between a login thread and the dispatcher
+	void preloadLogin(const std::string &name, uint32_t accountId, OperatingSystem_t operatingSystem);
+	void admitLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, const std::string &error, const std::string &banMessage);
+	void loadLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, uint32_t loadWrites, uint32_t reloads);
+	void finishLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, uint32_t loadWrites, uint32_t reloads, bool loaded, const DeferredPlayerLoad &deferred);
+	// queues loadLogin, a job the login queue drops finishes the login as failed
+	void queueLoadLogin(Player *loginPlayer, OperatingSystem_t operatingSystem, uint32_t reloads);
+	void abortLogin(Player *loginPlayer, const std::string &message = "");
+	bool isAccountOnline(const Player *loginPlayer) const;
+	void sendWaitingList(const std::string &message, uint8_t retryTime);
 	void disconnectClient(const std::string &message) const;
 	void writeToOutputBuffer(const NetworkMessage &msg);
 
@@ -449,17 +468,21 @@ private:
 
 	friend class Player;
 
-	// Helpers so we don't need to bind every time
+	// Helpers so we don't need to bind every time, the category is the opcode of the packet the task comes from
 	template <typename Callable, typename... Args>
-	void addGameTask(Callable function, Args &&... args)
+	void addGameTask(uint16_t category, Callable function, Args &&... args)
 	{
-		g_dispatcher.addTask(createTask(std::bind(function, &g_game, std::forward<Args>(args)...)));
+		Task* task = createInlineTask(std::bind(function, &g_game, std::forward<Args>(args)...));
+		task->setCategory(category);
+		g_dispatcher.addTask(task);
 	}
 
 	template <typename Callable, typename... Args>
-	void addGameTaskTimed(uint32_t delay, Callable function, Args &&... args)
+	void addGameTaskTimed(uint16_t category, uint32_t delay, Callable function, Args &&... args)
 	{
-		g_dispatcher.addTask(createTask(delay, std::bind(function, &g_game, std::forward<Args>(args)...)));
+		Task* task = createInlineTask(delay, std::bind(function, &g_game, std::forward<Args>(args)...));
+		task->setCategory(category);
+		g_dispatcher.addTask(task);
 	}
 
 	std::unordered_set<uint32_t> knownCreatureSet;
@@ -25,11 +25,13 @@
 #include "configmanager.h"
 #include "game.h"
 #include "outputmessage.h"
+#include "taskprofiler.h"
 
 extern ConfigManager g_config;
 extern Game g_game;
 
 std::map<uint32_t, int64_t> ProtocolStatus::ipConnectMap;
+std::mutex ProtocolStatus::ipConnectMapLock;
 const uint64_t ProtocolStatus::start = OTSYS_TIME();
 
 enum RequestedInfo_t : uint16_t {
@@ -41,23 +43,31 @@ enum RequestedInfo_t : uint16_t {
 	REQUEST_EXT_PLAYERS_INFO = 1 << 5,
 	REQUEST_PLAYER_STATUS_INFO = 1 << 6,
 	REQUEST_SERVER_SOFTWARE_INFO = 1 << 7,
+	REQUEST_DISPATCHER_INFO = 1 << 8,
 };
 
+// categories sent for REQUEST_DISPATCHER_INFO, the busiest ones first
+static constexpr size_t STATUS_DISPATCHER_CATEGORIES = 64;
+
 void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 {
 	uint32_t ip = getIP();
-	if (ip != 0x0100007F) {
-		std::string ipStr = convertIPToString(ip);
-		if (ipStr != g_config.getString(ConfigManager::IP)) {
-			std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
-			if (it != ipConnectMap.end() && (OTSYS_TIME() < (it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT)))) {
-				disconnect();
-				return;
+	{
+		// status requests are parsed on any of the network threads
+		std::lock_guard<std::mutex> lockClass(ipConnectMapLock);
+		if (ip != 0x0100007F) {
+			std::string ipStr = convertIPToString(ip);
+			if (ipStr != g_config.getString(ConfigManager::IP)) {
+				std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
+				if (it != ipConnectMap.end() && (OTSYS_TIME() < (it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT)))) {
+					disconnect();
+					return;
+				}
 			}
 		}
-	}
 
-	ipConnectMap[ip] = OTSYS_TIME();
+		ipConnectMap[ip] = OTSYS_TIME();
+	}
 
 	switch (msg.getByte()) {
 		//XML info protocol
@@ -241,6 +251,27 @@ void ProtocolStatus::sendInfo(uint16_t requestedInfo, const std::string& charact
 		output->addString(STATUS_SERVER_VERSION);
 		output->addString(g_config.getString(ConfigManager::CLIENT_VERSION_STR));
 	}
+
+	if (requestedInfo & REQUEST_DISPATCHER_INFO) {
+		output->addByte(0x24); // dispatcher task timings since startup, in microseconds
+		std::vector<TaskCategoryReport> report = TaskProfiler::getInstance().getReport();
+		if (report.size() > STATUS_DISPATCHER_CATEGORIES) {
+			report.resize(STATUS_DISPATCHER_CATEGORIES);
+		}
+
+		output->add<uint16_t>(report.size());
+		for (const TaskCategoryReport& category : report) {
+			output->addString(category.name);
+			output->add<uint64_t>(category.execution.count);
+			output->add<uint64_t>(category.expired);
+			for (const TaskHistogramData* histogram : {&category.execution, &category.wait}) {
+				output->add<uint64_t>(histogram->total);
+				output->add<uint32_t>(histogram->percentile(0.5));
+				output->add<uint32_t>(histogram->percentile(0.99));
+				output->add<uint32_t>(histogram->max);
+			}
+		}
+	}
 	send(output);
 	disconnect();
 }
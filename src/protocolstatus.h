@@ -45,6 +45,7 @@ class ProtocolStatus final : public Protocol
 
 	private:
 		static std::map<uint32_t, int64_t> ipConnectMap;
+		static std::mutex ipConnectMapLock;
 };
 
 #endif
@@ -33,8 +33,11 @@ void RSA2::decrypt(char* msg) const
 {
 	try
 	{
+		// logins are decrypted on every network thread and the pool is not thread safe
+		thread_local CryptoPP::AutoSeededRandomPool threadPrng;
+
 		CryptoPP::Integer m{reinterpret_cast<uint8_t *>(msg), 128};
-		auto c = pk.CalculateInverse(prng, m);
+		auto c = pk.CalculateInverse(threadPrng, m);
 		c.Encode(reinterpret_cast<uint8_t *>(msg), 128);
 	}
 	catch (const CryptoPP::Exception &e)
@@ -21,40 +21,286 @@
 
 #include "scheduler.h"
 
+namespace {
+
+int64_t getCurrentTick()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point getTickTimePoint(int64_t tick)
+{
+	return std::chrono::system_clock::time_point(std::chrono::milliseconds(tick));
+}
+
+uint32_t countTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+}
+
+TimingWheel::TimingWheel() : currentTick(getCurrentTick()) {}
+
+void TimingWheel::add(SchedulerTask* task)
+{
+	// tasks that are already due go into the slot of the next processed tick
+	int64_t tick = std::max<int64_t>(task->getCycleTicks(), currentTick);
+	uint64_t delta = static_cast<uint64_t>(tick - currentTick);
+
+	uint32_t level = 0;
+	while (level + 1 < WHEEL_LEVELS && delta >= (UINT64_C(1) << (WHEEL_BITS * (level + 1)))) {
+		++level;
+	}
+
+	// delays beyond the top level are parked in its farthest slot and re-added from there
+	if (delta >= (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS))) {
+		tick = currentTick + static_cast<int64_t>((UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1);
+	}
+
+	link(task, level, static_cast<uint32_t>(tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+	++size;
+}
+
+void TimingWheel::link(SchedulerTask* task, uint32_t level, uint32_t slot)
+{
+	task->wheelLevel = static_cast<uint8_t>(level);
+	task->wheelSlot = static_cast<uint8_t>(slot);
+	task->wheelNext = nullptr;
+	task->wheelPrev = tails[level][slot];
+	if (task->wheelPrev) {
+		task->wheelPrev->wheelNext = task;
+	} else {
+		heads[level][slot] = task;
+		occupied[level][slot / 64] |= UINT64_C(1) << (slot % 64);
+	}
+	tails[level][slot] = task;
+}
+
+void TimingWheel::remove(SchedulerTask* task)
+{
+	uint32_t level = task->wheelLevel;
+	uint32_t slot = task->wheelSlot;
+	if (task->wheelPrev) {
+		task->wheelPrev->wheelNext = task->wheelNext;
+	} else {
+		heads[level][slot] = task->wheelNext;
+	}
+
+	if (task->wheelNext) {
+		task->wheelNext->wheelPrev = task->wheelPrev;
+	} else {
+		tails[level][slot] = task->wheelPrev;
+	}
+
+	if (!heads[level][slot]) {
+		occupied[level][slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+	}
+
+	task->wheelPrev = nullptr;
+	task->wheelNext = nullptr;
+	--size;
+}
+
+void TimingWheel::cascade(uint32_t level, uint32_t slot)
+{
+	SchedulerTask* task = heads[level][slot];
+	heads[level][slot] = nullptr;
+	tails[level][slot] = nullptr;
+	occupied[level][slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+
+	while (task) {
+		SchedulerTask* next = task->wheelNext;
+		--size;
+		add(task);
+		task = next;
+	}
+}
+
+int32_t TimingWheel::findOccupiedSlot(uint32_t level, uint32_t from) const
+{
+	for (uint32_t word = from / 64; word < WHEEL_SLOTS / 64; ++word) {
+		uint64_t bits = occupied[level][word];
+		if (word == from / 64) {
+			bits &= ~UINT64_C(0) << (from % 64);
+		}
+
+		if (bits != 0) {
+			return static_cast<int32_t>(word * 64 + countTrailingZeros(bits));
+		}
+	}
+	return -1;
+}
+
+void TimingWheel::advance(int64_t now, std::vector<SchedulerTask*>& expired)
+{
+	if (size == 0) {
+		currentTick = std::max<int64_t>(currentTick, now + 1);
+		return;
+	}
+
+	while (currentTick <= now) {
+		uint32_t index = static_cast<uint32_t>(currentTick) & WHEEL_MASK;
+		if (index == 0) {
+			// a lower level wrapped around, pull the next slot of each level above it down
+			for (uint32_t level = 1; level < WHEEL_LEVELS; ++level) {
+				uint32_t slot = static_cast<uint32_t>(currentTick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+				cascade(level, slot);
+				if (slot != 0) {
+					break;
+				}
+			}
+		}
+
+		SchedulerTask* task = heads[0][index];
+		if (task) {
+			heads[0][index] = nullptr;
+			tails[0][index] = nullptr;
+			occupied[0][index / 64] &= ~(UINT64_C(1) << (index % 64));
+
+			while (task) {
+				SchedulerTask* next = task->wheelNext;
+				task->wheelPrev = nullptr;
+				task->wheelNext = nullptr;
+				--size;
+				if (task->getCycleTicks() > currentTick) {
+					// only delays parked beyond the top level end up here early
+					add(task);
+				} else {
+					expired.push_back(task);
+				}
+				task = next;
+			}
+		}
+
+		// skip the empty slots up to the next occupied one or the next wrap around
+		int32_t nextSlot = findOccupiedSlot(0, index + 1 < WHEEL_SLOTS ? index + 1 : WHEEL_SLOTS - 1);
+		if (nextSlot <= static_cast<int32_t>(index)) {
+			nextSlot = WHEEL_SLOTS;
+		}
+		currentTick = std::min<int64_t>(currentTick + (nextSlot - index), now + 1);
+	}
+}
+
+int64_t TimingWheel::getNextExpiration() const
+{
+	if (size == 0) {
+		return std::numeric_limits<int64_t>::max();
+	}
+
+	uint32_t index = static_cast<uint32_t>(currentTick) & WHEEL_MASK;
+	int32_t slot = findOccupiedSlot(0, index);
+	if (slot >= 0) {
+		return currentTick + (slot - index);
+	}
+
+	if (index == 0) {
+		// the cascade of the current tick is still pending
+		return currentTick;
+	}
+	return currentTick - index + WHEEL_SLOTS;
+}
+
+void TimingWheel::clear()
+{
+	for (uint32_t level = 0; level < WHEEL_LEVELS; ++level) {
+		for (uint32_t slot = 0; slot < WHEEL_SLOTS; ++slot) {
+			SchedulerTask* task = heads[level][slot];
+			while (task) {
+				SchedulerTask* next = task->wheelNext;
+				delete task;
+				task = next;
+			}
+			heads[level][slot] = nullptr;
+			tails[level][slot] = nullptr;
+		}
+		occupied[level].fill(0);
+	}
+	size = 0;
+}
+
+void TaskHeap::add(SchedulerTask* task)
+{
+	eventList.push(task);
+}
+
+void TaskHeap::remove(SchedulerTask* task)
+{
+	task->cancelled = true;
+}
+
+void TaskHeap::advance(int64_t now, std::vector<SchedulerTask*>& expired)
+{
+	while (!eventList.empty() && eventList.top()->getCycleTicks() <= now) {
+		SchedulerTask* task = eventList.top();
+		eventList.pop();
+
+		// check if the event was stopped
+		if (task->cancelled) {
+			delete task;
+			continue;
+		}
+		expired.push_back(task);
+	}
+}
+
+int64_t TaskHeap::getNextExpiration() const
+{
+	if (eventList.empty()) {
+		return std::numeric_limits<int64_t>::max();
+	}
+	return eventList.top()->getCycleTicks();
+}
+
+void TaskHeap::clear()
+{
+	while (!eventList.empty()) {
+		delete eventList.top();
+		eventList.pop();
+	}
+}
+
 void Scheduler::threadMain()
 {
+	std::vector<SchedulerTask*> expiredTasks;
 	std::unique_lock<std::mutex> eventLockUnique(eventLock, std::defer_lock);
 	while (getState() != THREAD_STATE_TERMINATED) {
-		std::cv_status ret = std::cv_status::no_timeout;
-
 		eventLockUnique.lock();
-		if (eventList.empty()) {
+
+		wakeupTick = useTimingWheel ? timingWheel.getNextExpiration() : taskHeap.getNextExpiration();
+		if (wakeupTick == std::numeric_limits<int64_t>::max()) {
 			eventSignal.wait(eventLockUnique);
 		} else {
-			ret = eventSignal.wait_until(eventLockUnique, eventList.top()->getCycle());
+			eventSignal.wait_until(eventLockUnique, getTickTimePoint(wakeupTick));
 		}
 
 		// the mutex is locked again now...
-		if (ret == std::cv_status::timeout && !eventList.empty()) {
-			// ok we had a timeout, so there has to be an event we have to execute...
-			SchedulerTask* task = eventList.top();
-			eventList.pop();
+		wakeupTick = std::numeric_limits<int64_t>::max();
+		if (useTimingWheel) {
+			timingWheel.advance(getCurrentTick(), expiredTasks);
+		} else {
+			taskHeap.advance(getCurrentTick(), expiredTasks);
+		}
 
-			// check if the event was stopped
+		for (SchedulerTask* task : expiredTasks) {
 			auto it = eventIds.find(task->getEventId());
-			if (it == eventIds.end()) {
-				eventLockUnique.unlock();
-				delete task;
-				continue;
+			if (it != eventIds.end() && it->second == task) {
+				eventIds.erase(it);
 			}
-			eventIds.erase(it);
-			eventLockUnique.unlock();
+		}
+		eventLockUnique.unlock();
 
+		for (SchedulerTask* task : expiredTasks) {
 			task->setDontExpire();
 			g_dispatcher.addTask(task, true);
-		} else {
-			eventLockUnique.unlock();
 		}
+		expiredTasks.clear();
 	}
 }
 
@@ -75,14 +321,17 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 		}
 
 		// insert the event id in the list of active events
-		eventIds.insert(task->getEventId());
+		eventIds[task->getEventId()] = task;
 
 		// add the event to the queue
-		eventList.push(task);
+		if (useTimingWheel) {
+			timingWheel.add(task);
+		} else {
+			taskHeap.add(task);
+		}
 
-		// if the list was empty or this event is the top in the list
-		// we have to signal it
-		do_signal = (task == eventList.top());
+		// if the scheduler sleeps past this event we have to signal it
+		do_signal = task->getCycleTicks() < wakeupTick;
 	} else {
 		eventLock.unlock();
 		delete task;
@@ -104,7 +353,7 @@ bool Scheduler::stopEvent(uint32_t eventid)
 		return false;
 	}
 
-	std::lock_guard<std::mutex> lockClass(eventLock);
+	std::unique_lock<std::mutex> eventLockUnique(eventLock);
 
 	// search the event id..
 	auto it = eventIds.find(eventid);
@@ -112,27 +361,63 @@ bool Scheduler::stopEvent(uint32_t eventid)
 		return false;
 	}
 
+	SchedulerTask* task = it->second;
 	eventIds.erase(it);
+
+	if (!useTimingWheel) {
+		taskHeap.remove(task);
+		return true;
+	}
+
+	timingWheel.remove(task);
+	eventLockUnique.unlock();
+
+	delete task;
 	return true;
 }
 
+void Scheduler::setTimingWheel(bool enabled)
+{
+	std::lock_guard<std::mutex> lockClass(eventLock);
+	if (useTimingWheel == enabled) {
+		return;
+	}
+
+	if (enabled) {
+		// draining the heap drops the cancelled tasks and hands back the live ones
+		std::vector<SchedulerTask*> tasks;
+		taskHeap.advance(std::numeric_limits<int64_t>::max(), tasks);
+		for (SchedulerTask* task : tasks) {
+			timingWheel.add(task);
+		}
+	} else {
+		for (const auto& it : eventIds) {
+			timingWheel.remove(it.second);
+			taskHeap.add(it.second);
+		}
+	}
+
+	useTimingWheel = enabled;
+	eventSignal.notify_one();
+}
+
 void Scheduler::shutdown()
 {
 	setState(THREAD_STATE_TERMINATED);
 	eventLock.lock();
 
 	//this list should already be empty
-	while (!eventList.empty()) {
-		delete eventList.top();
-		eventList.pop();
-	}
+	timingWheel.clear();
+	taskHeap.clear();
 
 	eventIds.clear();
 	eventLock.unlock();
 	eventSignal.notify_one();
 }
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f)
+SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f, uint16_t category /*= TASK_CATEGORY_SCHEDULER*/)
 {
-	return new SchedulerTask(delay, std::move(f));
+	SchedulerTask* task = new SchedulerTask(delay, std::move(f));
+	task->setCategory(category);
+	return task;
 }
@@ -21,8 +21,10 @@
 #define FS_SCHEDULER_H_2905B3D5EAB34B4BA8830167262D2DC1
 
 #include "tasks.h"
-#include <unordered_set>
+#include <array>
+#include <limits>
 #include <queue>
+#include <unordered_map>
 
 #include "thread_holder_base.h"
 
@@ -41,16 +43,30 @@ class SchedulerTask : public Task
 		std::chrono::system_clock::time_point getCycle() const {
 			return expiration;
 		}
+		int64_t getCycleTicks() const {
+			return std::chrono::duration_cast<std::chrono::milliseconds>(expiration.time_since_epoch()).count();
+		}
 
 	private:
 		SchedulerTask(uint32_t delay, std::function<void (void)>&& f) : Task(delay, std::move(f)) {}
 
 		uint32_t eventId = 0;
 
-		friend SchedulerTask* createSchedulerTask(uint32_t, std::function<void (void)>);
+		// timing wheel bookkeeping, a task is linked into at most one slot
+		SchedulerTask* wheelPrev = nullptr;
+		SchedulerTask* wheelNext = nullptr;
+		uint8_t wheelLevel = 0;
+		uint8_t wheelSlot = 0;
+
+		// task heap bookkeeping, cancelled tasks stay in the heap until popped
+		bool cancelled = false;
+
+		friend SchedulerTask* createSchedulerTask(uint32_t, std::function<void (void)>, uint16_t);
+		friend class TimingWheel;
+		friend class TaskHeap;
 };
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f);
+SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f, uint16_t category = TASK_CATEGORY_SCHEDULER);
 
 struct TaskComparator {
 	bool operator()(const SchedulerTask* lhs, const SchedulerTask* rhs) const {
@@ -58,12 +74,86 @@ struct TaskComparator {
 	}
 };
 
+/*
+ * Hierarchical timing wheel with millisecond ticks.
+ * Four levels of 256 slots cover the whole uint32_t delay range, insertion and
+ * removal are O(1) and tasks are kept in intrusive lists so no memory is
+ * allocated after construction.
+ */
+class TimingWheel
+{
+	public:
+		static constexpr uint32_t WHEEL_LEVELS = 4;
+		static constexpr uint32_t WHEEL_BITS = 8;
+		static constexpr uint32_t WHEEL_SLOTS = 1 << WHEEL_BITS;
+		static constexpr uint32_t WHEEL_MASK = WHEEL_SLOTS - 1;
+
+		TimingWheel();
+
+		void add(SchedulerTask* task);
+		void remove(SchedulerTask* task);
+
+		// moves every task due at or before 'now' into 'expired', ordered by expiration
+		void advance(int64_t now, std::vector<SchedulerTask*>& expired);
+		// earliest tick at which advance has to be called again
+		int64_t getNextExpiration() const;
+		void clear();
+
+		bool empty() const {
+			return size == 0;
+		}
+		size_t getSize() const {
+			return size;
+		}
+
+	private:
+		void link(SchedulerTask* task, uint32_t level, uint32_t slot);
+		void cascade(uint32_t level, uint32_t slot);
+		int32_t findOccupiedSlot(uint32_t level, uint32_t from) const;
+
+		std::array<std::array<SchedulerTask*, WHEEL_SLOTS>, WHEEL_LEVELS> heads {};
+		std::array<std::array<SchedulerTask*, WHEEL_SLOTS>, WHEEL_LEVELS> tails {};
+		std::array<std::array<uint64_t, WHEEL_SLOTS / 64>, WHEEL_LEVELS> occupied {};
+
+		// next tick that has not been processed yet
+		int64_t currentTick;
+		size_t size = 0;
+};
+
+/*
+ * Binary heap ordered by expiration, the scheduler backend used before the
+ * timing wheel. Cancelled tasks are only flagged and dropped once they reach the top.
+ */
+class TaskHeap
+{
+	public:
+		void add(SchedulerTask* task);
+		void remove(SchedulerTask* task);
+
+		void advance(int64_t now, std::vector<SchedulerTask*>& expired);
+		int64_t getNextExpiration() const;
+		void clear();
+
+		bool empty() const {
+			return eventList.empty();
+		}
+		size_t getSize() const {
+			return eventList.size();
+		}
+
+	private:
+		std::priority_queue<SchedulerTask*, std::deque<SchedulerTask*>, TaskComparator> eventList;
+};
+
 class Scheduler : public ThreadHolder<Scheduler>
 {
 	public:
 		uint32_t addEvent(SchedulerTask* task);
 		bool stopEvent(uint32_t eventId);
 
+		// switches the event queue backend, pending events are carried over
+		void setTimingWheel(bool enabled);
+
 		void shutdown();
 
 		void threadMain();
@@ -74,8 +164,14 @@ class Scheduler : public ThreadHolder<Scheduler>
 		std::condition_variable eventSignal;
 
 		uint32_t lastEventId {0};
-		std::priority_queue<SchedulerTask*, std::deque<SchedulerTask*>, TaskComparator> eventList;
-		std::unordered_set<uint32_t> eventIds;
+		std::unordered_map<uint32_t, SchedulerTask*> eventIds;
+
+		TimingWheel timingWheel;
+		TaskHeap taskHeap;
+		bool useTimingWheel = true;
+
+		// tick the scheduler thread is currently sleeping until
+		int64_t wakeupTick = std::numeric_limits<int64_t>::max();
 };
 
 extern Scheduler g_scheduler;
@@ -38,11 +38,31 @@ void ServiceManager::die()
 	io_service.stop();
 }
 
-void ServiceManager::run()
+void ServiceManager::run(int32_t threadCount)
 {
 	assert(!running);
 	running = true;
+
+	if (threadCount <= 0) {
+		threadCount = std::max<int32_t>(1, std::thread::hardware_concurrency());
+	}
+	SPDLOG_INFO("Running {} network threads", threadCount);
+
+	// connections and service ports keep their handlers on a strand,
+	// so any of the threads can pick up the next ready socket
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (int32_t i = 1; i < threadCount; ++i) {
+		threads.emplace_back([this]() {
+			io_service.run();
+		});
+	}
+
 	io_service.run();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
 }
 
 void ServiceManager::stop()
@@ -99,7 +119,8 @@ void ServicePort::accept()
 	}
 
 	auto connection = ConnectionManager::getInstance().createConnection(io_service, shared_from_this());
-	acceptor->async_accept(connection->getSocket(), std::bind(&ServicePort::onAccept, shared_from_this(), connection, std::placeholders::_1));
+	acceptor->async_accept(connection->getSocket(), boost::asio::bind_executor(strand,
+	                       std::bind(&ServicePort::onAccept, shared_from_this(), connection, std::placeholders::_1)));
 }
 
 void ServicePort::onAccept(Connection_ptr connection, const boost::system::error_code& error)
@@ -109,6 +130,7 @@ void ServicePort::onAccept(Connection_ptr connection, const boost::system::error
 			return;
 		}
 
+		connection->resolveIP();
 		auto remote_ip = connection->getIP();
 		if (remote_ip != 0 && g_bans.acceptConnection(remote_ip)) {
 			Service_ptr service = services.front();
@@ -149,13 +171,14 @@ Protocol_ptr ServicePort::make_protocol(bool checksummed, NetworkMessage& msg, c
 
 void ServicePort::onStopServer()
 {
-	close();
+	boost::asio::dispatch(strand, std::bind(&ServicePort::close, shared_from_this()));
 }
 
 void ServicePort::openAcceptor(std::weak_ptr<ServicePort> weak_service, uint16_t port)
 {
+	//dispatcher thread
 	if (auto service = weak_service.lock()) {
-		service->open(port);
+		boost::asio::post(service->strand, std::bind(&ServicePort::open, service, port));
 	}
 }
 
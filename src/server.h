@@ -62,7 +62,7 @@ class Service final : public ServiceBase
 class ServicePort : public std::enable_shared_from_this<ServicePort>
 {
 	public:
-		explicit ServicePort(boost::asio::io_service& init_io_service) : io_service(init_io_service) {}
+		explicit ServicePort(boost::asio::io_service& init_io_service) : io_service(init_io_service), strand(init_io_service) {}
 		~ServicePort();
 
 		// non-copyable
@@ -85,6 +85,8 @@ class ServicePort : public std::enable_shared_from_this<ServicePort>
 		void accept();
 
 		boost::asio::io_service& io_service;
+		// serializes the acceptor handlers between the network threads
+		boost::asio::io_service::strand strand;
 		std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
 		std::vector<Service_ptr> services;
 
@@ -102,7 +104,8 @@ class ServiceManager
 		ServiceManager(const ServiceManager&) = delete;
 		ServiceManager& operator=(const ServiceManager&) = delete;
 
-		void run();
+		// runs the io_service on threadCount network threads (one per CPU core if 0) until stopped
+		void run(int32_t threadCount);
 		void stop();
 
 		template <typename ProtocolType>
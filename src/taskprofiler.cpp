@@ -0,0 +1,255 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "taskprofiler.h"
+#include "scheduler.h"
+
+extern Scheduler g_scheduler;
+
+namespace {
+
+// number of categories written to the log by each periodic report
+constexpr size_t TASK_PROFILER_LOG_LINES = 15;
+
+size_t getBucket(uint64_t us)
+{
+	if (us == 0) {
+		return 0;
+	}
+
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, us);
+	size_t bucket = index + 1;
+#else
+	size_t bucket = 64 - __builtin_clzll(us);
+#endif
+	return std::min<size_t>(bucket, TaskHistogramData::BUCKETS - 1);
+}
+
+uint64_t toMicroseconds(std::chrono::steady_clock::duration duration)
+{
+	return std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+void increment(std::atomic<uint64_t>& counter, uint64_t value)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void raise(std::atomic<uint64_t>& counter, uint64_t value)
+{
+	if (value > counter.load(std::memory_order_relaxed)) {
+		counter.store(value, std::memory_order_relaxed);
+	}
+}
+
+}
+
+uint64_t TaskHistogramData::percentile(double fraction) const
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count + 0.5));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKETS - 1; ++i) {
+		seen += buckets[i];
+		if (seen >= target) {
+			return std::min<uint64_t>(max, UINT64_C(1) << i);
+		}
+	}
+	return max;
+}
+
+TaskHistogramData& TaskHistogramData::operator-=(const TaskHistogramData& other)
+{
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		buckets[i] -= other.buckets[i];
+	}
+	count -= other.count;
+	total -= other.total;
+	return *this;
+}
+
+void TaskHistogram::add(uint64_t us)
+{
+	increment(buckets[getBucket(us)], 1);
+	increment(total, us);
+	raise(max, us);
+	raise(windowMax, us);
+}
+
+TaskHistogramData TaskHistogram::load() const
+{
+	TaskHistogramData data;
+	for (size_t i = 0; i < TaskHistogramData::BUCKETS; ++i) {
+		data.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+		data.count += data.buckets[i];
+	}
+	data.total = total.load(std::memory_order_relaxed);
+	data.max = max.load(std::memory_order_relaxed);
+	return data;
+}
+
+TaskProfiler::TaskProfiler()
+{
+	for (uint16_t opcode = 0; opcode <= TASK_CATEGORY_PACKET_LAST; ++opcode) {
+		std::ostringstream ss;
+		ss << "packet 0x" << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << opcode;
+		names[opcode] = ss.str();
+	}
+
+	names[TASK_CATEGORY_DEFAULT] = "dispatcher";
+	names[TASK_CATEGORY_SCHEDULER] = "scheduler";
+	names[TASK_CATEGORY_DATABASE] = "database callback";
+	names[TASK_CATEGORY_MODULES] = "Modules::executeOnRecvbyte";
+	names[TASK_CATEGORY_GAME_FRAME] = "Game::runFrame";
+	names[TASK_CATEGORY_CREATURES] = "Game::checkCreatures";
+	names[TASK_CATEGORY_CREATURE_WALK] = "Game::checkCreatureWalk";
+	names[TASK_CATEGORY_CREATURE_ATTACK] = "Game::checkCreatureAttack";
+	names[TASK_CATEGORY_DECAY] = "Game::checkDecay";
+	names[TASK_CATEGORY_IMBUEMENTS] = "Game::checkImbuements";
+	names[TASK_CATEGORY_LIGHT] = "Game::checkLight";
+	names[TASK_CATEGORY_OUTPUT] = "OutputMessagePool::sendAll";
+	names[TASK_CATEGORY_GLOBAL_EVENTS] = "GlobalEvents";
+	names[TASK_CATEGORY_RAIDS] = "Raids";
+	names[TASK_CATEGORY_SPAWNS] = "Spawn::checkSpawn";
+	names[TASK_CATEGORY_LUA_EVENT] = "addEvent";
+}
+
+uint16_t TaskProfiler::registerCategory(const std::string& name, uint16_t fallback)
+{
+	std::lock_guard<std::mutex> lockClass(namesLock);
+
+	auto it = dynamicCategories.find(name);
+	if (it != dynamicCategories.end()) {
+		return it->second;
+	}
+
+	if (nextDynamicCategory >= TASK_CATEGORY_LAST) {
+		return fallback;
+	}
+
+	uint16_t category = nextDynamicCategory++;
+	names[category] = name;
+	dynamicCategories.emplace(name, category);
+	return category;
+}
+
+std::string TaskProfiler::getName(uint16_t category) const
+{
+	std::lock_guard<std::mutex> lockClass(namesLock);
+	return names[category];
+}
+
+void TaskProfiler::record(uint16_t category, std::chrono::steady_clock::duration wait, std::chrono::steady_clock::duration execution)
+{
+	CategoryStats& categoryStats = stats[category];
+	categoryStats.wait.add(toMicroseconds(wait));
+	categoryStats.execution.add(toMicroseconds(execution));
+}
+
+std::vector<TaskCategoryReport> TaskProfiler::getReport() const
+{
+	std::vector<TaskCategoryReport> report;
+	for (uint16_t category = 0; category < TASK_CATEGORY_LAST; ++category) {
+		const CategoryStats& categoryStats = stats[category];
+		uint64_t expired = categoryStats.expired.load(std::memory_order_relaxed);
+		TaskHistogramData execution = categoryStats.execution.load();
+		if (execution.count == 0 && expired == 0) {
+			continue;
+		}
+
+		report.emplace_back();
+		TaskCategoryReport& entry = report.back();
+		entry.name = getName(category);
+		entry.expired = expired;
+		entry.execution = execution;
+		entry.wait = categoryStats.wait.load();
+	}
+
+	std::sort(report.begin(), report.end(), [](const TaskCategoryReport& lhs, const TaskCategoryReport& rhs) {
+		return lhs.execution.total > rhs.execution.total;
+	});
+	return report;
+}
+
+void TaskProfiler::startReports(uint32_t interval)
+{
+	lastReport.assign(TASK_CATEGORY_LAST, {});
+	for (CategoryStats& categoryStats : stats) {
+		categoryStats.execution.takeWindowMax();
+		categoryStats.wait.takeWindowMax();
+	}
+
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&TaskProfiler::logReport, this, interval)));
+}
+
+void TaskProfiler::logReport(uint32_t interval)
+{
+	g_scheduler.addEvent(createSchedulerTask(interval, std::bind(&TaskProfiler::logReport, this, interval)));
+
+	std::vector<std::pair<uint16_t, std::pair<TaskHistogramData, TaskHistogramData>>> window;
+	uint64_t busy = 0;
+	for (uint16_t category = 0; category < TASK_CATEGORY_LAST; ++category) {
+		CategoryStats& categoryStats = stats[category];
+		TaskHistogramData executionTotals = categoryStats.execution.load();
+		TaskHistogramData waitTotals = categoryStats.wait.load();
+
+		auto& last = lastReport[category];
+		TaskHistogramData execution = executionTotals;
+		execution -= last.first;
+		execution.max = categoryStats.execution.takeWindowMax();
+		TaskHistogramData wait = waitTotals;
+		wait -= last.second;
+		wait.max = categoryStats.wait.takeWindowMax();
+		last = std::make_pair(executionTotals, waitTotals);
+
+		if (execution.count != 0) {
+			// a game frame includes the packet tasks it runs, which are counted on their own
+			if (category != TASK_CATEGORY_GAME_FRAME) {
+				busy += execution.total;
+			}
+			window.emplace_back(category, std::make_pair(execution, wait));
+		}
+	}
+
+	if (window.empty()) {
+		return;
+	}
+
+	std::sort(window.begin(), window.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.second.first.total > rhs.second.first.total;
+	});
+
+	SPDLOG_INFO("Dispatcher busy {} ms of the last {} s, busiest tasks:", busy / 1000, interval / 1000);
+	for (size_t i = 0, size = std::min(window.size(), TASK_PROFILER_LOG_LINES); i < size; ++i) {
+		const TaskHistogramData& execution = window[i].second.first;
+		const TaskHistogramData& wait = window[i].second.second;
+		SPDLOG_INFO("  {}: {} runs, {} ms total, p50 {} us, p99 {} us, max {} us, wait p50 {} us, p99 {} us, max {} us",
+			getName(window[i].first), execution.count, execution.total / 1000,
+			execution.percentile(0.5), execution.percentile(0.99), execution.max,
+			wait.percentile(0.5), wait.percentile(0.99), wait.max);
+	}
+}
@@ -0,0 +1,161 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_TASKPROFILER_H_F83A738A600E494B9B7A1B4C8725F644
+#define FS_TASKPROFILER_H_F83A738A600E494B9B7A1B4C8725F644
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Categories 0x00 - 0xFF are the client packet opcodes parsed by ProtocolGame
+enum TaskCategory_t : uint16_t {
+	TASK_CATEGORY_PACKET_LAST = 0xFF,
+
+	TASK_CATEGORY_DEFAULT,
+	TASK_CATEGORY_SCHEDULER,
+	TASK_CATEGORY_DATABASE,
+	TASK_CATEGORY_MODULES,
+	TASK_CATEGORY_GAME_FRAME,
+	TASK_CATEGORY_CREATURES,
+	TASK_CATEGORY_CREATURE_WALK,
+	TASK_CATEGORY_CREATURE_ATTACK,
+	TASK_CATEGORY_DECAY,
+	TASK_CATEGORY_IMBUEMENTS,
+	TASK_CATEGORY_LIGHT,
+	TASK_CATEGORY_OUTPUT,
+	TASK_CATEGORY_GLOBAL_EVENTS,
+	TASK_CATEGORY_RAIDS,
+	TASK_CATEGORY_SPAWNS,
+	TASK_CATEGORY_LUA_EVENT,
+
+	// registered at runtime by name, e.g. one per Lua addEvent callback
+	TASK_CATEGORY_FIRST_DYNAMIC,
+	TASK_CATEGORY_LAST = 512,
+};
+
+struct TaskHistogramData
+{
+	// bucket 0 counts samples below 1us, bucket i samples in [2^(i-1), 2^i) us, the last one is open ended
+	static constexpr size_t BUCKETS = 24;
+
+	std::array<uint64_t, BUCKETS> buckets {};
+	uint64_t count = 0;
+	uint64_t total = 0;
+	uint64_t max = 0;
+
+	// upper bound of the bucket holding the given fraction of the samples, in microseconds
+	uint64_t percentile(double fraction) const;
+
+	TaskHistogramData& operator-=(const TaskHistogramData& other);
+};
+
+/*
+ * Latency histogram in microseconds. Only the dispatcher thread records samples,
+ * so plain relaxed loads and stores are enough and any thread can read it without locking.
+ */
+class TaskHistogram
+{
+	public:
+		void add(uint64_t us);
+
+		TaskHistogramData load() const;
+		// max since the previous call, used by the periodic report
+		uint64_t takeWindowMax() {
+			return windowMax.exchange(0, std::memory_order_relaxed);
+		}
+
+	private:
+		std::array<std::atomic<uint64_t>, TaskHistogramData::BUCKETS> buckets {};
+		std::atomic<uint64_t> total {0};
+		std::atomic<uint64_t> max {0};
+		std::atomic<uint64_t> windowMax {0};
+};
+
+struct TaskCategoryReport
+{
+	std::string name;
+	uint64_t expired = 0;
+	// time spent running the tasks
+	TaskHistogramData execution;
+	// time between the task being pushed to the dispatcher and starting to run
+	TaskHistogramData wait;
+};
+
+/*
+ * Per category timing of every task run by the dispatcher, so lag spikes can be
+ * traced back to the packet, event or callback that caused them.
+ */
+class TaskProfiler
+{
+	public:
+		TaskProfiler();
+
+		// non-copyable
+		TaskProfiler(const TaskProfiler&) = delete;
+		TaskProfiler& operator=(const TaskProfiler&) = delete;
+
+		static TaskProfiler& getInstance() {
+			static TaskProfiler instance;
+			return instance;
+		}
+
+		// returns the category with that name, creating it if needed, or fallback once all categories are taken
+		uint16_t registerCategory(const std::string& name, uint16_t fallback);
+
+		// dispatcher thread
+		void record(uint16_t category, std::chrono::steady_clock::duration wait, std::chrono::steady_clock::duration execution);
+		void recordExpired(uint16_t category) {
+			auto& counter = stats[category].expired;
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		// totals since startup of every category that ran a task, sorted by total execution time
+		std::vector<TaskCategoryReport> getReport() const;
+
+		// logs the busiest categories of each interval (milliseconds)
+		void startReports(uint32_t interval);
+
+	private:
+		struct CategoryStats {
+			TaskHistogram execution;
+			TaskHistogram wait;
+			std::atomic<uint64_t> expired {0};
+		};
+
+		void logReport(uint32_t interval);
+		std::string getName(uint16_t category) const;
+
+		std::array<CategoryStats, TASK_CATEGORY_LAST> stats;
+
+		mutable std::mutex namesLock;
+		std::array<std::string, TASK_CATEGORY_LAST> names;
+		std::unordered_map<std::string, uint16_t> dynamicCategories;
+		uint16_t nextDynamicCategory = TASK_CATEGORY_FIRST_DYNAMIC;
+
+		// totals at the previous periodic report, only touched by logReport
+		std::vector<std::pair<TaskHistogramData, TaskHistogramData>> lastReport;
+};
+
+#endif
@@ -24,9 +24,11 @@
 
 extern Game g_game;
 
-Task* createTask(std::function<void (void)> f)
+Task* createTask(std::function<void (void)> f, uint16_t category /*= TASK_CATEGORY_DEFAULT*/)
 {
-	return new Task(std::move(f));
+	Task* task = new Task(std::move(f));
+	task->setCategory(category);
+	return task;
 }
 
 Task* createTask(uint32_t expiration, std::function<void (void)> f)
@@ -34,73 +36,143 @@ Task* createTask(uint32_t expiration, std::function<void (void)> f)
 	return new Task(expiration, std::move(f));
 }
 
-void Dispatcher::threadMain()
+Task* Dispatcher::takeTasks(std::atomic<Task*>& head)
 {
-	// NOTE: second argument defer_lock is to prevent from immediate locking
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+	if (!head.load(std::memory_order_relaxed)) {
+		return nullptr;
+	}
+
+	Task* task = head.exchange(nullptr, std::memory_order_acquire);
+	Task* list = nullptr;
+	while (task) {
+		Task* following = task->next;
+		task->next = list;
+		list = task;
+		task = following;
+	}
+	return list;
+}
 
+void Dispatcher::threadMain()
+{
 	while (getState() != THREAD_STATE_TERMINATED) {
-		// check if there are tasks waiting
-		taskLockUnique.lock();
+		// priority tasks go ahead of the rest of the current batch
+		if (!priorityTasks) {
+			priorityTasks = takeTasks(priorityTaskHead);
+		}
 
-		if (taskList.empty()) {
-			//if the list is empty wait for signal
-			taskSignal.wait(taskLockUnique);
+		Task* task;
+		if (priorityTasks) {
+			task = priorityTasks;
+			priorityTasks = task->next;
+		} else if (!frameMode.load(std::memory_order_relaxed) && (tasks || (tasks = takeTasks(taskHead)))) {
+			task = tasks;
+			tasks = task->next;
+		} else {
+			waitForTasks();
+			continue;
 		}
 
-		if (!taskList.empty()) {
-			// take the first task
-			Task* task = taskList.front();
-			taskList.pop_front();
-			taskLockUnique.unlock();
-
-			if (!task->hasExpired()) {
-				++dispatcherCycle;
-				// execute it
-				(*task)();
-			}
+		runTask(task);
+	}
+
+	// what is still linked on the heads was pushed before the state changed and never ran
+	for (Task* list : {priorityTasks, tasks, takeTasks(priorityTaskHead), takeTasks(taskHead)}) {
+		while (list) {
+			Task* task = list;
+			list = task->next;
 			delete task;
-		} else {
-			taskLockUnique.unlock();
 		}
 	}
+	priorityTasks = nullptr;
+	tasks = nullptr;
 }
 
-void Dispatcher::addTask(Task* task, bool push_front /*= false*/)
+void Dispatcher::runTask(Task* task)
 {
-	bool do_signal = false;
+	if (!task->hasExpired()) {
+		++dispatcherCycle;
+		auto start = std::chrono::steady_clock::now();
+		// execute it
+		(*task)();
+		TaskProfiler::getInstance().record(task->category, start - task->queued, std::chrono::steady_clock::now() - start);
+	} else {
+		TaskProfiler::getInstance().recordExpired(task->category);
+	}
+	delete task;
+}
 
-	taskLock.lock();
+size_t Dispatcher::runQueuedTasks(int64_t deadline)
+{
+	size_t executed = 0;
+	while (tasks || (tasks = takeTasks(taskHead))) {
+		if (executed != 0 && OTSYS_TIME() >= deadline) {
+			break;
+		}
 
-	if (getState() == THREAD_STATE_RUNNING) {
-		do_signal = taskList.empty();
+		Task* task = tasks;
+		tasks = task->next;
+		runTask(task);
+		++executed;
+	}
+	return executed;
+}
 
-		if (push_front) {
-			taskList.push_front(task);
-		} else {
-			taskList.push_back(task);
-		}
-	} else {
-		delete task;
+void Dispatcher::setFrameMode(bool enabled)
+{
+	frameMode.store(enabled);
+
+	// the dispatcher thread may be parked with regular tasks waiting
+	std::lock_guard<std::mutex> lockClass(taskLock);
+	taskSignal.notify_one();
+}
+
+void Dispatcher::waitForTasks()
+{
+	std::unique_lock<std::mutex> taskLockUnique(taskLock);
+
+	// producers check the flag after pushing, so either they see it or we see their task
+	parked.store(true);
+	if (!priorityTaskHead.load() && (frameMode.load() || !taskHead.load())) {
+		taskSignal.wait(taskLockUnique);
 	}
+	parked.store(false);
+}
 
-	taskLock.unlock();
+void Dispatcher::pushTask(Task* task, bool push_front)
+{
+	std::atomic<Task*>& head = push_front ? priorityTaskHead : taskHead;
+	task->queued = std::chrono::steady_clock::now();
+	task->next = head.load(std::memory_order_relaxed);
+	while (!head.compare_exchange_weak(task->next, task)) {
+		// task->next was reloaded with the current head
+	}
 
-	// send a signal if the list was empty
-	if (do_signal) {
+	// only signal if the dispatcher thread is parked and going to run the task
+	if (parked.load() && (push_front || !frameMode.load())) {
+		std::lock_guard<std::mutex> lockClass(taskLock);
 		taskSignal.notify_one();
 	}
 }
 
+void Dispatcher::addTask(Task* task, bool push_front /*= false*/)
+{
+	if (getState() != THREAD_STATE_RUNNING) {
+		delete task;
+		return;
+	}
+
+	pushTask(task, push_front);
+}
+
 void Dispatcher::shutdown()
 {
+	// let the tasks queued before the shutdown run
+	setFrameMode(false);
+
 	Task* task = createTask([this]() {
 		setState(THREAD_STATE_TERMINATED);
-		taskSignal.notify_one();
 	});
 
-	std::lock_guard<std::mutex> lockClass(taskLock);
-	taskList.push_back(task);
-
-	taskSignal.notify_one();
+	pushTask(task, false);
 }
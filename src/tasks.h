@@ -23,8 +23,13 @@
 #include <condition_variable>
 #include "thread_holder_base.h"
 #include "enums.h"
+#include "lockfree.h"
+#include "taskprofiler.h"
 
 const int DISPATCHER_TASK_EXPIRATION = 2000;
+const size_t TASK_POOL_BLOCK_SIZE = 160;
+const size_t TASK_POOL_FREE_LIST_CAPACITY = 4096;
+const size_t TASK_POOL_THREAD_CACHE_CAPACITY = 64;
 const auto SYSTEM_TIME_ZERO = std::chrono::system_clock::time_point(std::chrono::milliseconds(0));
 
 class Task
@@ -36,7 +41,7 @@ class Task
 			expiration(std::chrono::system_clock::now() + std::chrono::milliseconds(ms)), func(std::move(f)) {}
 
 		virtual ~Task() = default;
-		void operator()() {
+		virtual void operator()() {
 			func();
 		}
 
@@ -51,7 +56,17 @@ class Task
 			return expiration < std::chrono::system_clock::now();
 		}
 
+		void setCategory(uint16_t category) {
+			this->category = category;
+		}
+		uint16_t getCategory() const {
+			return category;
+		}
+
 	protected:
+		Task() = default;
+		explicit Task(uint32_t ms) : expiration(std::chrono::system_clock::now() + std::chrono::milliseconds(ms)) {}
+
 		std::chrono::system_clock::time_point expiration = SYSTEM_TIME_ZERO;
 
 	private:
@@ -59,11 +74,69 @@ class Task
 		// then it is the time the task should be added to the
 		// dispatcher
 		std::function<void (void)> func;
+
+		// intrusive link used by the dispatcher queues
+		Task* next = nullptr;
+
+		// profiler bookkeeping, see TaskProfiler
+		std::chrono::steady_clock::time_point queued;
+		uint16_t category = TASK_CATEGORY_DEFAULT;
+
+		friend class Dispatcher;
 };
 
-Task* createTask(std::function<void (void)> f);
+Task* createTask(std::function<void (void)> f, uint16_t category = TASK_CATEGORY_DEFAULT);
 Task* createTask(uint32_t expiration, std::function<void (void)> f);
 
+using TaskPool = LockfreeCachedPool<TASK_POOL_BLOCK_SIZE, TASK_POOL_FREE_LIST_CAPACITY, TASK_POOL_THREAD_CACHE_CAPACITY>;
+
+/*
+ * Task that keeps its callable inline instead of in a std::function, the whole
+ * task is a single block recycled through TaskPool. Used for the game tasks
+ * posted by every client packet, which would overflow std::function's small buffer.
+ */
+template <typename Callable>
+class InlineTask final : public Task
+{
+	public:
+		explicit InlineTask(Callable&& f) : callable(std::move(f)) {}
+		InlineTask(uint32_t ms, Callable&& f) : Task(ms), callable(std::move(f)) {}
+
+		void operator()() override {
+			callable();
+		}
+
+		static void* operator new(size_t size) {
+			if (size <= TASK_POOL_BLOCK_SIZE) {
+				return TaskPool::allocate();
+			}
+			return ::operator new(size);
+		}
+
+		static void operator delete(void* p, size_t size) {
+			if (size <= TASK_POOL_BLOCK_SIZE) {
+				TaskPool::deallocate(p);
+			} else {
+				::operator delete(p);
+			}
+		}
+
+	private:
+		Callable callable;
+};
+
+template <typename Callable>
+Task* createInlineTask(Callable f)
+{
+	return new InlineTask<Callable>(std::move(f));
+}
+
+template <typename Callable>
+Task* createInlineTask(uint32_t expiration, Callable f)
+{
+	return new InlineTask<Callable>(expiration, std::move(f));
+}
+
 class Dispatcher : public ThreadHolder<Dispatcher> {
 	public:
 		void addTask(Task* task, bool push_front = false);
@@ -74,13 +147,36 @@ class Dispatcher : public ThreadHolder<Dispatcher> {
 			return dispatcherCycle;
 		}
 
+		// in frame mode the regular queue is only run from a game frame through runQueuedTasks,
+		// priority tasks (scheduler events) are still run as soon as they arrive
+		void setFrameMode(bool enabled);
+		// dispatcher thread, runs regular tasks until the queue is empty or the deadline (OTSYS_TIME) passed
+		size_t runQueuedTasks(int64_t deadline);
+
 		void threadMain();
 
 	private:
+		void runTask(Task* task);
+		// takes every task pushed so far and returns them as a list in arrival order
+		static Task* takeTasks(std::atomic<Task*>& head);
+		void pushTask(Task* task, bool push_front);
+		void waitForTasks();
+
+		// lock and signal are only used to park the dispatcher thread when both queues are empty
 		std::mutex taskLock;
 		std::condition_variable taskSignal;
+		std::atomic<bool> parked {false};
+
+		// producers push onto these lock-free stacks, the dispatcher thread
+		// takes a whole stack at once and runs it in arrival order
+		std::atomic<Task*> taskHead {nullptr};
+		std::atomic<Task*> priorityTaskHead {nullptr};
+
+		// batches taken by the dispatcher thread that have not been run yet
+		Task* priorityTasks = nullptr;
+		Task* tasks = nullptr;
 
-		std::list<Task*> taskList;
+		std::atomic<bool> frameMode {false};
 		uint64_t dispatcherCycle = 0;
 };
 
@@ -0,0 +1,175 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "thinkplanner.h"
+#include "map.h"
+#include "monster.h"
+
+ThinkPlanner::~ThinkPlanner()
+{
+	shutdown();
+}
+
+void ThinkPlanner::start(size_t threadCount)
+{
+	stopping = false;
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&ThinkPlanner::threadMain, this, round);
+	}
+}
+
+void ThinkPlanner::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		stopping = true;
+	}
+	jobSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+void ThinkPlanner::plan(Map& map, const std::vector<Creature*>& creatures, uint32_t interval)
+{
+	searches.clear();
+	builds.clear();
+
+	// the same choice Creature::goToFollowCreature makes, for the creatures that will search this think
+	for (const Creature* creature : creatures) {
+		if (!creature->creatureCheck || creature->getHealth() <= 0) {
+			continue;
+		}
+
+		FindPathParams fpp;
+		if (!creature->getFollowPathSearch(interval, fpp)) {
+			continue;
+		}
+
+		const Creature* target = creature->getFollowCreature();
+		const Position& pos = creature->getPosition();
+		const Monster* monster = creature->getMonster();
+		if (monster && !monster->getMaster()) {
+			if (monster->isFleeing() || fpp.maxTargetDist > 1) {
+				// single distance steps, cheaper to take on the dispatcher than to hand out
+				continue;
+			}
+
+			if (FlowFields::isInRange(pos, target->getPosition())) {
+				FlowField* field = map.flowFields.getStaleField(*target);
+				if (field && std::find_if(builds.begin(), builds.end(), [field](const FieldBuild& build) { return build.field == field; }) == builds.end()) {
+					builds.push_back({field, target->getPosition()});
+				}
+				continue;
+			}
+		}
+
+		PathSearch search;
+		search.creature = creature;
+		search.targetPos = target->getPosition();
+		search.fpp = fpp;
+		search.region = (static_cast<uint64_t>(pos.z) << 32) | (static_cast<uint64_t>(pos.y >> 5) << 16) | (pos.x >> 5);
+		searches.push_back(std::move(search));
+	}
+
+	if (searches.empty() && builds.empty()) {
+		return;
+	}
+
+	// creatures of one region follow each other, so a thread searches close to where it searched before
+	std::stable_sort(searches.begin(), searches.end(), [](const PathSearch& lhs, const PathSearch& rhs) {
+		return lhs.region < rhs.region;
+	});
+
+	run(builds.size() + searches.size(), [this, &map](size_t index) {
+		if (index < builds.size()) {
+			builds[index].field->build(map, builds[index].targetPos);
+			return;
+		}
+
+		PathSearch& search = searches[index - builds.size()];
+		search.found = map.searchPath(*search.creature, search.targetPos, search.fpp, search.dirList);
+	});
+
+	for (const PathSearch& search : searches) {
+		map.cachePath(*search.creature, search.targetPos, search.fpp, search.dirList, search.found);
+	}
+}
+
+void ThinkPlanner::run(size_t count, const std::function<void(size_t)>& newJob)
+{
+	{
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		job = &newJob;
+		jobCount = count;
+		jobChunk = std::max<size_t>(1, count / ((threads.size() + 1) * 4));
+		nextJob.store(0, std::memory_order_relaxed);
+		busyThreads = threads.size();
+		++round;
+	}
+	jobSignal.notify_all();
+
+	// the dispatcher waits anyway, so it takes jobs as well
+	runJobs();
+
+	std::unique_lock<std::mutex> lockClass(jobLock);
+	doneSignal.wait(lockClass, [this]() { return busyThreads == 0; });
+	job = nullptr;
+}
+
+void ThinkPlanner::runJobs()
+{
+	while (true) {
+		const size_t first = nextJob.fetch_add(jobChunk, std::memory_order_relaxed);
+		if (first >= jobCount) {
+			return;
+		}
+
+		const size_t last = std::min(first + jobChunk, jobCount);
+		for (size_t index = first; index < last; ++index) {
+			(*job)(index);
+		}
+	}
+}
+
+void ThinkPlanner::threadMain(uint64_t lastRound)
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lockClass(jobLock);
+			jobSignal.wait(lockClass, [this, &lastRound]() { return stopping || round != lastRound; });
+			if (stopping) {
+				return;
+			}
+			lastRound = round;
+		}
+
+		runJobs();
+
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		if (--busyThreads == 0) {
+			doneSignal.notify_one();
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_THINKPLANNER_H_343134A1FD234072968B4B18715EA086
+#define FS_THINKPLANNER_H_343134A1FD234072968B4B18715EA086
+
+#include "creature.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class Map;
+class FlowField;
+
+/**
+  * Runs the follow path searches of a creature think bucket on a pool of worker threads before the bucket thinks.
+  * The searches only read the map; the results go into the path cache and flow fields in bucket order,
+  * so the serial onThink that follows walks exactly the paths it would have searched itself.
+  */
+class ThinkPlanner
+{
+	public:
+		ThinkPlanner() = default;
+		~ThinkPlanner();
+
+		// non-copyable
+		ThinkPlanner(const ThinkPlanner&) = delete;
+		ThinkPlanner& operator=(const ThinkPlanner&) = delete;
+
+		// threads that work along with the calling thread, 0 leaves planning off
+		void start(size_t threadCount);
+		void shutdown();
+
+		bool isRunning() const {
+			return !threads.empty();
+		}
+
+		void plan(Map& map, const std::vector<Creature*>& creatures, uint32_t interval);
+
+	private:
+		struct PathSearch {
+			const Creature* creature = nullptr;
+			Position targetPos;
+			FindPathParams fpp;
+			std::forward_list<Direction> dirList;
+			bool found = false;
+			uint64_t region = 0;
+		};
+
+		struct FieldBuild {
+			FlowField* field = nullptr;
+			Position targetPos;
+		};
+
+		void run(size_t jobCount, const std::function<void(size_t)>& job);
+		void runJobs();
+		void threadMain(uint64_t lastRound);
+
+		std::vector<PathSearch> searches;
+		std::vector<FieldBuild> builds;
+
+		std::vector<std::thread> threads;
+		std::mutex jobLock;
+		std::condition_variable jobSignal;
+		std::condition_variable doneSignal;
+		const std::function<void(size_t)>* job = nullptr;
+		size_t jobCount = 0;
+		size_t jobChunk = 1;
+		std::atomic<size_t> nextJob {0};
+		size_t busyThreads = 0;
+		uint64_t round = 0;
+		bool stopping = false;
+};
+
+#endif
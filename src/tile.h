@@ -20,7 +20,7 @@
 #ifndef FS_TILE_H_96C7EE7CF8CD48E59D5D554A181F0C56
 #define FS_TILE_H_96C7EE7CF8CD48E59D5D554A181F0C56
 
-#include <unordered_set>
+#include <boost/container/small_vector.hpp>
 
 #include "cylinder.h"
 #include "item.h"
@@ -36,7 +36,67 @@ class BedItem;
 
 using CreatureVector = std::vector<Creature*>;
 using ItemVector = std::vector<Item*>;
-using SpectatorHashSet = std::unordered_set<Creature*>;
+
+static constexpr size_t SPECTATOR_VEC_CAPACITY = 32;
+
+/**
+  * Creatures around a position, each at most once.
+  * The first SPECTATOR_VEC_CAPACITY live inline, so most lookups never allocate.
+  */
+class SpectatorVec
+{
+	using Vec = boost::container::small_vector<Creature*, SPECTATOR_VEC_CAPACITY>;
+
+	public:
+		using iterator = Vec::iterator;
+		using const_iterator = Vec::const_iterator;
+
+		// adds the spectator unless it is already in the list
+		void insert(Creature* spectator) {
+			if (std::find(vec.begin(), vec.end(), spectator) == vec.end()) {
+				vec.push_back(spectator);
+			}
+		}
+		// adds a spectator the caller knows is not in the list yet
+		void emplace_back(Creature* spectator) {
+			vec.push_back(spectator);
+		}
+		void addSpectators(const SpectatorVec& spectators);
+
+		void erase(Creature* spectator) {
+			auto it = std::find(vec.begin(), vec.end(), spectator);
+			if (it != vec.end()) {
+				*it = vec.back();
+				vec.pop_back();
+			}
+		}
+		void clear() {
+			vec.clear();
+		}
+
+		size_t size() const {
+			return vec.size();
+		}
+		bool empty() const {
+			return vec.empty();
+		}
+
+		iterator begin() {
+			return vec.begin();
+		}
+		const_iterator begin() const {
+			return vec.begin();
+		}
+		iterator end() {
+			return vec.end();
+		}
+		const_iterator end() const {
+			return vec.end();
+		}
+
+	private:
+		Vec vec;
+};
 
 enum tileflags_t : uint32_t {
 	TILESTATE_NONE = 0,
@@ -65,6 +125,7 @@ enum tileflags_t : uint32_t {
 	TILESTATE_IMMOVABLENOFIELDBLOCKPATH = 1 << 21,
 	TILESTATE_NOFIELDBLOCKPATH = 1 << 22,
 	TILESTATE_SUPPORTS_HANGABLE = 1 << 23,
+	TILESTATE_BLOCKPROJECTILE = 1 << 24,
 
 	TILESTATE_FLOORCHANGE = TILESTATE_FLOORCHANGE_DOWN | TILESTATE_FLOORCHANGE_NORTH | TILESTATE_FLOORCHANGE_SOUTH | TILESTATE_FLOORCHANGE_EAST | TILESTATE_FLOORCHANGE_WEST | TILESTATE_FLOORCHANGE_SOUTH_ALT | TILESTATE_FLOORCHANGE_EAST_ALT,
 };
@@ -292,8 +353,8 @@ class Tile : public Cylinder
 	private:
 		void onAddTileItem(Item* item);
 		void onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newItem, const ItemType& newType);
-		void onRemoveTileItem(const SpectatorHashSet& spectators, const std::vector<int32_t>& oldStackPosVector, Item* item);
-		void onUpdateTile(const SpectatorHashSet& spectators);
+		void onRemoveTileItem(const SpectatorVec& spectators, const std::vector<int32_t>& oldStackPosVector, Item* item);
+		void onUpdateTile(const SpectatorVec& spectators);
 
 		void setTileFlags(const Item* item);
 		void resetTileFlags(const Item* item);
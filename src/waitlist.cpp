@@ -66,6 +66,8 @@ struct WaitListInfo
 {
 	WaitList priorityWaitList;
 	WaitList waitList;
+	// logins let in whose characters are still loading, they count as online
+	uint32_t loadingLogins = 0;
 
 	std::pair<WaitList::iterator, WaitList::size_type> findClient(const Player *player) {
 		std::size_t slot = 1;
@@ -106,14 +108,36 @@ std::size_t WaitingList::getTime(std::size_t slot)
 }
 
 bool WaitingList::clientLogin(const Player* player)
+{
+	if (!admitClient(player)) {
+		return false;
+	}
+
+	++info->loadingLogins;
+	return true;
+}
+
+void WaitingList::loginFinished()
+{
+	if (info->loadingLogins != 0) {
+		--info->loadingLogins;
+	}
+}
+
+bool WaitingList::admitClient(const Player* player)
 {
 	if (player->hasFlag(PlayerFlag_CanAlwaysLogin) ||
       player->getAccountType() >= account::ACCOUNT_TYPE_GAMEMASTER) {
 		return true;
 	}
 
+	// a full login queue waits in line like a full server does
+	uint32_t maxLoading = static_cast<uint32_t>(g_config.getNumber(ConfigManager::LOGIN_QUEUE_SIZE));
+	bool loadingFull = maxLoading != 0 && info->loadingLogins >= maxLoading;
+	size_t playersOnline = g_game.getPlayersOnline() + info->loadingLogins;
+
 	uint32_t maxPlayers = static_cast<uint32_t>(g_config.getNumber(ConfigManager::MAX_PLAYERS));
-	if (maxPlayers == 0 || (info->priorityWaitList.empty() && info->waitList.empty() && g_game.getPlayersOnline() < maxPlayers)) {
+	if (!loadingFull && (maxPlayers == 0 || (info->priorityWaitList.empty() && info->waitList.empty() && playersOnline < maxPlayers))) {
 		return true;
 	}
 
@@ -124,7 +148,7 @@ bool WaitingList::clientLogin(const Player* player)
 	WaitList::size_type slot;
 	std::tie(it, slot) = info->findClient(player);
 	if (it != info->waitList.end()) {
-		if ((g_game.getPlayersOnline() + slot) <= maxPlayers) {
+		if (!loadingFull && (maxPlayers == 0 || (playersOnline + slot) <= maxPlayers)) {
 			//should be able to login now
 			info->waitList.erase(it);
 			return true;
@@ -29,13 +29,17 @@ class WaitingList
 	public:
 		static WaitingList& getInstance();
 
+		// true lets the login load the character, it holds a slot until loginFinished
 		bool clientLogin(const Player* player);
+		void loginFinished();
 		std::size_t getClientSlot(const Player* player);
 		static std::size_t getTime(std::size_t slot);
 
 	private:
 		WaitingList();
 
+		bool admitClient(const Player* player);
+
 		std::unique_ptr<WaitListInfo> info;
 };
 
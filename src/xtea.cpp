@@ -24,11 +24,27 @@
 #include <array>
 #include <assert.h>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define XTEA_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC lets any function use the AVX2 intrinsics
+#define XTEA_TARGET_AVX2
+#else
+#define XTEA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XTEA_SSE2
+#endif
+#endif
+
 namespace xtea {
 
 namespace {
 
 constexpr uint32_t delta = 0x9E3779B9;
+constexpr size_t rounds = 32;
 
 template<typename Round>
 void apply_rounds(uint8_t* data, size_t length, Round round) {
@@ -50,9 +66,9 @@ void apply_rounds(uint8_t* data, size_t length, Round round) {
     data[j+7] = static_cast<uint8_t>(right >> 24u);
   }
 }
-}  // namespace
 
-void encrypt(uint8_t* data, size_t length, const key& k) {
+// reference implementation, every round walks the whole buffer
+void encrypt_scalar(uint8_t* data, size_t length, const key& k) {
   for (uint32_t i = 0, sum = 0, next_sum = sum + delta; i < 32; ++i,
       sum = next_sum, next_sum += delta) {
     apply_rounds(data, length, [&](uint32_t& left, uint32_t& right) {
@@ -63,7 +79,7 @@ void encrypt(uint8_t* data, size_t length, const key& k) {
   }
 }
 
-void decrypt(uint8_t* data, size_t length, const key& k) {
+void decrypt_scalar(uint8_t* data, size_t length, const key& k) {
   for (uint32_t i = 0, sum = delta << 5, next_sum = sum - delta; i < 32; ++i,
       sum = next_sum, next_sum -= delta) {
     apply_rounds(data, length, [&](uint32_t& left, uint32_t& right) {
@@ -74,4 +90,206 @@ void decrypt(uint8_t* data, size_t length, const key& k) {
   }
 }
 
+#if defined(XTEA_X86)
+// the key schedule only depends on the round, so the blocked versions compute
+// the two values added in each round once per message
+struct round_keys {
+  std::array<uint32_t, rounds> first;
+  std::array<uint32_t, rounds> second;
+};
+
+round_keys encrypt_keys(const key& k) {
+  round_keys keys;
+  uint32_t sum = 0;
+  for (size_t i = 0; i < rounds; ++i) {
+    keys.first[i] = sum + k[sum & 3];
+    sum += delta;
+    keys.second[i] = sum + k[(sum >> 11) & 3];
+  }
+  return keys;
+}
+
+round_keys decrypt_keys(const key& k) {
+  round_keys keys;
+  uint32_t sum = delta << 5;
+  for (size_t i = 0; i < rounds; ++i) {
+    keys.first[i] = sum + k[(sum >> 11) & 3];
+    sum -= delta;
+    keys.second[i] = sum + k[sum & 3];
+  }
+  return keys;
+}
+
+// all rounds on one block at a time, used for the blocks left over by the vector loops
+void encrypt_blocks(uint8_t* data, size_t length, const round_keys& keys) {
+  for (size_t j = 0; j < length; j += 8) {
+    uint32_t left, right;
+    memcpy(&left, data + j, 4);
+    memcpy(&right, data + j + 4, 4);
+    for (size_t i = 0; i < rounds; ++i) {
+      left += ((right << 4 ^ right >> 5) + right) ^ keys.first[i];
+      right += ((left << 4 ^ left >> 5) + left) ^ keys.second[i];
+    }
+    memcpy(data + j, &left, 4);
+    memcpy(data + j + 4, &right, 4);
+  }
+}
+
+void decrypt_blocks(uint8_t* data, size_t length, const round_keys& keys) {
+  for (size_t j = 0; j < length; j += 8) {
+    uint32_t left, right;
+    memcpy(&left, data + j, 4);
+    memcpy(&right, data + j + 4, 4);
+    for (size_t i = 0; i < rounds; ++i) {
+      right -= ((left << 4 ^ left >> 5) + left) ^ keys.first[i];
+      left -= ((right << 4 ^ right >> 5) + right) ^ keys.second[i];
+    }
+    memcpy(data + j, &left, 4);
+    memcpy(data + j + 4, &right, 4);
+  }
+}
+#endif
+
+#if defined(XTEA_SSE2)
+// 4 blocks per iteration, the left and right halves are split into their own vectors
+inline __m128i mix_sse2(__m128i v) {
+  return _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v, 4), _mm_srli_epi32(v, 5)), v);
+}
+
+void encrypt_sse2(uint8_t* data, size_t length, const key& k) {
+  const round_keys keys = encrypt_keys(k);
+  size_t j = 0;
+  for (; j + 32 <= length; j += 32) {
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j)));
+    __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j + 16)));
+    __m128i left = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i right = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    for (size_t i = 0; i < rounds; ++i) {
+      left = _mm_add_epi32(left, _mm_xor_si128(mix_sse2(right), _mm_set1_epi32(keys.first[i])));
+      right = _mm_add_epi32(right, _mm_xor_si128(mix_sse2(left), _mm_set1_epi32(keys.second[i])));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + j), _mm_unpacklo_epi32(left, right));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + j + 16), _mm_unpackhi_epi32(left, right));
+  }
+  encrypt_blocks(data + j, length - j, keys);
+}
+
+void decrypt_sse2(uint8_t* data, size_t length, const key& k) {
+  const round_keys keys = decrypt_keys(k);
+  size_t j = 0;
+  for (; j + 32 <= length; j += 32) {
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j)));
+    __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j + 16)));
+    __m128i left = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i right = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    for (size_t i = 0; i < rounds; ++i) {
+      right = _mm_sub_epi32(right, _mm_xor_si128(mix_sse2(left), _mm_set1_epi32(keys.first[i])));
+      left = _mm_sub_epi32(left, _mm_xor_si128(mix_sse2(right), _mm_set1_epi32(keys.second[i])));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + j), _mm_unpacklo_epi32(left, right));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + j + 16), _mm_unpackhi_epi32(left, right));
+  }
+  decrypt_blocks(data + j, length - j, keys);
+}
+#endif
+
+#if defined(XTEA_X86)
+// 8 blocks per iteration, the shuffles work within each 128-bit lane and the unpacks undo them
+XTEA_TARGET_AVX2 inline __m256i mix_avx2(__m256i v) {
+  return _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v, 4), _mm256_srli_epi32(v, 5)), v);
+}
+
+XTEA_TARGET_AVX2 void encrypt_avx2(uint8_t* data, size_t length, const key& k) {
+  const round_keys keys = encrypt_keys(k);
+  size_t j = 0;
+  for (; j + 64 <= length; j += 64) {
+    __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + j)));
+    __m256 b = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + j + 32)));
+    __m256i left = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m256i right = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    for (size_t i = 0; i < rounds; ++i) {
+      left = _mm256_add_epi32(left, _mm256_xor_si256(mix_avx2(right), _mm256_set1_epi32(keys.first[i])));
+      right = _mm256_add_epi32(right, _mm256_xor_si256(mix_avx2(left), _mm256_set1_epi32(keys.second[i])));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + j), _mm256_unpacklo_epi32(left, right));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + j + 32), _mm256_unpackhi_epi32(left, right));
+  }
+  encrypt_blocks(data + j, length - j, keys);
+}
+
+XTEA_TARGET_AVX2 void decrypt_avx2(uint8_t* data, size_t length, const key& k) {
+  const round_keys keys = decrypt_keys(k);
+  size_t j = 0;
+  for (; j + 64 <= length; j += 64) {
+    __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + j)));
+    __m256 b = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + j + 32)));
+    __m256i left = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m256i right = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    for (size_t i = 0; i < rounds; ++i) {
+      right = _mm256_sub_epi32(right, _mm256_xor_si256(mix_avx2(left), _mm256_set1_epi32(keys.first[i])));
+      left = _mm256_sub_epi32(left, _mm256_xor_si256(mix_avx2(right), _mm256_set1_epi32(keys.second[i])));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + j), _mm256_unpacklo_epi32(left, right));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + j + 32), _mm256_unpackhi_epi32(left, right));
+  }
+  decrypt_blocks(data + j, length - j, keys);
+}
+
+bool cpu_supports_avx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // the OS has to save the YMM registers as well
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+std::vector<implementation> detect_implementations() {
+  std::vector<implementation> implementations {{"scalar", encrypt_scalar, decrypt_scalar}};
+#if defined(XTEA_SSE2)
+  implementations.push_back({"sse2", encrypt_sse2, decrypt_sse2});
+#endif
+#if defined(XTEA_X86)
+  if (cpu_supports_avx2()) {
+    implementations.push_back({"avx2", encrypt_avx2, decrypt_avx2});
+  }
+#endif
+  return implementations;
+}
+
+const implementation& selected_implementation() {
+  static const implementation& selected = supported_implementations().back();
+  return selected;
+}
+
+}  // namespace
+
+const std::vector<implementation>& supported_implementations() {
+  static const std::vector<implementation> implementations = detect_implementations();
+  return implementations;
+}
+
+void encrypt(uint8_t* data, size_t length, const key& k) {
+  selected_implementation().encrypt(data, length, k);
+}
+
+void decrypt(uint8_t* data, size_t length, const key& k) {
+  selected_implementation().decrypt(data, length, k);
+}
+
 }  // namespace xtea
@@ -20,13 +20,27 @@
 #ifndef TFS_XTEA_H
 #define TFS_XTEA_H
 
+#include <vector>
+
 namespace xtea {
 
 using key = std::array<uint32_t, 4>;
 
+// length must be a multiple of 8, the fastest implementation the CPU supports is used
 void encrypt(uint8_t* data, size_t length, const key& k);
 void decrypt(uint8_t* data, size_t length, const key& k);
 
+using cipher = void (*)(uint8_t* data, size_t length, const key& k);
+
+struct implementation {
+  const char* name;
+  cipher encrypt;
+  cipher decrypt;
+};
+
+// every implementation this CPU can run, the scalar reference first and the selected one last
+const std::vector<implementation>& supported_implementations();
+
 } // namespace xtea
 
 #endif // TFS_XTEA_H
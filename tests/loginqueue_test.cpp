@@ -0,0 +1,83 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/loginqueue.h"
+#include <catch2/catch.hpp>
+#include <future>
+
+TEST_CASE("Login queue without threads runs jobs on the caller", "[UnitTest]") {
+	LoginQueue queue;
+	queue.start(0, 1);
+
+	const std::thread::id caller = std::this_thread::get_id();
+	std::thread::id ranOn;
+	for (size_t i = 0; i < 3; ++i) {
+		REQUIRE(queue.tryAddJob([&ranOn]() { ranOn = std::this_thread::get_id(); }));
+		CHECK(ranOn == caller);
+	}
+}
+
+TEST_CASE("Login queue turns jobs away once it is full", "[UnitTest]") {
+	LoginQueue queue;
+	queue.start(1, 2);
+
+	// keeps the only thread busy so the following jobs wait in the queue
+	std::promise<void> started, release;
+	std::shared_future<void> released = release.get_future().share();
+	REQUIRE(queue.tryAddJob([&started, released]() {
+		started.set_value();
+		released.wait();
+	}));
+	started.get_future().wait();
+
+	std::atomic<size_t> finished {0};
+	std::promise<void> done;
+	CHECK(queue.tryAddJob([&finished]() { ++finished; }));
+	CHECK(queue.tryAddJob([&finished, &done]() {
+		++finished;
+		done.set_value();
+	}));
+	CHECK_FALSE(queue.tryAddJob([&finished]() { ++finished; }));
+
+	release.set_value();
+	done.get_future().wait();
+	queue.shutdown();
+	CHECK(finished == 2);
+}
+
+TEST_CASE("Login queue runs the drop callbacks of jobs it stops before they start", "[UnitTest]") {
+	LoginQueue queue;
+	queue.start(1, 0);
+
+	std::promise<void> started, release;
+	std::shared_future<void> released = release.get_future().share();
+	queue.addJob([&started, released]() {
+		started.set_value();
+		released.wait();
+	});
+	started.get_future().wait();
+
+	bool ran = false;
+	bool dropped = false;
+	queue.addJob([&ran]() { ran = true; }, [&dropped]() { dropped = true; });
+
+	auto stopped = std::async(std::launch::async, [&queue]() { queue.shutdown(); });
+	// once shutdown started, a new job is dropped right on the caller
+	const std::thread::id caller = std::this_thread::get_id();
+	std::atomic<bool> droppedOnCaller {false};
+	while (!droppedOnCaller) {
+		queue.addJob([]() {}, [&droppedOnCaller, caller]() {
+			if (std::this_thread::get_id() == caller) {
+				droppedOnCaller = true;
+			}
+		});
+	}
+
+	release.set_value();
+	stopped.wait();
+	CHECK_FALSE(ran);
+	CHECK(dropped);
+}
@@ -0,0 +1,307 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/housetile.h"
+#include "../src/iomapsnapshot.h"
+#include "../src/map.h"
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <random>
+
+namespace {
+
+// resident set size in bytes, 0 where /proc is not available
+size_t getResidentMemory()
+{
+	std::ifstream statm("/proc/self/statm");
+	size_t pages = 0, resident = 0;
+	if (!(statm >> pages >> resident)) {
+		return 0;
+	}
+	return resident * 4096;
+}
+
+// Map::checkSightLine as it was before the sight tables, reading the tiles themselves
+bool referenceSightLine(const Map& map, const Position& fromPos, const Position& toPos)
+{
+	if (fromPos == toPos) {
+		return true;
+	}
+
+	Position start(fromPos.z > toPos.z ? toPos : fromPos);
+	Position destination(fromPos.z > toPos.z ? fromPos : toPos);
+
+	const int8_t mx = start.x < destination.x ? 1 : start.x == destination.x ? 0 : -1;
+	const int8_t my = start.y < destination.y ? 1 : start.y == destination.y ? 0 : -1;
+
+	int32_t A = Position::getOffsetY(destination, start);
+	int32_t B = Position::getOffsetX(start, destination);
+	int32_t C = -(A * destination.x + B * destination.y);
+
+	while (start.x != destination.x || start.y != destination.y) {
+		int32_t move_hor = std::abs(A * (start.x + mx) + B * (start.y) + C);
+		int32_t move_ver = std::abs(A * (start.x) + B * (start.y + my) + C);
+		int32_t move_cross = std::abs(A * (start.x + mx) + B * (start.y + my) + C);
+
+		if (start.y != destination.y && (start.x == destination.x || move_hor > move_ver || move_hor > move_cross)) {
+			start.y += my;
+		}
+
+		if (start.x != destination.x && (start.y == destination.y || move_ver > move_hor || move_ver > move_cross)) {
+			start.x += mx;
+		}
+
+		const Tile* tile = map.getTile(start.x, start.y, start.z);
+		if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+			return false;
+		}
+	}
+
+	while (start.z != destination.z) {
+		const Tile* tile = map.getTile(start.x, start.y, start.z);
+		if (tile && tile->getThingCount() > 0) {
+			return false;
+		}
+
+		start.z++;
+	}
+
+	return true;
+}
+
+bool referenceSightClear(const Map& map, const Position& fromPos, const Position& toPos)
+{
+	return referenceSightLine(map, fromPos, toPos) || referenceSightLine(map, toPos, fromPos);
+}
+
+constexpr uint16_t SIGHT_MAP_OFFSET = 2000;
+constexpr uint16_t SIGHT_MAP_SIZE = 128;
+
+// a surface with holes and a fifth of its tiles blocking projectiles
+void buildSightTestMap(Map& map, std::mt19937& generator)
+{
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+	for (uint16_t y = SIGHT_MAP_OFFSET; y < SIGHT_MAP_OFFSET + SIGHT_MAP_SIZE; ++y) {
+		for (uint16_t x = SIGHT_MAP_OFFSET; x < SIGHT_MAP_OFFSET + SIGHT_MAP_SIZE; ++x) {
+			const uint32_t roll = percent(generator);
+			if (roll < 5) {
+				continue;
+			}
+
+			Tile* tile = new StaticTile(x, y, 7);
+			if (roll < 25) {
+				tile->setFlag(TILESTATE_BLOCKPROJECTILE);
+			}
+			map.setTile(x, y, 7, tile);
+		}
+	}
+}
+
+std::vector<std::pair<Position, Position>> randomSightLines(std::mt19937& generator, size_t count)
+{
+	// reaches a bit past the precomputed range so the plain walk is covered too
+	std::uniform_int_distribution<uint16_t> coordinate(SIGHT_MAP_OFFSET + 20, SIGHT_MAP_OFFSET + SIGHT_MAP_SIZE - 21);
+	std::uniform_int_distribution<int32_t> offset(-20, 20);
+	std::vector<std::pair<Position, Position>> lines;
+	for (size_t i = 0; i < count; ++i) {
+		Position from(coordinate(generator), coordinate(generator), 7);
+		Position to(from.x + offset(generator), from.y + offset(generator), 7);
+		lines.emplace_back(from, to);
+	}
+	return lines;
+}
+
+}
+
+TEST_CASE("Tiles are found where they were set", "[UnitTest]") {
+	Map map;
+	const Position positions[] = {
+		{0, 0, 0}, {65535, 65535, 15}, {1023, 1024, 7}, {1024, 1023, 7}, {31, 32, 8}, {32000, 100, 7}, {100, 32000, 3}
+	};
+	for (const Position& pos : positions) {
+		map.setTile(pos, new StaticTile(pos.x, pos.y, pos.z));
+	}
+
+	for (const Position& pos : positions) {
+		const Tile* tile = map.getTile(pos);
+		REQUIRE(tile);
+		CHECK(tile->getPosition() == pos);
+		CHECK(map.getQTNode(pos.x, pos.y));
+	}
+	CHECK_FALSE(map.getTile(1, 0, 0));
+	CHECK_FALSE(map.getTile(1023, 1024, 6));
+	CHECK_FALSE(map.getTile(5000, 5000, 7));
+}
+
+TEST_CASE("Map snapshots restore the map they were built from", "[UnitTest]") {
+	const std::string mapFileName = "snapshot_test.otbm";
+	{
+		std::ofstream otbm(mapFileName, std::ios::binary | std::ios::trunc);
+		otbm << "OTBM test contents";
+	}
+
+	Map map;
+	map.setTile(100, 100, 7, new StaticTile(100, 100, 7));
+	Tile* zone = new DynamicTile(101, 100, 7);
+	zone->setFlag(TILESTATE_PROTECTIONZONE);
+	map.setTile(101, 100, 7, zone);
+	House* house = map.houses.addHouse(5);
+	HouseTile* houseTile = new HouseTile(102, 100, 6, house);
+	house->addTile(houseTile);
+	map.setTile(102, 100, 6, houseTile);
+	Town* town = new Town(1);
+	town->setName("Thais");
+	town->setTemplePos(Position(100, 100, 7));
+	map.towns.addTown(1, town);
+	map.waypoints["temple"] = Position(100, 101, 7);
+
+	IOMapSnapshot writer;
+	REQUIRE(writer.saveMap(map, mapFileName));
+
+	SECTION("a current snapshot loads") {
+		Map restored;
+		IOMapSnapshot reader;
+		REQUIRE(reader.open(mapFileName));
+		REQUIRE(reader.loadMap(restored));
+
+		const Tile* tile = restored.getTile(100, 100, 7);
+		REQUIRE(tile);
+		CHECK(dynamic_cast<const StaticTile*>(tile));
+		tile = restored.getTile(101, 100, 7);
+		REQUIRE(tile);
+		CHECK(dynamic_cast<const DynamicTile*>(tile));
+		CHECK(tile->hasFlag(TILESTATE_PROTECTIONZONE));
+		tile = restored.getTile(102, 100, 6);
+		REQUIRE(tile);
+		CHECK(dynamic_cast<const HouseTile*>(tile));
+		CHECK(restored.houses.getHouse(5));
+		CHECK_FALSE(restored.getTile(103, 100, 7));
+
+		const Town* restoredTown = restored.towns.getTown(1);
+		REQUIRE(restoredTown);
+		CHECK(restoredTown->getName() == "Thais");
+		CHECK(restoredTown->getTemplePosition() == Position(100, 100, 7));
+		CHECK(restored.waypoints["temple"] == Position(100, 101, 7));
+	}
+
+	SECTION("a snapshot of an older map is rejected") {
+		{
+			std::ofstream otbm(mapFileName, std::ios::binary | std::ios::app);
+			otbm << "edited";
+		}
+
+		IOMapSnapshot reader;
+		CHECK_FALSE(reader.open(mapFileName));
+	}
+
+	std::remove(mapFileName.c_str());
+	std::remove(IOMapSnapshot::getSnapshotFileName(mapFileName).c_str());
+}
+
+TEST_CASE("Sight lines match the tile by tile walk", "[UnitTest]") {
+	Map map;
+	std::mt19937 generator(7);
+	buildSightTestMap(map, generator);
+
+	const auto lines = randomSightLines(generator, 20000);
+	for (const auto& line : lines) {
+		REQUIRE(map.isSightClear(line.first, line.second, true) == referenceSightClear(map, line.first, line.second));
+	}
+
+	SECTION("after tiles start or stop blocking") {
+		std::uniform_int_distribution<uint16_t> coordinate(SIGHT_MAP_OFFSET, SIGHT_MAP_OFFSET + SIGHT_MAP_SIZE - 1);
+		for (int i = 0; i < 2000; ++i) {
+			const Position pos(coordinate(generator), coordinate(generator), 7);
+			Tile* tile = map.getTile(pos);
+			if (!tile) {
+				continue;
+			}
+
+			const bool blocking = !tile->hasFlag(TILESTATE_BLOCKPROJECTILE);
+			if (blocking) {
+				tile->setFlag(TILESTATE_BLOCKPROJECTILE);
+			} else {
+				tile->resetFlag(TILESTATE_BLOCKPROJECTILE);
+			}
+			map.setProjectileBlocking(pos, blocking);
+		}
+
+		for (const auto& line : lines) {
+			REQUIRE(map.isSightClear(line.first, line.second, true) == referenceSightClear(map, line.first, line.second));
+		}
+	}
+}
+
+TEST_CASE("Sight checks over a random surface", "[.][benchmark]") {
+	Map map;
+	std::mt19937 generator(7);
+	buildSightTestMap(map, generator);
+	const auto lines = randomSightLines(generator, 100000);
+
+	BENCHMARK("100k isSightClear") {
+		size_t clear = 0;
+		for (const auto& line : lines) {
+			clear += map.isSightClear(line.first, line.second, true);
+		}
+		return clear;
+	};
+
+	BENCHMARK("100k tile by tile walks") {
+		size_t clear = 0;
+		for (const auto& line : lines) {
+			clear += referenceSightClear(map, line.first, line.second);
+		}
+		return clear;
+	};
+}
+
+TEST_CASE("Map storage with a 512x512 surface and sparse other floors", "[.][benchmark]") {
+	constexpr uint16_t offset = 1000;
+	constexpr uint16_t size = 512;
+
+	const size_t residentBefore = getResidentMemory();
+	auto map = std::make_unique<Map>();
+	std::mt19937 generator(13);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+	for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+		for (uint16_t y = offset; y < offset + size; ++y) {
+			for (uint16_t x = offset; x < offset + size; ++x) {
+				if (z == 7 || percent(generator) < 5) {
+					map->setTile(x, y, z, new StaticTile(x, y, z));
+				}
+			}
+		}
+	}
+	WARN("resident memory of the map: " << (getResidentMemory() - residentBefore) / 1024 << " KiB");
+
+	std::uniform_int_distribution<uint16_t> coordinate(offset, offset + size - 1);
+	std::vector<Position> positions;
+	for (int i = 0; i < 100000; ++i) {
+		positions.emplace_back(coordinate(generator), coordinate(generator), i % 2 == 0 ? 7 : percent(generator) % MAP_MAX_LAYERS);
+	}
+
+	BENCHMARK("100k random getTile") {
+		size_t found = 0;
+		for (const Position& pos : positions) {
+			found += map->getTile(pos) != nullptr;
+		}
+		return found;
+	};
+
+	// the access pattern of map descriptions and spectator scans
+	BENCHMARK("getTile over 100 screens of 18x14") {
+		size_t found = 0;
+		for (size_t screen = 0; screen < 100; ++screen) {
+			const Position& center = positions[screen];
+			for (int32_t x = -9; x < 9; ++x) {
+				for (int32_t y = -7; y < 7; ++y) {
+					found += map->getTile(center.x + x, center.y + y, 7) != nullptr;
+				}
+			}
+		}
+		return found;
+	};
+}
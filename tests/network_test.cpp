@@ -0,0 +1,371 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/configmanager.h"
+#include "../src/outputmessage.h"
+#include "../src/protocol.h"
+#include "../src/server.h"
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <zlib.h>
+
+extern ConfigManager g_config;
+
+namespace {
+
+constexpr uint16_t LOAD_TEST_PORT = 17190;
+constexpr size_t LOAD_TEST_CLIENTS = 2000;
+constexpr size_t LOAD_TEST_ROUND_TRIPS = 50;
+constexpr size_t LOAD_TEST_PAYLOAD = 64;
+constexpr uint16_t BURST_TEST_PORT = 17191;
+constexpr size_t BURST_TEST_MESSAGES = 300;
+constexpr size_t BURST_TEST_PAYLOAD = 1024;
+constexpr uint16_t DEFLATE_TEST_PORT = 17192;
+const xtea::key DEFLATE_TEST_KEY = {0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210};
+// counted on the network thread, Catch assertions are only made on the test thread
+std::atomic<size_t> deflateEnableFailures {0};
+
+// sends every packet back to the client, only exercises the network path
+class EchoProtocol final : public Protocol
+{
+	public:
+		enum {server_sends_first = false};
+		enum {protocol_identifier = 0xEC};
+		enum {use_checksum = false};
+		static const char* protocol_name() {
+			return "echo protocol";
+		}
+
+		explicit EchoProtocol(Connection_ptr conn) : Protocol(conn) {}
+
+		void onRecvFirstMessage(NetworkMessage& msg) override {
+			echo(msg);
+		}
+		void parsePacket(NetworkMessage& msg) override {
+			echo(msg);
+		}
+
+	private:
+		void echo(NetworkMessage& msg) {
+			auto output = OutputMessagePool::getOutputMessage();
+			output->addBytes(reinterpret_cast<const char*>(msg.getBuffer() + msg.getBufferPosition()), msg.getLength() - msg.getBufferPosition());
+			send(output);
+		}
+};
+
+// answers the first packet with a burst of numbered messages, more than one write can take
+class BurstProtocol final : public Protocol
+{
+	public:
+		enum {server_sends_first = false};
+		enum {protocol_identifier = 0xEB};
+		enum {use_checksum = false};
+		static const char* protocol_name() {
+			return "burst protocol";
+		}
+
+		explicit BurstProtocol(Connection_ptr conn) : Protocol(conn) {}
+
+		void onRecvFirstMessage(NetworkMessage&) override {
+			for (size_t i = 0; i < BURST_TEST_MESSAGES; ++i) {
+				auto output = OutputMessagePool::getOutputMessage();
+				std::string payload(BURST_TEST_PAYLOAD, static_cast<char>(i));
+				output->addBytes(payload.data(), payload.size());
+				send(output);
+			}
+		}
+};
+
+// a compact client that asked for compression, answers each packet with a body built from its payload
+class DeflateProtocol final : public Protocol
+{
+	public:
+		enum {server_sends_first = false};
+		enum {protocol_identifier = 0xEA};
+		enum {use_checksum = false};
+		static const char* protocol_name() {
+			return "deflate protocol";
+		}
+
+		explicit DeflateProtocol(Connection_ptr conn) : Protocol(conn) {}
+
+		static std::string makeBody(uint8_t seed, size_t length) {
+			std::string body;
+			while (body.size() < length) {
+				body += "tile " + std::to_string((body.size() * seed) % 97) + " item 2160 count 100;";
+			}
+			body.resize(length);
+			return body;
+		}
+
+		void onRecvFirstMessage(NetworkMessage& msg) override {
+			enableCompact();
+			setXTEAKey(DEFLATE_TEST_KEY);
+			enableXTEAEncryption();
+			if (!enableCompression(6)) {
+				++deflateEnableFailures;
+			}
+			parsePacket(msg);
+		}
+		void parsePacket(NetworkMessage& msg) override {
+			uint8_t seed = msg.getByte();
+			uint16_t length = msg.get<uint16_t>();
+			auto output = OutputMessagePool::getOutputMessage();
+			std::string body = makeBody(seed, length);
+			output->addBytes(body.data(), body.size());
+			send(output);
+		}
+};
+
+void loadTestConfig()
+{
+	{
+		std::ofstream config("network_test_config.lua");
+		config << "maxPacketsPerSecond = 1000000\n";
+	}
+	g_config.setConfigFileLua("network_test_config.lua");
+	REQUIRE(g_config.load());
+}
+
+class EchoClient : public std::enable_shared_from_this<EchoClient>
+{
+	public:
+		EchoClient(boost::asio::io_service& io_service, size_t index, std::atomic<size_t>& roundTrips, std::atomic<size_t>& failures) :
+			socket(io_service), roundTrips(roundTrips), failures(failures) {
+			// Ban::acceptConnection only lets a few connections per second in from one address
+			address = boost::asio::ip::address_v4((127u << 24) | (1u << 16) | ((index / 250) << 8) | (index % 250 + 1));
+		}
+
+		void start() {
+			boost::system::error_code error;
+			socket.open(boost::asio::ip::tcp::v4(), error);
+			socket.bind(boost::asio::ip::tcp::endpoint(address, 0), error);
+			if (error) {
+				++failures;
+				return;
+			}
+
+			auto self = shared_from_this();
+			socket.async_connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), LOAD_TEST_PORT),
+				[self](const boost::system::error_code& error) {
+					if (error) {
+						++self->failures;
+						return;
+					}
+					self->sendPacket();
+				});
+		}
+
+	private:
+		void sendPacket() {
+			// the first packet names the protocol, the following ones carry a 4 byte checksum field
+			size_t header = sent == 0 ? 1 : 4;
+			packet.assign(2 + header + LOAD_TEST_PAYLOAD, static_cast<uint8_t>(sent));
+			packet[0] = static_cast<uint8_t>(header + LOAD_TEST_PAYLOAD);
+			packet[1] = 0;
+			packet[2] = EchoProtocol::protocol_identifier;
+			++sent;
+
+			auto self = shared_from_this();
+			boost::asio::async_write(socket, boost::asio::buffer(packet), [self](const boost::system::error_code& error, size_t) {
+				if (error) {
+					++self->failures;
+					return;
+				}
+				self->readReply();
+			});
+		}
+
+		void readReply() {
+			auto self = shared_from_this();
+			reply.resize(2 + LOAD_TEST_PAYLOAD);
+			boost::asio::async_read(socket, boost::asio::buffer(reply), [self](const boost::system::error_code& error, size_t) {
+				if (error || self->reply[0] != LOAD_TEST_PAYLOAD) {
+					++self->failures;
+					return;
+				}
+
+				++self->roundTrips;
+				if (self->sent < LOAD_TEST_ROUND_TRIPS) {
+					self->sendPacket();
+				} else {
+					boost::system::error_code ignored;
+					self->socket.close(ignored);
+				}
+			});
+		}
+
+		boost::asio::ip::tcp::socket socket;
+		boost::asio::ip::address_v4 address;
+		std::vector<uint8_t> packet;
+		std::vector<uint8_t> reply;
+		std::atomic<size_t>& roundTrips;
+		std::atomic<size_t>& failures;
+		size_t sent = 0;
+};
+
+double runEchoLoad(int32_t networkThreads)
+{
+	ServiceManager serviceManager;
+	REQUIRE(serviceManager.add<EchoProtocol>(LOAD_TEST_PORT));
+	std::thread server([&serviceManager, networkThreads]() {
+		serviceManager.run(networkThreads);
+	});
+
+	std::atomic<size_t> roundTrips {0};
+	std::atomic<size_t> failures {0};
+
+	auto start = std::chrono::steady_clock::now();
+	boost::asio::io_service clientService;
+	for (size_t i = 0; i < LOAD_TEST_CLIENTS; ++i) {
+		std::make_shared<EchoClient>(clientService, i, roundTrips, failures)->start();
+	}
+
+	std::vector<std::thread> clientThreads;
+	for (unsigned int i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i) {
+		clientThreads.emplace_back([&clientService]() {
+			clientService.run();
+		});
+	}
+	for (std::thread& thread : clientThreads) {
+		thread.join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	serviceManager.stop();
+	server.join();
+
+	CHECK(failures == 0);
+	CHECK(roundTrips == LOAD_TEST_CLIENTS * LOAD_TEST_ROUND_TRIPS);
+	return roundTrips / elapsed.count();
+}
+
+}
+
+TEST_CASE("Queued messages arrive complete and in order", "[UnitTest]") {
+	loadTestConfig();
+
+	ServiceManager serviceManager;
+	REQUIRE(serviceManager.add<BurstProtocol>(BURST_TEST_PORT));
+	std::thread server([&serviceManager]() {
+		serviceManager.run(2);
+	});
+
+	boost::asio::io_service clientService;
+	boost::asio::ip::tcp::socket socket(clientService);
+	boost::system::error_code error;
+	// with a small window and a late reader the burst queues up behind the first write
+	socket.open(boost::asio::ip::tcp::v4(), error);
+	socket.set_option(boost::asio::socket_base::receive_buffer_size(4096), error);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), BURST_TEST_PORT), error);
+	REQUIRE(!error);
+
+	const uint8_t packet[] = {1, 0, BurstProtocol::protocol_identifier};
+	boost::asio::write(socket, boost::asio::buffer(packet), error);
+	REQUIRE(!error);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	std::vector<uint8_t> reply(BURST_TEST_MESSAGES * (2 + BURST_TEST_PAYLOAD));
+	boost::asio::read(socket, boost::asio::buffer(reply), error);
+	REQUIRE(!error);
+
+	for (size_t i = 0; i < BURST_TEST_MESSAGES; ++i) {
+		const uint8_t* message = reply.data() + i * (2 + BURST_TEST_PAYLOAD);
+		REQUIRE((message[0] | message[1] << 8) == BURST_TEST_PAYLOAD);
+		REQUIRE(std::all_of(message + 2, message + 2 + BURST_TEST_PAYLOAD, [i](uint8_t value) {
+			return value == static_cast<uint8_t>(i);
+		}));
+	}
+
+	socket.close(error);
+	serviceManager.stop();
+	server.join();
+}
+
+TEST_CASE("Deflated messages share one stream per connection", "[UnitTest]") {
+	loadTestConfig();
+
+	ServiceManager serviceManager;
+	REQUIRE(serviceManager.add<DeflateProtocol>(DEFLATE_TEST_PORT));
+	std::thread server([&serviceManager]() {
+		serviceManager.run(1);
+	});
+
+	boost::asio::io_service clientService;
+	boost::asio::ip::tcp::socket socket(clientService);
+	boost::system::error_code error;
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), DEFLATE_TEST_PORT), error);
+	REQUIRE(!error);
+
+	z_stream inflateStream {};
+	REQUIRE(inflateInit2(&inflateStream, -15) == Z_OK);
+
+	size_t sentBytes = 0, receivedBytes = 0;
+	for (uint8_t i = 0; i < 20; ++i) {
+		// the first packet names the protocol, the later ones are encrypted behind a sequence field
+		uint16_t bodyLength = i % 5 == 0 ? 64 : 4000 + i * 100;
+		std::vector<uint8_t> packet;
+		if (i == 0) {
+			packet = {4, 0, DeflateProtocol::protocol_identifier, i, static_cast<uint8_t>(bodyLength), static_cast<uint8_t>(bodyLength >> 8)};
+		} else {
+			packet = {12, 0, 0, 0, 0, 0, 3, 0, i, static_cast<uint8_t>(bodyLength), static_cast<uint8_t>(bodyLength >> 8), 0, 0, 0};
+			xtea::encrypt(packet.data() + 6, 8, DEFLATE_TEST_KEY);
+		}
+		boost::asio::write(socket, boost::asio::buffer(packet), error);
+		REQUIRE(!error);
+
+		uint8_t header[2];
+		boost::asio::read(socket, boost::asio::buffer(header), error);
+		REQUIRE(!error);
+		std::vector<uint8_t> reply(header[0] | header[1] << 8);
+		boost::asio::read(socket, boost::asio::buffer(reply), error);
+		REQUIRE(!error);
+
+		uint32_t sequence;
+		memcpy(&sequence, reply.data(), sizeof(sequence));
+		xtea::decrypt(reply.data() + 4, reply.size() - 4, DEFLATE_TEST_KEY);
+		size_t innerLength = reply[4] | reply[5] << 8;
+		const uint8_t* body = reply.data() + 6;
+
+		std::string expected = DeflateProtocol::makeBody(i, bodyLength);
+		std::string received;
+		// the small packets are sent as they are
+		CHECK(((sequence & 1u << 31) != 0) == (bodyLength >= 128));
+		if ((sequence & 1u << 31) != 0) {
+			received.resize(NETWORKMESSAGE_MAXSIZE);
+			inflateStream.next_in = const_cast<uint8_t*>(body);
+			inflateStream.avail_in = innerLength;
+			inflateStream.next_out = reinterpret_cast<uint8_t*>(&received[0]);
+			inflateStream.avail_out = received.size();
+			REQUIRE(inflate(&inflateStream, Z_SYNC_FLUSH) == Z_OK);
+			CHECK(inflateStream.avail_in == 0);
+			received.resize(received.size() - inflateStream.avail_out);
+
+			sentBytes += bodyLength;
+			receivedBytes += innerLength;
+		} else {
+			received.assign(reinterpret_cast<const char*>(body), innerLength);
+		}
+		REQUIRE(received == expected);
+	}
+	inflateEnd(&inflateStream);
+
+	CHECK(receivedBytes * 10 < sentBytes);
+
+	socket.close(error);
+	serviceManager.stop();
+	server.join();
+	CHECK(deflateEnableFailures == 0);
+}
+
+TEST_CASE("Network threads serve 2000 echo clients", "[.][benchmark]") {
+	loadTestConfig();
+
+	for (int32_t networkThreads : {1, 2, 4, 8}) {
+		double rate = runEchoLoad(networkThreads);
+		WARN(networkThreads << " network threads: " << static_cast<uint64_t>(rate) << " round trips/s");
+	}
+}
@@ -0,0 +1,147 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "testmap.h"
+#include <catch2/catch.hpp>
+#include <random>
+
+namespace {
+
+constexpr uint16_t TEST_MAP_SIZE = 256;
+
+FindPathParams testPathParams()
+{
+	FindPathParams fpp;
+	fpp.clearSight = false;
+	fpp.minTargetDist = 0;
+	fpp.maxTargetDist = 1;
+	fpp.maxSearchDist = 12;
+	return fpp;
+}
+
+}
+
+TEST_CASE("Path search walks around walls", "[UnitTest]") {
+	Map map;
+	// a wall across the map with a single gap in the north
+	buildTestMap(map, TEST_MAP_SIZE, [](uint16_t x, uint16_t y) {
+		return x == 20 && y != 15;
+	});
+
+	const Position start = testPosition(15, 20);
+	const Position target = testPosition(25, 20);
+	std::forward_list<Direction> dirList;
+	REQUIRE(map.getPathMatching(start, dirList, FrozenPathingConditionCall(target), testPathParams()));
+
+	Position pos = start;
+	bool usedGap = false;
+	for (Direction dir : dirList) {
+		pos = getNextPosition(dir, pos);
+		const Tile* tile = map.getTile(pos);
+		REQUIRE(tile);
+		REQUIRE(!tile->hasFlag(TILESTATE_BLOCKSOLID));
+		usedGap = usedGap || pos == testPosition(20, 15);
+	}
+	CHECK(usedGap);
+	CHECK(std::max(Position::getDistanceX(pos, target), Position::getDistanceY(pos, target)) <= 1);
+
+	// the same search again is answered from the path cache until a tile on the way changes
+	PathCacheStats stats = map.getPathCacheStats();
+	std::forward_list<Direction> repeated;
+	REQUIRE(map.getPathMatching(start, repeated, FrozenPathingConditionCall(target), testPathParams()));
+	CHECK(repeated == dirList);
+	CHECK(map.getPathCacheStats().hits == stats.hits + 1);
+
+	// and searches again from clean nodes once it did
+	map.onTileCreatureChange(testPosition(20, 15));
+	repeated.clear();
+	REQUIRE(map.getPathMatching(start, repeated, FrozenPathingConditionCall(target), testPathParams()));
+	CHECK(repeated == dirList);
+	CHECK(map.getPathCacheStats().invalidations == stats.invalidations + 1);
+}
+
+TEST_CASE("Flow field leads around walls", "[UnitTest]") {
+	Map map;
+	buildTestMap(map, TEST_MAP_SIZE, [](uint16_t x, uint16_t y) {
+		return x == 20 && y != 15;
+	});
+
+	const Position target = testPosition(25, 20);
+	FlowField field;
+	field.build(map, target);
+	CHECK(field.getDistance(testPosition(24, 20)) == 0);
+	CHECK(field.getDistance(testPosition(20, 20)) == FLOW_FIELD_UNREACHABLE);
+	CHECK(field.getDistance(testPosition(25, 20 + FLOW_FIELD_RADIUS + 1)) == FLOW_FIELD_UNREACHABLE);
+
+	// walking down the field from behind the wall goes through the gap
+	Position pos = testPosition(15, 20);
+	bool usedGap = false;
+	while (field.getDistance(pos) != 0) {
+		const int32_t distance = field.getDistance(pos);
+		REQUIRE(distance != FLOW_FIELD_UNREACHABLE);
+
+		Position next = pos;
+		for (uint8_t dir = DIRECTION_NORTH; dir <= DIRECTION_LAST; ++dir) {
+			const Position neighbor = getNextPosition(static_cast<Direction>(dir), pos);
+			if (field.getDistance(neighbor) < field.getDistance(next)) {
+				next = neighbor;
+			}
+		}
+		REQUIRE(field.getDistance(next) < distance);
+		pos = next;
+		usedGap = usedGap || pos == testPosition(20, 15);
+	}
+	CHECK(usedGap);
+	CHECK(std::max(Position::getDistanceX(pos, target), Position::getDistanceY(pos, target)) == 1);
+}
+
+TEST_CASE("Path search throughput on a cluttered map", "[.][benchmark]") {
+	Map map;
+	std::mt19937 generator(7);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+	buildTestMap(map, TEST_MAP_SIZE, [&](uint16_t, uint16_t) {
+		return percent(generator) < 25;
+	});
+
+	// monsters chasing a target a few tiles away
+	std::uniform_int_distribution<uint16_t> coordinate(20, TEST_MAP_SIZE - 20);
+	std::uniform_int_distribution<int32_t> offset(-8, 8);
+	std::vector<std::pair<Position, Position>> searches;
+	for (int i = 0; i < 1000; ++i) {
+		Position start = testPosition(coordinate(generator), coordinate(generator));
+		map.getTile(start)->resetFlag(TILESTATE_BLOCKSOLID);
+		searches.emplace_back(start, Position(start.x + offset(generator), start.y + offset(generator), TEST_MAP_FLOOR));
+	}
+
+	const FindPathParams fpp = testPathParams();
+	BENCHMARK("1000 searches") {
+		size_t found = 0;
+		for (const auto& search : searches) {
+			// keep the path cache out of the measurement
+			map.onTileCreatureChange(search.first);
+			std::forward_list<Direction> dirList;
+			found += map.getPathMatching(search.first, dirList, FrozenPathingConditionCall(search.second), fpp);
+		}
+		return found;
+	};
+}
+
+TEST_CASE("Flow field build on a cluttered map", "[.][benchmark]") {
+	Map map;
+	std::mt19937 generator(7);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+	buildTestMap(map, TEST_MAP_SIZE, [&](uint16_t, uint16_t) {
+		return percent(generator) < 25;
+	});
+
+	// one field replaces the searches of every melee monster chasing this target
+	const Position target = testPosition(TEST_MAP_SIZE / 2, TEST_MAP_SIZE / 2);
+	FlowField field;
+	BENCHMARK("build") {
+		field.build(map, target);
+		return field.getDistance(testPosition(TEST_MAP_SIZE / 2 + 5, TEST_MAP_SIZE / 2 + 5));
+	};
+}
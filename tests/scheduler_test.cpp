@@ -0,0 +1,152 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/scheduler.h"
+#include <catch2/catch.hpp>
+#include <random>
+
+namespace {
+
+template <typename Queue>
+std::vector<uint32_t> drain(Queue& queue, int64_t now) {
+	std::vector<SchedulerTask*> expired;
+	queue.advance(now, expired);
+
+	std::vector<uint32_t> ids;
+	for (SchedulerTask* task : expired) {
+		ids.push_back(task->getEventId());
+		delete task;
+	}
+	return ids;
+}
+
+SchedulerTask* createTestTask(uint32_t id, uint32_t delay) {
+	SchedulerTask* task = createSchedulerTask(delay, [](){});
+	task->setEventId(id);
+	return task;
+}
+
+}
+
+TEST_CASE("Timing wheel expires events in order", "[UnitTest]") {
+	TimingWheel wheel;
+	const uint32_t delays[] = {0, 5, 255, 256, 300, 70000, 20000000};
+
+	int64_t base = std::numeric_limits<int64_t>::max();
+	for (uint32_t i = 0; i < 7; ++i) {
+		SchedulerTask* task = createTestTask(i + 1, delays[i]);
+		base = std::min(base, task->getCycleTicks() - delays[i]);
+		wheel.add(task);
+	}
+	CHECK(wheel.getSize() == 7);
+
+	SECTION("Nothing fires early") {
+		CHECK(drain(wheel, base - 1).empty());
+		CHECK(wheel.getSize() == 7);
+		wheel.clear();
+	}
+
+	SECTION("Everything fires once due") {
+		CHECK(drain(wheel, base + 256 + 20) == std::vector<uint32_t>({1, 2, 3, 4}));
+		CHECK(drain(wheel, base + 70000 + 50) == std::vector<uint32_t>({5, 6}));
+		CHECK(drain(wheel, base + 20000000 + 50) == std::vector<uint32_t>({7}));
+		CHECK(wheel.empty());
+	}
+}
+
+TEST_CASE("Timing wheel removes cancelled events in place", "[UnitTest]") {
+	TimingWheel wheel;
+	SchedulerTask* first = createTestTask(1, 100);
+	SchedulerTask* second = createTestTask(2, 100);
+	SchedulerTask* third = createTestTask(3, 100000);
+	wheel.add(first);
+	wheel.add(second);
+	wheel.add(third);
+
+	wheel.remove(second);
+	wheel.remove(third);
+	delete second;
+	delete third;
+	CHECK(wheel.getSize() == 1);
+
+	CHECK(drain(wheel, first->getCycleTicks() + 200000) == std::vector<uint32_t>({1}));
+	CHECK(wheel.empty());
+	CHECK(wheel.getNextExpiration() == std::numeric_limits<int64_t>::max());
+}
+
+TEST_CASE("Timing wheel matches the task heap", "[UnitTest]") {
+	TimingWheel wheel;
+	TaskHeap heap;
+
+	// both queues keep their own bookkeeping, so the same tasks can be queued in each
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<uint32_t> delay(0, 120000);
+	std::vector<SchedulerTask*> tasks;
+	for (uint32_t id = 1; id <= 5000; ++id) {
+		SchedulerTask* task = createTestTask(id, delay(generator));
+		wheel.add(task);
+		heap.add(task);
+		tasks.push_back(task);
+	}
+
+	int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	for (int64_t step = 0; step <= 130000; step += 997) {
+		std::vector<SchedulerTask*> wheelTasks, heapTasks;
+		wheel.advance(now + step, wheelTasks);
+		heap.advance(now + step, heapTasks);
+		std::sort(wheelTasks.begin(), wheelTasks.end());
+		std::sort(heapTasks.begin(), heapTasks.end());
+		REQUIRE(wheelTasks == heapTasks);
+	}
+	CHECK(wheel.empty());
+	CHECK(heap.empty());
+
+	for (SchedulerTask* task : tasks) {
+		delete task;
+	}
+}
+
+TEMPLATE_TEST_CASE("Scheduler queue with 100k outstanding events", "[.][benchmark]", TimingWheel, TaskHeap) {
+	BENCHMARK_ADVANCED("add, cancel half and expire")(Catch::Benchmark::Chronometer meter) {
+		std::mt19937 generator(42);
+		std::uniform_int_distribution<uint32_t> delay(0, 60000);
+
+		std::vector<std::vector<SchedulerTask*>> tasks(meter.runs());
+		for (auto& run : tasks) {
+			run.reserve(100000);
+			for (uint32_t id = 1; id <= 100000; ++id) {
+				run.push_back(createTestTask(id, delay(generator)));
+			}
+		}
+
+		meter.measure([&tasks](int run) {
+			TestType queue;
+			for (SchedulerTask* task : tasks[run]) {
+				queue.add(task);
+			}
+
+			for (size_t i = 0; i < tasks[run].size(); i += 2) {
+				queue.remove(tasks[run][i]);
+			}
+
+			// walk the clock forward in the 10ms steps of the output message auto send
+			std::vector<SchedulerTask*> expired;
+			int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			for (int64_t step = 0; step <= 60010; step += 10) {
+				queue.advance(now + step, expired);
+			}
+			return expired.size();
+		});
+
+		// the heap frees the cancelled tasks itself when they reach the top
+		bool ownsCancelled = std::is_same<TestType, TaskHeap>::value;
+		for (auto& run : tasks) {
+			for (size_t i = ownsCancelled ? 1 : 0; i < run.size(); i += ownsCancelled ? 2 : 1) {
+				delete run[i];
+			}
+		}
+	};
+}
@@ -0,0 +1,112 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "testmap.h"
+#include <catch2/catch.hpp>
+#include <random>
+
+namespace {
+
+constexpr uint16_t TEST_MAP_SIZE = 128;
+
+// creatures spread over a 128x128 area, the way a crowded hunting spot looks
+struct CrowdedMap {
+	Map map;
+	std::vector<std::unique_ptr<TestCreature>> creatures;
+
+	explicit CrowdedMap(size_t count) {
+		buildTestMap(map, TEST_MAP_SIZE, [](uint16_t, uint16_t) {
+			return false;
+		});
+
+		std::mt19937 generator(11);
+		std::uniform_int_distribution<uint16_t> coordinate(TEST_MAP_OFFSET, TEST_MAP_OFFSET + TEST_MAP_SIZE - 1);
+		for (size_t i = 0; i < count; ++i) {
+			auto creature = std::make_unique<TestCreature>();
+			Tile* tile = map.getTile(coordinate(generator), coordinate(generator), TEST_MAP_FLOOR);
+			creature->setParent(tile);
+			map.getQTNode(tile->getPosition().x, tile->getPosition().y)->addCreature(creature.get());
+			creatures.push_back(std::move(creature));
+		}
+	}
+
+	~CrowdedMap() {
+		for (auto& creature : creatures) {
+			map.getQTNode(creature->getPosition().x, creature->getPosition().y)->removeCreature(creature.get());
+		}
+	}
+};
+
+}
+
+TEST_CASE("Spectators match a scan of every creature", "[UnitTest]") {
+	CrowdedMap crowded(2000);
+	const Position center(TEST_MAP_OFFSET + 60, TEST_MAP_OFFSET + 60, TEST_MAP_FLOOR);
+
+	SpectatorVec spectators;
+	crowded.map.getSpectators(spectators, center, true);
+
+	std::vector<Creature*> expected;
+	for (auto& creature : crowded.creatures) {
+		const Position& pos = creature->getPosition();
+		if (Position::getDistanceX(pos, center) <= Map::maxViewportX && Position::getDistanceY(pos, center) <= Map::maxViewportY) {
+			expected.push_back(creature.get());
+		}
+	}
+
+	std::vector<Creature*> found(spectators.begin(), spectators.end());
+	std::sort(found.begin(), found.end());
+	std::sort(expected.begin(), expected.end());
+	CHECK(found.size() > SPECTATOR_VEC_CAPACITY);
+	CHECK(found == expected);
+
+	SECTION("Overlapping lookups list everyone once") {
+		crowded.map.getSpectators(spectators, Position(center.x + 3, center.y, center.z), true);
+		std::vector<Creature*> merged(spectators.begin(), spectators.end());
+		std::sort(merged.begin(), merged.end());
+		CHECK(std::adjacent_find(merged.begin(), merged.end()) == merged.end());
+		CHECK(std::includes(merged.begin(), merged.end(), expected.begin(), expected.end()));
+	}
+
+	SECTION("Erase removes a single spectator") {
+		spectators.erase(expected.front());
+		CHECK(spectators.size() == expected.size() - 1);
+		CHECK(std::find(spectators.begin(), spectators.end(), expected.front()) == spectators.end());
+	}
+}
+
+TEST_CASE("Spectators with 5000 creatures on screen-dense areas", "[.][benchmark]") {
+	CrowdedMap crowded(5000);
+
+	std::mt19937 generator(5);
+	std::uniform_int_distribution<uint16_t> coordinate(TEST_MAP_OFFSET + 12, TEST_MAP_OFFSET + TEST_MAP_SIZE - 12);
+	std::vector<Position> centers;
+	for (int i = 0; i < 1000; ++i) {
+		centers.emplace_back(coordinate(generator), coordinate(generator), TEST_MAP_FLOOR);
+	}
+
+	BENCHMARK("1000 multifloor lookups") {
+		size_t found = 0;
+		for (const Position& center : centers) {
+			SpectatorVec spectators;
+			crowded.map.getSpectators(spectators, center, true);
+			found += spectators.size();
+		}
+		return found;
+	};
+
+	// a creature step looks up the spectators of both its old and its new position
+	BENCHMARK("1000 merged old and new position lookups") {
+		size_t found = 0;
+		for (const Position& center : centers) {
+			SpectatorVec spectators;
+			crowded.map.getSpectators(spectators, center, true);
+			crowded.map.getSpectators(spectators, Position(center.x + 1, center.y, center.z), true);
+			found += spectators.size();
+		}
+		return found;
+	};
+}
@@ -0,0 +1,56 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/taskprofiler.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("Task histogram percentiles", "[UnitTest]") {
+	TaskHistogram histogram;
+	for (uint64_t us = 1; us <= 1000; ++us) {
+		histogram.add(us);
+	}
+
+	TaskHistogramData data = histogram.load();
+	CHECK(data.count == 1000);
+	CHECK(data.total == 500500);
+	CHECK(data.max == 1000);
+
+	// percentiles are the upper bound of the log2 bucket they fall in
+	CHECK(data.percentile(0.5) == 512);
+	CHECK(data.percentile(0.99) == 1000);
+	CHECK(data.percentile(0.01) == 16);
+
+	CHECK(histogram.takeWindowMax() == 1000);
+	CHECK(histogram.takeWindowMax() == 0);
+
+	SECTION("Difference of two snapshots") {
+		histogram.add(3);
+		TaskHistogramData window = histogram.load();
+		window -= data;
+		CHECK(window.count == 1);
+		CHECK(window.total == 3);
+	}
+}
+
+TEST_CASE("Task profiler categories", "[UnitTest]") {
+	TaskProfiler& profiler = TaskProfiler::getInstance();
+	uint16_t category = profiler.registerCategory("addEvent test.lua:1", TASK_CATEGORY_LUA_EVENT);
+	CHECK(category >= TASK_CATEGORY_FIRST_DYNAMIC);
+	CHECK(profiler.registerCategory("addEvent test.lua:1", TASK_CATEGORY_LUA_EVENT) == category);
+
+	profiler.record(category, std::chrono::microseconds(10), std::chrono::milliseconds(100));
+	profiler.recordExpired(category);
+
+	std::vector<TaskCategoryReport> report = profiler.getReport();
+	auto it = std::find_if(report.begin(), report.end(), [](const TaskCategoryReport& entry) {
+		return entry.name == "addEvent test.lua:1";
+	});
+	REQUIRE(it != report.end());
+	CHECK(it->execution.count == 1);
+	CHECK(it->execution.max == 100000);
+	CHECK(it->wait.max == 10);
+	CHECK(it->expired == 1);
+}
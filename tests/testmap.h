@@ -0,0 +1,80 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#ifndef FS_TESTMAP_H_AA275A26D60049B886EC0F10A4D26AF4
+#define FS_TESTMAP_H_AA275A26D60049B886EC0F10A4D26AF4
+
+#include "../src/creature.h"
+#include "../src/map.h"
+
+// the test maps start at this corner of the ground floor
+constexpr uint16_t TEST_MAP_OFFSET = 1000;
+constexpr uint8_t TEST_MAP_FLOOR = 7;
+
+class TestCreature final : public Creature
+{
+	public:
+		TestCreature() {
+			creatureCheck = true;
+		}
+
+		const std::string& getName() const override {
+			return name;
+		}
+		const std::string& getNameDescription() const override {
+			return name;
+		}
+		std::string getDescription(int32_t) const override {
+			return name;
+		}
+		CreatureType_t getType() const override {
+			return CREATURETYPE_MONSTER;
+		}
+		void setID() override {
+			static uint32_t lastID = 0;
+			id = ++lastID;
+		}
+		void removeList() override {}
+		void addList() override {}
+
+		void follow(Creature* creature) {
+			followCreature = creature;
+			isUpdatingPath = true;
+		}
+
+	protected:
+		void getPathSearchParams(const Creature*, FindPathParams& fpp) const override {
+			fpp.fullPathSearch = true;
+			fpp.clearSight = false;
+			fpp.maxSearchDist = 12;
+			fpp.minTargetDist = 1;
+			fpp.maxTargetDist = 1;
+		}
+
+	private:
+		std::string name = "test creature";
+};
+
+// size x size ground tiles from the offset, solid wherever isWall says so
+template <typename IsWall>
+void buildTestMap(Map& map, uint16_t size, IsWall isWall)
+{
+	for (uint16_t y = 0; y < size; ++y) {
+		for (uint16_t x = 0; x < size; ++x) {
+			Tile* tile = new StaticTile(TEST_MAP_OFFSET + x, TEST_MAP_OFFSET + y, TEST_MAP_FLOOR);
+			if (isWall(x, y)) {
+				tile->setFlag(TILESTATE_BLOCKSOLID);
+			}
+			map.setTile(TEST_MAP_OFFSET + x, TEST_MAP_OFFSET + y, TEST_MAP_FLOOR, tile);
+		}
+	}
+}
+
+inline Position testPosition(uint16_t x, uint16_t y)
+{
+	return Position(TEST_MAP_OFFSET + x, TEST_MAP_OFFSET + y, TEST_MAP_FLOOR);
+}
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/thinkplanner.h"
+#include "testmap.h"
+#include <catch2/catch.hpp>
+#include <random>
+
+namespace {
+
+constexpr uint16_t TEST_MAP_SIZE = 256;
+constexpr uint32_t TEST_THINK_INTERVAL = 1000;
+
+// followers chasing targets a few tiles away over a map with scattered walls
+struct FollowMap {
+	Map map;
+	std::vector<std::unique_ptr<TestCreature>> creatures;
+	std::vector<TestCreature*> followers;
+	std::vector<std::vector<Creature*>> buckets;
+
+	FollowMap(size_t count, size_t bucketCount) : buckets(bucketCount) {
+		std::mt19937 generator(19);
+		std::uniform_int_distribution<uint32_t> percent(0, 99);
+		buildTestMap(map, TEST_MAP_SIZE, [&](uint16_t, uint16_t) {
+			return percent(generator) < 20;
+		});
+
+		std::uniform_int_distribution<uint16_t> coordinate(TEST_MAP_OFFSET + 10, TEST_MAP_OFFSET + TEST_MAP_SIZE - 10);
+		std::uniform_int_distribution<int32_t> offset(-6, 6);
+		for (size_t i = 0; i < count; ++i) {
+			Tile* tile = map.getTile(coordinate(generator), coordinate(generator), TEST_MAP_FLOOR);
+			tile->resetFlag(TILESTATE_BLOCKSOLID);
+			const Position& pos = tile->getPosition();
+			Tile* targetTile = map.getTile(pos.x + offset(generator), pos.y + offset(generator), TEST_MAP_FLOOR);
+
+			TestCreature* target = addCreature(targetTile);
+			TestCreature* follower = addCreature(tile);
+			follower->follow(target);
+			followers.push_back(follower);
+			buckets[i % bucketCount].push_back(follower);
+		}
+	}
+
+	TestCreature* addCreature(Tile* tile) {
+		creatures.push_back(std::make_unique<TestCreature>());
+		creatures.back()->setParent(tile);
+		return creatures.back().get();
+	}
+};
+
+}
+
+TEST_CASE("Planned follow paths match the serial search", "[UnitTest]") {
+	FollowMap threaded(1000, 1);
+	FollowMap serial(1000, 1);
+
+	ThinkPlanner planner;
+	planner.start(3);
+	planner.plan(threaded.map, threaded.buckets.front(), TEST_THINK_INTERVAL);
+	planner.shutdown();
+
+	ThinkPlanner dispatcherOnly;
+	dispatcherOnly.plan(serial.map, serial.buckets.front(), TEST_THINK_INTERVAL);
+
+	const PathCacheStats threadedStats = threaded.map.getPathCacheStats();
+	const PathCacheStats serialStats = serial.map.getPathCacheStats();
+	for (size_t i = 0; i < threaded.followers.size(); ++i) {
+		const TestCreature& follower = *threaded.followers[i];
+		const Position targetPos = follower.getFollowCreature()->getPosition();
+		FindPathParams fpp;
+		REQUIRE(follower.getFollowPathSearch(TEST_THINK_INTERVAL, fpp));
+
+		// what onThink walks, answered from the planned entry where it was kept
+		std::forward_list<Direction> planned;
+		const bool plannedFound = threaded.map.getPathMatching(follower, planned, FrozenPathingConditionCall(targetPos), fpp);
+
+		std::forward_list<Direction> searched;
+		const bool searchedFound = threaded.map.searchPath(follower, targetPos, fpp, searched);
+		CHECK(plannedFound == searchedFound);
+		CHECK(planned == searched);
+
+		std::forward_list<Direction> serialPlanned;
+		serial.map.getPathMatching(*serial.followers[i], serialPlanned, FrozenPathingConditionCall(targetPos), fpp);
+		CHECK(serialPlanned == planned);
+	}
+
+	// the thread count does not change which plans were kept
+	const PathCacheStats threadedAfter = threaded.map.getPathCacheStats();
+	const PathCacheStats serialAfter = serial.map.getPathCacheStats();
+	CHECK(threadedAfter.hits - threadedStats.hits == serialAfter.hits - serialStats.hits);
+	CHECK(threadedAfter.hits > threadedStats.hits);
+}
+
+TEST_CASE("Flow fields held for a plan survive the expiry sweep", "[UnitTest]") {
+	Map map;
+	buildTestMap(map, TEST_MAP_SIZE, [](uint16_t, uint16_t) {
+		return false;
+	});
+
+	TestCreature oldTarget, newTarget;
+	oldTarget.setID();
+	newTarget.setID();
+	oldTarget.setParent(map.getTile(testPosition(50, 50)));
+	newTarget.setParent(map.getTile(testPosition(80, 80)));
+
+	// invalid and unused for longer than the expiry time
+	FlowField* expired = map.flowFields.getStaleField(oldTarget);
+	REQUIRE(expired);
+	expired->lastUsed = OTSYS_TIME() - FLOW_FIELD_EXPIRE_TIME - 1;
+
+	// the fields ThinkPlanner::plan collects for its builds, the new target's entry sweeps the old ones
+	FlowField* held = map.flowFields.getStaleField(oldTarget);
+	REQUIRE(held == expired);
+	FlowField* added = map.flowFields.getStaleField(newTarget);
+	REQUIRE(added);
+	REQUIRE(map.flowFields.size() == 2);
+
+	held->build(map, oldTarget.getPosition());
+	added->build(map, newTarget.getPosition());
+	CHECK(map.flowFields.getStaleField(oldTarget) == nullptr);
+	CHECK(map.flowFields.getStaleField(newTarget) == nullptr);
+}
+
+TEST_CASE("Follow path planning for 20k monsters", "[.][benchmark]") {
+	FollowMap world(20000, EVENT_CREATURECOUNT);
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+	for (size_t threads : {size_t(0), size_t(1), size_t(3), hardwareThreads - 1}) {
+		ThinkPlanner planner;
+		planner.start(threads);
+		BENCHMARK(std::to_string(threads) + " extra threads, one think round") {
+			for (const auto& bucket : world.buckets) {
+				planner.plan(world.map, bucket, TEST_THINK_INTERVAL);
+			}
+			return world.map.getPathCacheStats().hits;
+		};
+	}
+}
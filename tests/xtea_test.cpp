@@ -0,0 +1,78 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "../src/otpch.h"
+#include "../src/xtea.h"
+#include <catch2/catch.hpp>
+#include <random>
+
+namespace {
+
+std::vector<uint8_t> randomBytes(std::mt19937& generator, size_t length) {
+	std::uniform_int_distribution<uint32_t> byte(0, 0xFF);
+	std::vector<uint8_t> data(length);
+	for (uint8_t& value : data) {
+		value = static_cast<uint8_t>(byte(generator));
+	}
+	return data;
+}
+
+}
+
+TEST_CASE("XTEA matches the published test vector", "[UnitTest]") {
+	// 41424344 45464748 encrypts to 497df3d0 72612cb5 under key 00010203 04050607 08090a0b 0c0d0e0f,
+	// the words are stored little-endian on the wire
+	const xtea::key k = {0x00010203, 0x04050607, 0x08090A0B, 0x0C0D0E0F};
+	for (const xtea::implementation& implementation : xtea::supported_implementations()) {
+		INFO(implementation.name);
+		std::vector<uint8_t> data = {0x44, 0x43, 0x42, 0x41, 0x48, 0x47, 0x46, 0x45};
+		implementation.encrypt(data.data(), data.size(), k);
+		CHECK(data == std::vector<uint8_t>({0xD0, 0xF3, 0x7D, 0x49, 0xB5, 0x2C, 0x61, 0x72}));
+		implementation.decrypt(data.data(), data.size(), k);
+		CHECK(data == std::vector<uint8_t>({0x44, 0x43, 0x42, 0x41, 0x48, 0x47, 0x46, 0x45}));
+	}
+}
+
+TEST_CASE("XTEA implementations match the scalar reference", "[UnitTest]") {
+	const auto& implementations = xtea::supported_implementations();
+	REQUIRE(!implementations.empty());
+	const xtea::implementation& reference = implementations.front();
+
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<uint32_t> word;
+	std::uniform_int_distribution<size_t> blocks(0, 24 * 1024 / 8);
+	for (int i = 0; i < 200; ++i) {
+		const xtea::key k = {word(generator), word(generator), word(generator), word(generator)};
+		// the short lengths cover the leftover blocks after the vector loops
+		size_t length = (i < 16 ? i : blocks(generator)) * 8;
+		const std::vector<uint8_t> plain = randomBytes(generator, length);
+
+		std::vector<uint8_t> expected = plain;
+		reference.encrypt(expected.data(), expected.size(), k);
+
+		for (const xtea::implementation& implementation : implementations) {
+			INFO(implementation.name << " on " << length << " bytes");
+			std::vector<uint8_t> data = plain;
+			implementation.encrypt(data.data(), data.size(), k);
+			REQUIRE(data == expected);
+			implementation.decrypt(data.data(), data.size(), k);
+			REQUIRE(data == plain);
+		}
+	}
+}
+
+TEST_CASE("XTEA throughput per implementation", "[.][benchmark]") {
+	std::mt19937 generator(42);
+	const xtea::key k = {0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210};
+	for (const xtea::implementation& implementation : xtea::supported_implementations()) {
+		for (size_t length : {1024, 8 * 1024, 24 * 1024}) {
+			std::vector<uint8_t> data = randomBytes(generator, length);
+			BENCHMARK(std::string(implementation.name) + " encrypt " + std::to_string(length) + " bytes") {
+				implementation.encrypt(data.data(), data.size(), k);
+				return data[0];
+			};
+		}
+	}
+}